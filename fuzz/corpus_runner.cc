@@ -0,0 +1,164 @@
+/* Runs the inputs of a fuzzing corpus through LLVMFuzzerTestOneInput() and
+ * reports, for each of them, the time it took and the memory it allocated.
+ *
+ * Inputs that cost much more per byte than the median input are flagged, as
+ * that is how quadratic or worse behaviour on deep nesting, huge arrays or
+ * many signatures shows up. The exit status is 1 if any input was flagged.
+ *
+ * Only C++ allocations are counted: operator new is replaced for this
+ * program, while the ASN.1 decoder allocates with malloc().
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "utilities/utils.h"
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+// Small inputs are dominated by fixed costs, and say nothing about scaling.
+const size_t kMinFlaggedSize = 64;
+const unsigned int kRuns = 3;
+
+struct Measurement {
+  std::string path;
+  size_t size{0};
+  double micros{0};
+  uint64_t allocations{0};
+  uint64_t allocated_bytes{0};
+
+  double nanosPerByte() const { return micros * 1000. / static_cast<double>(std::max<size_t>(size, 1)); }
+  double allocationsPerByte() const {
+    return static_cast<double>(allocations) / static_cast<double>(std::max<size_t>(size, 1));
+  }
+};
+
+Measurement measure(const boost::filesystem::path &path) {
+  const std::string input = Utils::readFile(path);
+  const auto *data = reinterpret_cast<const uint8_t *>(input.data());
+  Measurement result;
+  result.path = path.string();
+  result.size = input.size();
+  // Keep the fastest run, the others only add noise.
+  for (unsigned int run = 0; run < kRuns; ++run) {
+    const uint64_t allocations_before = allocations;
+    const uint64_t bytes_before = allocated_bytes;
+    const auto start = std::chrono::steady_clock::now();
+    LLVMFuzzerTestOneInput(data, input.size());
+    const double micros =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    if (run == 0 || micros < result.micros) {
+      result.micros = micros;
+    }
+    result.allocations = allocations - allocations_before;
+    result.allocated_bytes = allocated_bytes - bytes_before;
+  }
+  return result;
+}
+
+double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+  return values[values.size() / 2];
+}
+
+void usage(const char *name) {
+  std::cerr << "Usage: " << name << " [--factor N] FILE_OR_DIRECTORY...\n"
+            << "  Flags the inputs that cost more than N times (default 20) the median per byte.\n";
+}
+
+}  // namespace
+
+void *operator new(size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv) {
+  double factor = 20;
+  std::vector<boost::filesystem::path> inputs;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--factor" && i + 1 < argc) {
+      factor = std::stod(argv[++i]);
+    } else if (arg == "--help" || arg.compare(0, 2, "--") == 0) {
+      usage(argv[0]);
+      return arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else if (boost::filesystem::is_directory(arg)) {
+      for (const auto &entry : boost::filesystem::directory_iterator(arg)) {
+        if (boost::filesystem::is_regular_file(entry.path())) {
+          inputs.push_back(entry.path());
+        }
+      }
+    } else {
+      inputs.emplace_back(arg);
+    }
+  }
+  if (inputs.empty()) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::sort(inputs.begin(), inputs.end());
+
+  LLVMFuzzerInitialize(&argc, &argv);
+
+  std::vector<Measurement> measurements;
+  std::vector<double> nanos_per_byte;
+  std::vector<double> allocations_per_byte;
+  for (const auto &path : inputs) {
+    measurements.push_back(measure(path));
+    if (measurements.back().size >= kMinFlaggedSize) {
+      nanos_per_byte.push_back(measurements.back().nanosPerByte());
+      allocations_per_byte.push_back(measurements.back().allocationsPerByte());
+    }
+  }
+  const double median_nanos = median(nanos_per_byte);
+  const double median_allocations = median(allocations_per_byte);
+
+  std::cout << std::setw(10) << "bytes" << std::setw(14) << "us" << std::setw(12) << "ns/byte" << std::setw(12)
+            << "allocs" << std::setw(14) << "alloc bytes" << "  input" << std::endl;
+  unsigned int flagged = 0;
+  for (const auto &m : measurements) {
+    const bool slow = m.size >= kMinFlaggedSize && m.nanosPerByte() > factor * median_nanos;
+    const bool hungry = m.size >= kMinFlaggedSize && m.allocationsPerByte() > factor * median_allocations;
+    std::cout << std::setw(10) << m.size << std::fixed << std::setprecision(1) << std::setw(14) << m.micros
+              << std::setw(12) << m.nanosPerByte() << std::setw(12) << m.allocations << std::setw(14)
+              << m.allocated_bytes << "  " << m.path;
+    if (slow || hungry) {
+      std::cout << "  <- " << (slow ? "slow" : "") << (slow && hungry ? ", " : "")
+                << (hungry ? "many allocations" : "");
+      ++flagged;
+    }
+    std::cout << std::endl;
+  }
+  std::cout << measurements.size() << " inputs, median " << std::setprecision(1) << median_nanos << " ns and "
+            << std::setprecision(3) << median_allocations << " allocations per byte, " << flagged << " flagged"
+            << std::endl;
+  return flagged == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,108 @@
+/* libFuzzer target for the parsers that see data before it is authenticated:
+ * Image and Director repo metadata, and the ASN.1 messages exchanged with IP
+ * Secondaries.
+ *
+ * The first byte of an input picks the parser and the rest is handed to it:
+ *   't' Targets metadata, parsed from its text
+ *   'j' Targets metadata, parsed as a Json::Value
+ *   'r' Root metadata, with its signatures checked
+ *   'a' an IP Secondary message, BER encoded
+ *   'c' a single CER token
+ * Any other byte picks one of them by its value, so that all inputs are used.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "asn1/asn1-cer.h"
+#include "asn1/asn1_message.h"
+#include "logging/logging.h"
+#include "uptane/tuf.h"
+#include "utilities/utils.h"
+
+namespace {
+
+void fuzzTargetsText(const std::string &input) {
+  // Signatures are not what is fuzzed here; accept them all to get to the rest.
+  auto signer = std::make_shared<Uptane::Root>(Uptane::Root::Policy::kAcceptAll);
+  const Uptane::Targets targets(Uptane::RepositoryType::Image(), Uptane::Role::Targets(), input, signer);
+  for (const auto &target : targets.targets) {
+    target.custom_data();
+    targets.findTarget(target.filename());
+    for (const auto &name : targets.delegated_role_names_) {
+      targets.isDelegatedPath(Uptane::Role::Delegation(name), target.filename());
+    }
+  }
+}
+
+void fuzzTargetsJson(const std::string &input) {
+  const Uptane::Targets targets(Utils::parseJSON(input));
+  for (const auto &target : targets.targets) {
+    target.custom_data();
+  }
+}
+
+void fuzzRoot(const std::string &input) { Uptane::Root(Uptane::RepositoryType::Director(), Utils::parseJSON(input)); }
+
+void fuzzAsn1Message(const std::string &input) {
+  AKIpUptaneMes_t *m = nullptr;
+  asn_codec_ctx_s context{};
+  ber_decode(&context, &asn_DEF_AKIpUptaneMes, reinterpret_cast<void **>(&m), input.c_str(), input.size());
+  // ber_decode allocates *m even on failure.
+  Asn1Message::FromRaw(&m);
+}
+
+void fuzzCerToken(const std::string &input) {
+  int32_t endpos = 0;
+  int32_t int_param = 0;
+  std::string string_param;
+  cer_decode_token(input, &endpos, &int_param, &string_param);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  (void)argc;
+  (void)argv;
+  logger_init();
+  logger_set_threshold(boost::log::trivial::fatal);
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  using Parser = void (*)(const std::string &);
+  static const Parser parsers[] = {fuzzTargetsText, fuzzTargetsJson, fuzzRoot, fuzzAsn1Message, fuzzCerToken};
+  Parser parser;
+  switch (data[0]) {
+    case 't':
+      parser = fuzzTargetsText;
+      break;
+    case 'j':
+      parser = fuzzTargetsJson;
+      break;
+    case 'r':
+      parser = fuzzRoot;
+      break;
+    case 'a':
+      parser = fuzzAsn1Message;
+      break;
+    case 'c':
+      parser = fuzzCerToken;
+      break;
+    default:
+      parser = parsers[data[0] % (sizeof(parsers) / sizeof(parsers[0]))];
+      break;
+  }
+
+  try {
+    parser(std::string(reinterpret_cast<const char *>(data) + 1, size - 1));
+  } catch (const std::exception &) {
+    // Rejecting invalid input is fine, crashing or hanging is not.
+  }
+  return 0;
+}
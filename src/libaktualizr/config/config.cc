@@ -52,6 +52,8 @@ void ProvisionConfig::writeToStream(std::ostream& out_stream) const {
 
 void UptaneConfig::updateFromPropertyTree(const boost::property_tree::ptree& pt) {
   CopyFromConfig(polling_sec, "polling_sec", pt);
+  CopyFromConfig(polling_max_sec, "polling_max_sec", pt);
+  CopyFromConfig(polling_jitter_percent, "polling_jitter_percent", pt);
   CopyFromConfig(director_server, "director_server", pt);
   CopyFromConfig(repo_server, "repo_server", pt);
   CopyFromConfig(key_source, "key_source", pt);
@@ -63,6 +65,8 @@ void UptaneConfig::updateFromPropertyTree(const boost::property_tree::ptree& pt)
 
 void UptaneConfig::writeToStream(std::ostream& out_stream) const {
   writeOption(out_stream, polling_sec, "polling_sec");
+  writeOption(out_stream, polling_max_sec, "polling_max_sec");
+  writeOption(out_stream, polling_jitter_percent, "polling_jitter_percent");
   writeOption(out_stream, director_server, "director_server");
   writeOption(out_stream, repo_server, "repo_server");
   writeOption(out_stream, key_source, "key_source");
@@ -52,6 +52,8 @@ struct ProvisionConfig {
 
 struct UptaneConfig {
   uint64_t polling_sec{10U};
+  uint64_t polling_max_sec{3600U};
+  uint64_t polling_jitter_percent{10U};
   std::string director_server;
   std::string repo_server;
   CryptoSource key_source{CryptoSource::kFile};
@@ -2,7 +2,16 @@
 
 #include <boost/algorithm/hex.hpp>
 #include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <sodium.h>
 
@@ -185,25 +194,56 @@ std::string Crypto::ED25519Sign(const std::string &private_key, const std::strin
   return std::string(reinterpret_cast<char *>(sig), crypto_sign_BYTES);
 }
 
-bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message) {
-  StructGuard<RSA> rsa(nullptr, RSA_free);
-  StructGuard<BIO> bio(BIO_new_mem_buf(const_cast<char *>(public_key.c_str()), static_cast<int>(public_key.size())),
-                       BIO_vfree);
+namespace {
+
+/* Parsed RSA public keys by their PEM text. Metadata and manifests are
+ * checked against the same few keys over and over, and parsing a key costs
+ * about as much as checking a signature with it. The keys are only read once
+ * parsed, so they can be used from several threads. */
+std::shared_ptr<RSA> rsaPublicKey(const std::string &pem) {
+  // Far more than the keys of the repositories and ECUs; only there to keep
+  // the cache bounded when keys keep changing.
+  static const size_t kMaxKeys = 256;
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<RSA>> keys;
   {
-    RSA *r = nullptr;
-    if (PEM_read_bio_RSA_PUBKEY(bio.get(), &r, nullptr, nullptr) == nullptr) {
-      LOG_ERROR << "PEM_read_bio_RSA_PUBKEY failed with error " << ERR_error_string(ERR_get_error(), nullptr);
-      return false;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = keys.find(pem);
+    if (it != keys.end()) {
+      return it->second;
     }
-    rsa.reset(r);
   }
 
+  StructGuard<BIO> bio(BIO_new_mem_buf(const_cast<char *>(pem.c_str()), static_cast<int>(pem.size())), BIO_vfree);
+  RSA *r = nullptr;
+  if (PEM_read_bio_RSA_PUBKEY(bio.get(), &r, nullptr, nullptr) == nullptr) {
+    LOG_ERROR << "PEM_read_bio_RSA_PUBKEY failed with error " << ERR_error_string(ERR_get_error(), nullptr);
+    return nullptr;
+  }
+  std::shared_ptr<RSA> rsa(r, RSA_free);
+
 #if AKTUALIZR_OPENSSL_PRE_11
   RSA_set_method(rsa.get(), RSA_PKCS1_SSLeay());
 #else
   RSA_set_method(rsa.get(), RSA_PKCS1_OpenSSL());
 #endif
 
+  std::lock_guard<std::mutex> guard(mutex);
+  if (keys.size() >= kMaxKeys) {
+    keys.clear();
+  }
+  keys.emplace(pem, rsa);
+  return rsa;
+}
+
+}  // namespace
+
+bool Crypto::RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message) {
+  const std::shared_ptr<RSA> rsa = rsaPublicKey(public_key);
+  if (rsa == nullptr) {
+    return false;
+  }
+
   const auto size = static_cast<unsigned int>(RSA_size(rsa.get()));
   boost::scoped_array<unsigned char> pDecrypted(new unsigned char[size]);
   /* now we will verify the signature
@@ -234,6 +274,133 @@ bool Crypto::ED25519Verify(const std::string &public_key, const std::string &sig
                                      reinterpret_cast<const unsigned char *>(public_key.c_str())) == 0;
 }
 
+namespace {
+/**
+ * Threads that check signatures for Crypto::VerifySignatures(). They are
+ * started on first use and live until the process exits, so that a batch of
+ * checks does not pay for starting threads. The calling thread takes part in
+ * its own batch, so a busy pool never holds it up.
+ */
+class VerifierPool {
+ public:
+  static VerifierPool &instance() {
+    static VerifierPool pool;
+    return pool;
+  }
+
+  VerifierPool(const VerifierPool &) = delete;
+  VerifierPool &operator=(const VerifierPool &) = delete;
+
+  /* Call check(i) for every i below count, and wait until all are done. */
+  void run(size_t count, const std::function<void(size_t)> &check) {
+    auto batch = std::make_shared<Batch>(count, check);
+    {
+      std::lock_guard<std::mutex> guard(m_);
+      batches_.push_back(batch);
+    }
+    cv_.notify_all();
+    work(*batch);
+    std::unique_lock<std::mutex> lock(m_);
+    batches_.erase(std::remove(batches_.begin(), batches_.end(), batch), batches_.end());
+    done_cv_.wait(lock, [&batch]() { return batch->finished == batch->count; });
+  }
+
+  size_t size() const { return threads_.size() + 1; }
+
+ private:
+  struct Batch {
+    Batch(size_t count_in, const std::function<void(size_t)> &check_in) : count(count_in), check(check_in) {}
+    const size_t count;
+    const std::function<void(size_t)> &check;
+    std::atomic<size_t> next{0};
+    size_t finished{0};  // protected by m_
+  };
+
+  VerifierPool() {
+    const unsigned int threads = std::max(std::thread::hardware_concurrency(), 1U) - 1;
+    for (unsigned int t = 0; t < threads; ++t) {
+      threads_.emplace_back([this]() { loop(); });
+    }
+  }
+
+  ~VerifierPool() {
+    {
+      std::lock_guard<std::mutex> guard(m_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(m_);
+    while (true) {
+      cv_.wait(lock, [this]() { return stop_ || !batches_.empty(); });
+      if (stop_) {
+        return;
+      }
+      std::shared_ptr<Batch> batch = batches_.front();
+      lock.unlock();
+      work(*batch);
+      lock.lock();
+      // Every check of the batch has been taken, leave it to the others.
+      batches_.erase(std::remove(batches_.begin(), batches_.end(), batch), batches_.end());
+    }
+  }
+
+  void work(Batch &batch) {
+    size_t done = 0;
+    for (size_t i = batch.next++; i < batch.count; i = batch.next++) {
+      batch.check(i);
+      ++done;
+    }
+    if (done > 0) {
+      std::lock_guard<std::mutex> guard(m_);
+      batch.finished += done;
+      if (batch.finished == batch.count) {
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::deque<std::shared_ptr<Batch>> batches_;
+  std::vector<std::thread> threads_;
+  bool stop_{false};
+};
+}  // namespace
+
+std::vector<bool> Crypto::VerifySignatures(const std::vector<SignatureCheck> &checks) {
+  // Not a std::vector<bool>, which can not be written from several threads.
+  std::vector<char> valid(checks.size(), 0);
+  const std::function<void(size_t)> check = [&checks, &valid](size_t i) {
+    valid[i] = static_cast<char>(checks[i].key->VerifySignature(checks[i].signature, *checks[i].message));
+  };
+
+  // ED25519 checks take less time than handing them to another thread. With
+  // OpenSSL 1.0, the shared RSA keys are not safe to use from several threads
+  // unless the application sets up locking, which this one does not.
+  bool parallel = checks.size() > 1 && std::any_of(checks.cbegin(), checks.cend(), [](const SignatureCheck &c) {
+                    return IsRsaKeyType(c.key->Type());
+                  });
+#if AKTUALIZR_OPENSSL_PRE_11
+  parallel = false;
+#endif
+
+  if (parallel) {
+    VerifierPool::instance().run(checks.size(), check);
+  } else {
+    for (size_t i = 0; i < checks.size(); ++i) {
+      check(i);
+    }
+  }
+  return std::vector<bool>(valid.cbegin(), valid.cend());
+}
+
 bool Crypto::parseP12(BIO *p12_bio, const std::string &p12_password, std::string *out_pkey, std::string *out_cert,
                       std::string *out_ca) {
 #if AKTUALIZR_OPENSSL_PRE_11
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "utilities/types.h"
 #include "utilities/utils.h"
@@ -58,6 +59,18 @@ class PublicKey {
   KeyType type_{KeyType::kUnknown};
 };
 
+/**
+ * A signature to be checked together with others by Crypto::VerifySignatures().
+ * The key and the message must outlive the check.
+ */
+struct SignatureCheck {
+  SignatureCheck(const PublicKey &key_in, std::string signature_in, const std::string &message_in)
+      : key(&key_in), signature(std::move(signature_in)), message(&message_in) {}
+  const PublicKey *key;
+  std::string signature;
+  const std::string *message;
+};
+
 class MultiPartHasher {
  public:
   virtual void update(const unsigned char *part, uint64_t size) = 0;
@@ -112,6 +125,12 @@ class Crypto {
 
   static bool RSAPSSVerify(const std::string &public_key, const std::string &signature, const std::string &message);
   static bool ED25519Verify(const std::string &public_key, const std::string &signature, const std::string &message);
+  /**
+   * Check several signatures, concurrently on a set of long-lived threads
+   * when some of them are RSA ones. Returns whether each of them is valid, in
+   * the order of the checks.
+   */
+  static std::vector<bool> VerifySignatures(const std::vector<SignatureCheck> &checks);
 
   static bool IsRsaKeyType(KeyType type);
   static KeyType IdentifyRSAKeyType(const std::string &public_key_pem);
@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <json/json.h>
 #include <boost/algorithm/hex.hpp>
@@ -146,6 +148,64 @@ TEST(crypto, verify_ed25519) {
   EXPECT_FALSE(signe_is_ok);
 }
 
+/* Verify several signatures at once, with a mix of key types and valid and
+ * invalid signatures, and the same RSA key used more than once. */
+TEST(crypto, verify_signatures) {
+  const std::string text = "This is text for sign";
+  const std::string other_text = "This is some other text";
+  PublicKey rsa_key(fs::path("tests/test_data/public.key"));
+  const std::string private_key = Utils::readFile("tests/test_data/priv.key");
+  const std::string rsa_signature = Utils::toBase64(Crypto::RSAPSSSign(NULL, private_key, text));
+
+  std::string ed_public;
+  std::string ed_private;
+  ASSERT_TRUE(Crypto::generateEDKeyPair(&ed_public, &ed_private));
+  PublicKey ed_key(ed_public, KeyType::kED25519);
+  const std::string ed_signature = Utils::toBase64(Crypto::ED25519Sign(boost::algorithm::unhex(ed_private), text));
+
+  std::vector<SignatureCheck> checks;
+  checks.emplace_back(rsa_key, rsa_signature, text);
+  checks.emplace_back(ed_key, ed_signature, text);
+  checks.emplace_back(rsa_key, rsa_signature, other_text);
+  checks.emplace_back(ed_key, ed_signature, other_text);
+  checks.emplace_back(rsa_key, "this is bad signature", text);
+  checks.emplace_back(rsa_key, rsa_signature, text);
+  const std::vector<bool> expected{true, true, false, false, false, true};
+  EXPECT_EQ(Crypto::VerifySignatures(checks), expected);
+  EXPECT_TRUE(Crypto::VerifySignatures(std::vector<SignatureCheck>()).empty());
+}
+
+/* The threads that check signatures are shared: batches from several
+ * callers at once all get the right answers. */
+TEST(crypto, verify_signatures_concurrently) {
+  const std::string text = "This is text for sign";
+  PublicKey rsa_key(fs::path("tests/test_data/public.key"));
+  const std::string private_key = Utils::readFile("tests/test_data/priv.key");
+  const std::string rsa_signature = Utils::toBase64(Crypto::RSAPSSSign(NULL, private_key, text));
+
+  std::vector<std::future<bool>> callers;
+  for (int c = 0; c < 4; ++c) {
+    callers.push_back(std::async(std::launch::async, [&, c]() {
+      std::vector<SignatureCheck> checks;
+      std::vector<bool> expected;
+      for (int i = 0; i < 8; ++i) {
+        const bool good = (i + c) % 3 != 0;
+        checks.emplace_back(rsa_key, good ? rsa_signature : "this is bad signature", text);
+        expected.push_back(good);
+      }
+      for (int round = 0; round < 5; ++round) {
+        if (Crypto::VerifySignatures(checks) != expected) {
+          return false;
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto &caller : callers) {
+    EXPECT_TRUE(caller.get());
+  }
+}
+
 TEST(crypto, bad_keytype) {
   PublicKey pkey("somekey", KeyType::kUnknown);
   EXPECT_EQ(pkey.Type(), KeyType::kUnknown);
@@ -1,8 +1,16 @@
 #include "httpclient.h"
 
 #include <assert.h>
+#include <iterator>
+#include <mutex>
 #include <sstream>
 
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include "crypto/crypto.h"
 #include "utilities/aktualizr_version.h"
 #include "utilities/utils.h"
 
@@ -63,7 +71,8 @@ HttpClient::HttpClient(const std::vector<std::string>* extra_headers) {
   curlEasySetoptWrapper(curl, CURLOPT_USERAGENT, Utils::getUserAgent());
 }
 
-HttpClient::HttpClient(const HttpClient& curl_in) : pkcs11_key(curl_in.pkcs11_key), pkcs11_cert(curl_in.pkcs11_key) {
+HttpClient::HttpClient(const HttpClient& curl_in)
+    : tls_credentials_(curl_in.tls_credentials_), pkcs11_key(curl_in.pkcs11_key), pkcs11_cert(curl_in.pkcs11_key) {
   curl = curl_easy_duphandle(curl_in.curl);
   headers = curl_slist_dup(curl_in.headers);
 }
@@ -75,6 +84,115 @@ HttpClient::~HttpClient() {
   curl_easy_cleanup(curl);
 }
 
+/**
+ * \par Description:
+ *    TLS credentials parsed once and handed to OpenSSL for every new
+ *    connection by sslCtxFunction(), rather than written to temporary files
+ *    that curl reads and parses again.
+ */
+struct HttpClient::TlsCredentials {
+  std::vector<StructGuard<X509>> ca;
+  StructGuard<X509> cert{nullptr, X509_free};
+  // Intermediate certificates that follow the client certificate.
+  std::vector<StructGuard<X509>> chain;
+  StructGuard<EVP_PKEY> pkey{nullptr, EVP_PKEY_free};
+  // Returned for every connection if the credentials could not be parsed.
+  CURLcode error{CURLE_OK};
+
+  static std::shared_ptr<const TlsCredentials> get(const std::string& ca, const std::string& cert,
+                                                   const std::string& pkey);
+};
+
+static std::vector<StructGuard<X509>> readCertificates(const std::string& pem) {
+  std::vector<StructGuard<X509>> certs;
+  StructGuard<BIO> bio(BIO_new_mem_buf(const_cast<char*>(pem.c_str()), static_cast<int>(pem.size())), BIO_vfree);
+  while (true) {
+    StructGuard<X509> cert(PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr), X509_free);
+    if (cert == nullptr) {
+      break;
+    }
+    certs.push_back(std::move(cert));
+  }
+  // Reading stops with an error at the end of the data.
+  ERR_clear_error();
+  return certs;
+}
+
+std::shared_ptr<const HttpClient::TlsCredentials> HttpClient::TlsCredentials::get(const std::string& ca,
+                                                                                  const std::string& cert,
+                                                                                  const std::string& pkey) {
+  // All the clients of a device use the same credentials, so only the last
+  // ones are kept.
+  static std::mutex mutex;
+  static std::string last_digest;
+  static std::shared_ptr<const TlsCredentials> last;
+
+  const std::string digest = Crypto::sha256digest(ca) + Crypto::sha256digest(cert) + Crypto::sha256digest(pkey);
+  std::lock_guard<std::mutex> guard(mutex);
+  if (last != nullptr && digest == last_digest) {
+    return last;
+  }
+
+  auto credentials = std::make_shared<TlsCredentials>();
+  credentials->ca = readCertificates(ca);
+  if (credentials->ca.empty()) {
+    LOG_ERROR << "Could not parse the TLS CA certificate";
+    credentials->error = CURLE_SSL_CACERT_BADFILE;
+  }
+  if (!cert.empty()) {
+    std::vector<StructGuard<X509>> certs = readCertificates(cert);
+    StructGuard<BIO> bio(BIO_new_mem_buf(const_cast<char*>(pkey.c_str()), static_cast<int>(pkey.size())), BIO_vfree);
+    credentials->pkey.reset(PEM_read_bio_PrivateKey(bio.get(), nullptr, nullptr, nullptr));
+    if (certs.empty() || credentials->pkey == nullptr) {
+      LOG_ERROR << "Could not parse the TLS client certificate or key";
+      credentials->error = CURLE_SSL_CERTPROBLEM;
+    } else {
+      credentials->cert = std::move(certs.front());
+      std::move(certs.begin() + 1, certs.end(), std::back_inserter(credentials->chain));
+    }
+    ERR_clear_error();
+  }
+  last = credentials;
+  last_digest = digest;
+  return last;
+}
+
+CURLcode HttpClient::sslCtxFunction(CURL* handle, void* sslctx, void* parm) {
+  (void)handle;
+  const auto* credentials = static_cast<const TlsCredentials*>(parm);
+  if (credentials->error != CURLE_OK) {
+    return credentials->error;
+  }
+
+  auto* ctx = static_cast<SSL_CTX*>(sslctx);
+  X509_STORE* store = SSL_CTX_get_cert_store(ctx);
+  for (const auto& ca : credentials->ca) {
+    if (X509_STORE_add_cert(store, ca.get()) != 1) {
+      // curl can share one store between connections, which then already
+      // has the certificate.
+      if (ERR_GET_REASON(ERR_peek_last_error()) != X509_R_CERT_ALREADY_IN_HASH_TABLE) {
+        return CURLE_SSL_CACERT_BADFILE;
+      }
+      ERR_clear_error();
+    }
+  }
+
+  if (credentials->cert != nullptr) {
+    if (SSL_CTX_use_certificate(ctx, credentials->cert.get()) != 1) {
+      return CURLE_SSL_CERTPROBLEM;
+    }
+    for (const auto& cert : credentials->chain) {
+      if (SSL_CTX_add1_chain_cert(ctx, cert.get()) != 1) {
+        return CURLE_SSL_CERTPROBLEM;
+      }
+    }
+    if (SSL_CTX_use_PrivateKey(ctx, credentials->pkey.get()) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+      return CURLE_SSL_CERTPROBLEM;
+    }
+  }
+  return CURLE_OK;
+}
+
 void HttpClient::setCerts(const std::string& ca, CryptoSource ca_source, const std::string& cert,
                           CryptoSource cert_source, const std::string& pkey, CryptoSource pkey_source) {
   curlEasySetoptWrapper(curl, CURLOPT_SSL_VERIFYPEER, 1);
@@ -84,14 +202,34 @@ void HttpClient::setCerts(const std::string& ca, CryptoSource ca_source, const s
   if (ca_source == CryptoSource::kPkcs11) {
     throw std::runtime_error("Accessing CA certificate on PKCS11 devices isn't currently supported");
   }
-  std::unique_ptr<TemporaryFile> tmp_ca_file = std_::make_unique<TemporaryFile>("tls-ca");
-  tmp_ca_file->PutContents(ca);
-  curlEasySetoptWrapper(curl, CURLOPT_CAINFO, tmp_ca_file->Path().c_str());
-  tls_ca_file = std::move_if_noexcept(tmp_ca_file);
+
+  // The client certificate and key are only taken from memory together, as
+  // curl has to get both from the PKCS#11 engine otherwise.
+  bool in_memory_key = (cert_source != CryptoSource::kPkcs11 && pkey_source != CryptoSource::kPkcs11);
+  tls_credentials_ = TlsCredentials::get(ca, in_memory_key ? cert : "", in_memory_key ? pkey : "");
+  tls_ca_file.reset();
+  tls_cert_file.reset();
+  tls_pkey_file.reset();
+  if (curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, sslCtxFunction) == CURLE_OK) {
+    curlEasySetoptWrapper(curl, CURLOPT_SSL_CTX_DATA, tls_credentials_.get());
+    // Only trust the given CA, as when it is passed in a file.
+    curlEasySetoptWrapper(curl, CURLOPT_CAINFO, static_cast<const char*>(nullptr));
+  } else {
+    // The TLS backend of curl does not support it.
+    LOG_DEBUG << "Passing the TLS credentials to curl in temporary files";
+    tls_credentials_.reset();
+    in_memory_key = false;
+    std::unique_ptr<TemporaryFile> tmp_ca_file = std_::make_unique<TemporaryFile>("tls-ca");
+    tmp_ca_file->PutContents(ca);
+    curlEasySetoptWrapper(curl, CURLOPT_CAINFO, tmp_ca_file->Path().c_str());
+    tls_ca_file = std::move_if_noexcept(tmp_ca_file);
+  }
 
   if (cert_source == CryptoSource::kPkcs11) {
     curlEasySetoptWrapper(curl, CURLOPT_SSLCERT, cert.c_str());
     curlEasySetoptWrapper(curl, CURLOPT_SSLCERTTYPE, "ENG");
+  } else if (in_memory_key) {
+    curlEasySetoptWrapper(curl, CURLOPT_SSLCERT, static_cast<const char*>(nullptr));
   } else {  // cert_source == CryptoSource::kFile
     std::unique_ptr<TemporaryFile> tmp_cert_file = std_::make_unique<TemporaryFile>("tls-cert");
     tmp_cert_file->PutContents(cert);
@@ -106,6 +244,8 @@ void HttpClient::setCerts(const std::string& ca, CryptoSource ca_source, const s
     curlEasySetoptWrapper(curl, CURLOPT_SSLENGINE_DEFAULT, 1L);
     curlEasySetoptWrapper(curl, CURLOPT_SSLKEY, pkey.c_str());
     curlEasySetoptWrapper(curl, CURLOPT_SSLKEYTYPE, "ENG");
+  } else if (in_memory_key) {
+    curlEasySetoptWrapper(curl, CURLOPT_SSLKEY, static_cast<const char*>(nullptr));
   } else {  // pkey_source == CryptoSource::kFile
     std::unique_ptr<TemporaryFile> tmp_pkey_file = std_::make_unique<TemporaryFile>("tls-pkey");
     tmp_pkey_file->PutContents(pkey);
@@ -192,6 +332,12 @@ HttpResponse HttpClient::perform(CURL* curl_handler, int retry_times, int64_t si
   long http_code;  // NOLINT(google-runtime-int)
   curl_easy_getinfo(curl_handler, CURLINFO_RESPONSE_CODE, &http_code);
   HttpResponse response(response_arg.out, http_code, result, (result != CURLE_OK) ? curl_easy_strerror(result) : "");
+#if LIBCURL_VERSION_NUM >= 0x074200  // CURLINFO_RETRY_AFTER appeared in 7.66.0
+  curl_off_t retry_after = 0;
+  if (curl_easy_getinfo(curl_handler, CURLINFO_RETRY_AFTER, &retry_after) == CURLE_OK && retry_after > 0) {
+    response.retry_after = std::chrono::seconds(retry_after);
+  }
+#endif
   if (response.curl_code != CURLE_OK || response.http_status_code >= 500) {
     std::ostringstream error_message;
     error_message << "curl error " << response.curl_code << " (http code " << response.http_status_code
@@ -54,7 +54,11 @@ class HttpClient : public HttpInterface {
   HttpResponse perform(CURL *curl_handler, int retry_times, int64_t size_limit);
   static curl_slist *curl_slist_dup(curl_slist *sl);
 
+  struct TlsCredentials;
   static CURLcode sslCtxFunction(CURL *handle, void *sslctx, void *parm);
+  // Shared by all the clients that use the same credentials, see setCerts().
+  std::shared_ptr<const TlsCredentials> tls_credentials_;
+  // Only used when curl cannot take the credentials from memory.
   std::unique_ptr<TemporaryFile> tls_ca_file;
   std::unique_ptr<TemporaryFile> tls_cert_file;
   std::unique_ptr<TemporaryFile> tls_pkey_file;
@@ -2,7 +2,9 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <chrono>
 #include <cstdlib>
+#include <thread>
 
 #include <boost/process.hpp>
 
@@ -14,6 +16,8 @@
 #include "utilities/utils.h"
 
 static std::string server = "http://127.0.0.1:";
+static std::string tls_server = "https://localhost:";
+static boost::filesystem::path certs_dir;
 
 TEST(CopyConstructorTest, copied) {
   HttpClient http;
@@ -115,17 +119,102 @@ TEST(Headers, update_header) {
   EXPECT_EQ(response["status"].asString(), "good");
 }
 
+static const char *const tls_server_crt = "tests/fake_http_server/server.crt";
+
+static void setClientCerts(HttpClient &http, const std::string &ca = Utils::readFile(tls_server_crt)) {
+  http.setCerts(ca, CryptoSource::kFile, Utils::readFile(certs_dir / "client.crt"), CryptoSource::kFile,
+                Utils::readFile(certs_dir / "client.key"), CryptoSource::kFile);
+}
+
+// tls_server.py serves the files of the working directory.
+static HttpResponse getFromTlsServer(HttpClient &http) {
+  return http.get(tls_server + "/" + tls_server_crt, HttpInterface::kNoLimit);
+}
+
+/* Authenticate with a client certificate that is issued by an intermediate
+ * CA, on a new connection and on a reused one. */
+TEST(TlsTest, client_cert) {
+  HttpClient http;
+  setClientCerts(http);
+  for (int i = 0; i < 2; ++i) {
+    const HttpResponse resp = getFromTlsServer(http);
+    EXPECT_TRUE(resp.isOk()) << resp.error_message;
+    EXPECT_EQ(resp.body, Utils::readFile(tls_server_crt));
+  }
+}
+
+/* A copy of a client keeps working with its credentials after the original is
+ * gone. */
+TEST(TlsTest, copied) {
+  auto http = std_::make_unique<HttpClient>();
+  setClientCerts(*http);
+  HttpClient http_copy(*http);
+  http.reset();
+  const HttpResponse resp = getFromTlsServer(http_copy);
+  EXPECT_TRUE(resp.isOk()) << resp.error_message;
+}
+
+/* Reject a server certificate that is not issued by the given CA. */
+TEST(TlsTest, wrong_ca) {
+  HttpClient http;
+  setClientCerts(http, Utils::readFile(certs_dir / "ca.crt"));
+  const HttpResponse resp = getFromTlsServer(http);
+  EXPECT_FALSE(resp.isOk());
+  EXPECT_NE(resp.curl_code, CURLE_OK);
+}
+
+/* The server rejects a client without a certificate. */
+TEST(TlsTest, no_client_cert) {
+  HttpClient http;
+  http.setCerts(Utils::readFile(tls_server_crt), CryptoSource::kFile, "", CryptoSource::kFile, "",
+                CryptoSource::kFile);
+  EXPECT_FALSE(getFromTlsServer(http).isOk());
+}
+
+/* Credentials that can not be parsed make the requests fail cleanly, and do
+ * not affect other clients. */
+TEST(TlsTest, garbage_pem) {
+  HttpClient http;
+  http.setCerts("garbage", CryptoSource::kFile, "-----BEGIN CERTIFICATE-----\ngarbage\n-----END CERTIFICATE-----\n",
+                CryptoSource::kFile, "garbage", CryptoSource::kFile);
+  const HttpResponse resp = getFromTlsServer(http);
+  EXPECT_FALSE(resp.isOk());
+  EXPECT_NE(resp.curl_code, CURLE_OK);
+
+  HttpClient good;
+  setClientCerts(good);
+  EXPECT_TRUE(getFromTlsServer(good).isOk());
+  EXPECT_FALSE(getFromTlsServer(http).isOk());
+}
+
 // TODO(OTA-4546): add tests for HttpClient::download
 
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
+  if (argc != 2) {
+    std::cerr << "Error: " << argv[0] << " requires the path to the directory with generated certificates.\n";
+    return EXIT_FAILURE;
+  }
+  certs_dir = argv[1];
 
   std::string port = TestUtils::getFreePort();
   server += port;
   boost::process::child server_process("tests/fake_http_server/fake_test_server.py", port, "-f");
   TestUtils::waitForServer(server + "/");
 
+  std::string tls_port = TestUtils::getFreePort();
+  tls_server += tls_port;
+  boost::process::child tls_server_process("tests/fake_http_server/tls_server.py", tls_port,
+                                           (certs_dir / "ca.crt").string());
+  // TestUtils::waitForServer() does not send a client certificate, which the
+  // server requires.
+  HttpClient tls_http;
+  setClientCerts(tls_http);
+  for (int i = 0; i < 50 && !getFromTlsServer(tls_http).isOk(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
   return RUN_ALL_TESTS();
 }
 #endif
@@ -1,6 +1,7 @@
 #ifndef HTTPINTERFACE_H_
 #define HTTPINTERFACE_H_
 
+#include <chrono>
 #include <future>
 #include <string>
 #include <utility>
@@ -26,6 +27,8 @@ struct HttpResponse {
   long http_status_code{0};  // NOLINT(google-runtime-int)
   CURLcode curl_code{CURLE_OK};
   std::string error_message;
+  // From the Retry-After header, zero if the server did not send one.
+  std::chrono::seconds retry_after{0};
   bool isOk() const { return (curl_code == CURLE_OK && http_status_code >= 200 && http_status_code < 400); }
   bool wasInterrupted() const { return curl_code == CURLE_ABORTED_BY_CALLBACK; };
   std::string getStatusStr() const {
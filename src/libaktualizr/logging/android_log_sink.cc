@@ -2,6 +2,8 @@
 #include <boost/log/core.hpp>
 #include <boost/log/sinks.hpp>
 
+#include "logging.h"
+
 namespace log = boost::log;
 
 class android_log_sink : public log::sinks::basic_sink_backend<log::sinks::synchronized_feeding> {
@@ -16,8 +18,16 @@ class android_log_sink : public log::sinks::basic_sink_backend<log::sinks::synch
   }
 };
 
-void logger_init_sink(bool use_colors = false) {
-  (void)use_colors;
+// logcat does its own buffering and formatting, the options do not apply.
+void logger_init_sink(const LogSinkOptions& options) {
+  (void)options;
   typedef log::sinks::synchronous_sink<android_log_sink> android_log_sink_t;
-  log::core::get()->add_sink(boost::shared_ptr<android_log_sink_t>(new android_log_sink_t()));
+  static boost::shared_ptr<android_log_sink_t> sink;
+  if (sink) {
+    log::core::get()->remove_sink(sink);
+  }
+  sink = boost::shared_ptr<android_log_sink_t>(new android_log_sink_t());
+  log::core::get()->add_sink(sink);
 }
+
+void logger_flush_sink() {}
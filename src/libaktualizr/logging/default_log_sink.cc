@@ -1,8 +1,23 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <string>
 
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/log/attributes/clock.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/unbounded_fifo_queue.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/log/utility/setup/console.hpp>
+
+#include "logging.h"
 
 static void color_fmt(boost::log::record_view const& rec, boost::log::formatting_ostream& strm) {
   auto severity = rec[boost::log::trivial::severity];
@@ -29,14 +44,194 @@ static void color_fmt(boost::log::record_view const& rec, boost::log::formatting
   }
 }
 
-void logger_init_sink(bool use_colors = false) {
+static void json_string(boost::log::formatting_ostream& strm, const std::string& value) {
+  strm << '"';
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        strm << "\\\"";
+        break;
+      case '\\':
+        strm << "\\\\";
+        break;
+      case '\n':
+        strm << "\\n";
+        break;
+      case '\r':
+        strm << "\\r";
+        break;
+      case '\t':
+        strm << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(c));
+          strm << escaped;
+        } else {
+          strm << c;
+        }
+    }
+  }
+  strm << '"';
+}
+
+static std::string json_time(boost::log::record_view const& rec) {
+  const auto timestamp = rec["TimeStamp"].extract<boost::posix_time::ptime>();
+  return timestamp ? boost::posix_time::to_iso_extended_string(timestamp.get()) + "Z" : std::string();
+}
+
+static void json_fmt(boost::log::record_view const& rec, boost::log::formatting_ostream& strm) {
+  strm << "{\"time\":";
+  json_string(strm, json_time(rec));
+  strm << ",\"level\":";
+  const auto severity = rec[boost::log::trivial::severity];
+  json_string(strm, severity ? boost::log::trivial::to_string(severity.get()) : "");
+  strm << ",\"message\":";
+  const auto message = rec[boost::log::expressions::smessage];
+  json_string(strm, message ? message.get() : std::string());
+  strm << '}';
+}
+
+/**
+ * Prints formatted records to a console stream. Identical consecutive
+ * messages are printed once per repeat window, followed by the number of
+ * times they were repeated.
+ *
+ * With the asynchronous frontend, the records are formatted as well as
+ * printed on its thread; only the message text is composed by the caller.
+ */
+class ConsoleBackend : public boost::log::sinks::basic_formatted_sink_backend<
+                           char, boost::log::sinks::combine_requirements<boost::log::sinks::synchronized_feeding,
+                                                                         boost::log::sinks::flushing>::type> {
+ public:
+  ConsoleBackend(std::ostream& stream, const int repeat_window_sec, const bool json)
+      : stream_(stream), repeat_window_(repeat_window_sec), json_(json) {}
+
+  void consume(const boost::log::record_view& rec, const string_type& formatted) {
+    if (repeat_window_.count() > 0) {
+      const auto now = std::chrono::steady_clock::now();
+      const auto message = rec[boost::log::expressions::smessage];
+      const auto severity = rec[boost::log::trivial::severity];
+      const std::string text = message ? message.get() : std::string();
+      const auto level = severity ? severity.get() : boost::log::trivial::info;
+      if (has_last_ && text == last_message_ && level == last_severity_ && now - last_printed_ < repeat_window_) {
+        ++repeats_;
+        last_repeat_time_ = json_time(rec);
+        return;
+      }
+      printRepeats();
+      has_last_ = true;
+      last_message_ = text;
+      last_severity_ = level;
+      last_printed_ = now;
+    }
+    stream_ << formatted << '\n';
+    stream_.flush();
+  }
+
+  void flush() {
+    printRepeats();
+    stream_.flush();
+  }
+
+ private:
+  void printRepeats() {
+    if (repeats_ == 0) {
+      return;
+    }
+    const std::string text = "last message repeated " + std::to_string(repeats_) + " times";
+    if (json_) {
+      // Time of the last repeat, as these are printed later.
+      stream_ << "{\"time\":\"" << last_repeat_time_ << "\",\"level\":\"" << last_severity_ << "\",\"message\":\""
+              << text << "\"}\n";
+    } else {
+      stream_ << text << '\n';
+    }
+    repeats_ = 0;
+  }
+
+  std::ostream& stream_;
+  const std::chrono::seconds repeat_window_;
+  const bool json_;
+  bool has_last_{false};
+  std::string last_message_;
+  boost::log::trivial::severity_level last_severity_{boost::log::trivial::info};
+  std::chrono::steady_clock::time_point last_printed_;
+  std::string last_repeat_time_;
+  uint64_t repeats_{0};
+};
+
+using SyncSink = boost::log::sinks::synchronous_sink<ConsoleBackend>;
+// Records are passed to the background thread through a lock-free queue.
+using AsyncSink = boost::log::sinks::asynchronous_sink<ConsoleBackend, boost::log::sinks::unbounded_fifo_queue>;
+
+static std::mutex gSinkMutex;
+static boost::shared_ptr<SyncSink> gSyncSink;
+static boost::shared_ptr<AsyncSink> gAsyncSink;
+
+void logger_flush_sink() {
+  std::lock_guard<std::mutex> guard(gSinkMutex);
+  if (gSyncSink) {
+    gSyncSink->flush();
+  }
+  if (gAsyncSink) {
+    gAsyncSink->flush();
+  }
+}
+
+static void remove_sink() {
+  auto core = boost::log::core::get();
+  if (gSyncSink) {
+    core->remove_sink(gSyncSink);
+    gSyncSink->flush();
+    gSyncSink.reset();
+  }
+  if (gAsyncSink) {
+    core->remove_sink(gAsyncSink);
+    gAsyncSink->stop();
+    gAsyncSink->flush();
+    gAsyncSink.reset();
+  }
+}
+
+static void remove_sink_at_exit() {
+  std::lock_guard<std::mutex> guard(gSinkMutex);
+  remove_sink();
+}
+
+void logger_init_sink(const LogSinkOptions& options) {
+  std::lock_guard<std::mutex> guard(gSinkMutex);
+  remove_sink();
+
   auto* stream = &std::cerr;
   if (getenv("LOG_STDERR") == nullptr) {
     stream = &std::cout;
   }
-  auto sink = boost::log::add_console_log(*stream, boost::log::keywords::format = "%Message%",
-                                          boost::log::keywords::auto_flush = true);
-  if (use_colors) {
-    sink->set_formatter(&color_fmt);
+  auto backend = boost::make_shared<ConsoleBackend>(*stream, options.repeat_window_sec, options.json);
+  boost::shared_ptr<boost::log::sinks::basic_formatting_sink_frontend<char>> frontend;
+  if (options.async) {
+    gAsyncSink = boost::make_shared<AsyncSink>(backend);
+    frontend = gAsyncSink;
+  } else {
+    gSyncSink = boost::make_shared<SyncSink>(backend);
+    frontend = gSyncSink;
+  }
+
+  if (options.json) {
+    boost::log::core::get()->add_global_attribute("TimeStamp", boost::log::attributes::utc_clock());
+    frontend->set_formatter(&json_fmt);
+  } else if (options.use_colors) {
+    frontend->set_formatter(&color_fmt);
+  } else {
+    frontend->set_formatter(boost::log::expressions::stream << boost::log::expressions::smessage);
+  }
+  boost::log::core::get()->add_sink(frontend);
+
+  // Records still queued for the background thread are printed at exit.
+  static bool registered = false;
+  if (!registered) {
+    registered = true;
+    std::atexit(remove_sink_at_exit);
   }
 }
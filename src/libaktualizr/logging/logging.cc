@@ -4,14 +4,21 @@ using boost::log::trivial::severity_level;
 
 static severity_level gLoggingThreshold;
 
-extern void logger_init_sink(bool use_colors = false);
+extern void logger_init_sink(const LogSinkOptions& options);
+extern void logger_flush_sink();
 
 int64_t get_curlopt_verbose() { return gLoggingThreshold <= boost::log::trivial::trace ? 1L : 0L; }
 
 void logger_init(bool use_colors) {
+  LogSinkOptions options;
+  options.use_colors = use_colors;
+  logger_init(options);
+}
+
+void logger_init(const LogSinkOptions& options) {
   gLoggingThreshold = boost::log::trivial::info;
 
-  logger_init_sink(use_colors);
+  logger_init_sink(options);
 
   boost::log::core::get()->set_filter(boost::log::trivial::severity >= gLoggingThreshold);
 }
@@ -34,6 +41,8 @@ void logger_set_threshold(const LoggerConfig& lconfig) {
   logger_set_threshold(static_cast<boost::log::trivial::severity_level>(loglevel));
 }
 
+void logger_flush() { logger_flush_sink(); }
+
 void logger_set_enable(bool enabled) { boost::log::core::get()->set_logging_enabled(enabled); }
 
 int loggerGetSeverity() { return static_cast<int>(gLoggingThreshold); }
@@ -30,8 +30,30 @@
 // curl_easy_setopt(curl_handle, CURLOPT_VERBOSE, get_curlopt_verbose());
 int64_t get_curlopt_verbose();
 
+/** Options of the sink that prints the log to the console. */
+struct LogSinkOptions {
+  bool use_colors{false};
+  /** Print the records on a background thread, so that logging does not
+   * wait for the console. Records wait in memory for as long as the console
+   * does not keep up, so this is meant for short-lived tools. Records still
+   * waiting when the process exits normally are printed then; they are lost
+   * if it crashes. */
+  bool async{false};
+  /** Print every record as a JSON object on a line of its own. */
+  bool json{false};
+  /** Print identical consecutive messages only once per this many seconds,
+   * followed by the number of repeats. 0 prints them all. */
+  int repeat_window_sec{0};
+};
+
 void logger_init(bool use_colors = false);
 
+/** (Re)initialize the log sink, replacing the one that was set up before. */
+void logger_init(const LogSinkOptions& options);
+
+/** Wait until all the records logged so far have been printed. */
+void logger_flush();
+
 void logger_set_threshold(boost::log::trivial::severity_level threshold);
 
 void logger_set_threshold(const LoggerConfig& lconfig);
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "logging/logging.h"
+
+static std::vector<std::string> lines(const std::string& output) {
+  std::vector<std::string> result;
+  std::istringstream stream(output);
+  std::string line;
+  while (std::getline(stream, line)) {
+    result.push_back(line);
+  }
+  return result;
+}
+
+static Json::Value parse(const std::string& line) {
+  Json::Value value;
+  Json::Reader reader;
+  EXPECT_TRUE(reader.parse(line, value)) << line;
+  return value;
+}
+
+/*
+ * Escape quotes, backslashes and control characters in JSON records.
+ */
+TEST(Logging, JsonEscaping) {
+  LogSinkOptions options;
+  options.json = true;
+  logger_init(options);
+
+  const std::string message = "say \"hi\" C:\\dir\nnext\tline\r\x01\x1f";
+  testing::internal::CaptureStdout();
+  LOG_WARNING << message;
+  logger_flush();
+  const std::vector<std::string> output = lines(testing::internal::GetCapturedStdout());
+
+  ASSERT_EQ(output.size(), 1);
+  EXPECT_NE(output[0].find("\\u0001\\u001f"), std::string::npos);
+  const Json::Value record = parse(output[0]);
+  EXPECT_EQ(record["level"].asString(), "warning");
+  EXPECT_EQ(record["message"].asString(), message);
+  EXPECT_FALSE(record["time"].asString().empty());
+}
+
+/*
+ * Print identical consecutive messages once, followed by the number of
+ * repeats when a different message comes in.
+ */
+TEST(Logging, RepeatSuppression) {
+  LogSinkOptions options;
+  options.repeat_window_sec = 60;
+  logger_init(options);
+
+  testing::internal::CaptureStdout();
+  for (int i = 0; i < 5; ++i) {
+    LOG_INFO << "same";
+  }
+  LOG_INFO << "other";
+  LOG_INFO << "other";
+  LOG_ERROR << "other";
+  logger_flush();
+  const std::vector<std::string> output = lines(testing::internal::GetCapturedStdout());
+
+  const std::vector<std::string> expected = {"same", "last message repeated 4 times", "other",
+                                             "last message repeated 1 times", "other"};
+  EXPECT_EQ(output, expected);
+}
+
+/*
+ * Print the pending repeats as a JSON record when the log is flushed.
+ */
+TEST(Logging, RepeatSuppressionJson) {
+  LogSinkOptions options;
+  options.json = true;
+  options.repeat_window_sec = 60;
+  logger_init(options);
+
+  testing::internal::CaptureStdout();
+  for (int i = 0; i < 3; ++i) {
+    LOG_INFO << "same";
+  }
+  logger_flush();
+  const std::vector<std::string> output = lines(testing::internal::GetCapturedStdout());
+
+  ASSERT_EQ(output.size(), 2);
+  EXPECT_EQ(parse(output[0])["message"].asString(), "same");
+  const Json::Value repeats = parse(output[1]);
+  EXPECT_EQ(repeats["level"].asString(), "info");
+  EXPECT_EQ(repeats["message"].asString(), "last message repeated 2 times");
+  EXPECT_FALSE(repeats["time"].asString().empty());
+}
+
+/*
+ * Print all the records queued for the background thread when flushing.
+ */
+TEST(Logging, AsyncFlush) {
+  LogSinkOptions options;
+  options.async = true;
+  logger_init(options);
+
+  testing::internal::CaptureStdout();
+  for (int i = 0; i < 1000; ++i) {
+    LOG_INFO << "record " << i;
+  }
+  logger_flush();
+  const std::vector<std::string> output = lines(testing::internal::GetCapturedStdout());
+
+  ASSERT_EQ(output.size(), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(output[static_cast<size_t>(i)], "record " + std::to_string(i));
+  }
+}
+
+/*
+ * Print the records still queued for the background thread when the
+ * process exits.
+ */
+TEST(Logging, AsyncFlushAtExit) {
+  EXPECT_EXIT(
+      {
+        setenv("LOG_STDERR", "1", 1);
+        LogSinkOptions options;
+        options.async = true;
+        logger_init(options);
+        for (int i = 0; i < 1000; ++i) {
+          LOG_INFO << "record " << i;
+        }
+        LOG_INFO << "last words";
+        std::exit(0);
+      },
+      ::testing::ExitedWithCode(0), "record 999\nlast words");
+}
+
+/*
+ * Replace the sink when initializing the log again, printing the records
+ * queued for the old one first.
+ */
+TEST(Logging, ReplaceSink) {
+  LogSinkOptions options;
+  options.async = true;
+  options.json = true;
+  logger_init(options);
+
+  testing::internal::CaptureStdout();
+  for (int i = 0; i < 100; ++i) {
+    LOG_INFO << "queued";
+  }
+  logger_init(LogSinkOptions());
+  LOG_INFO << "replaced";
+  logger_flush();
+  const std::vector<std::string> output = lines(testing::internal::GetCapturedStdout());
+
+  ASSERT_EQ(output.size(), 101);
+  EXPECT_EQ(parse(output[99])["message"].asString(), "queued");
+  EXPECT_EQ(output[100], "replaced");
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
+#endif
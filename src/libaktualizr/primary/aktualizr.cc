@@ -14,7 +14,11 @@ Aktualizr::Aktualizr(const Config &config)
     : Aktualizr(config, INvStorage::newStorage(config.storage), std::make_shared<HttpClient>()) {}
 
 Aktualizr::Aktualizr(Config config, std::shared_ptr<INvStorage> storage_in, std::shared_ptr<HttpInterface> http_in)
-    : config_{std::move(config)}, sig_{new event::Channel()} {
+    : config_{std::move(config)},
+      sig_{new event::Channel()},
+      events_{std::make_shared<event::Dispatcher>(sig_)},
+      polling_{std::chrono::seconds(config_.uptane.polling_sec), std::chrono::seconds(config_.uptane.polling_max_sec),
+               static_cast<unsigned int>(config_.uptane.polling_jitter_percent)} {
   if (sodium_init() == -1) {  // Note that sodium_init doesn't require a matching 'sodium_deinit'
     throw std::runtime_error("Unable to initialize libsodium");
   }
@@ -22,11 +26,23 @@ Aktualizr::Aktualizr(Config config, std::shared_ptr<INvStorage> storage_in, std:
   storage_ = std::move(storage_in);
   storage_->importData(config_.import);
 
-  uptane_client_ = std::make_shared<SotaUptaneClient>(config_, storage_, http_in, sig_);
+  uptane_client_ = std::make_shared<SotaUptaneClient>(config_, storage_, http_in, events_);
+}
+
+template <class R, class... Args>
+std::function<R(Args...)> Aktualizr::flushingEvents(std::function<R(Args...)> task) {
+  return [this, task](Args... args) -> R {
+    struct Flush {
+      ~Flush() { events.flush(); }
+      event::Dispatcher &events;
+    } flush{*events_};
+    return task(args...);
+  };
 }
 
 void Aktualizr::Initialize() {
   uptane_client_->initialize();
+  events_->flush();
   api_queue_.run();
 }
 
@@ -34,6 +50,10 @@ bool Aktualizr::IsRegistered() const { return storage_->loadEcuRegistered(); }
 
 bool Aktualizr::UptaneCycle() {
   result::UpdateCheck update_result = CheckUpdates().get();
+  // Pending updates are reported as an error too, but do not involve the server.
+  const bool check_failed =
+      update_result.status == result::UpdateStatus::kError && !uptane_client_->hasPendingUpdates();
+  polling_.checkDone(!check_failed, uptane_client_->serverRetryAfter());
   if (update_result.updates.empty()) {
     if (update_result.status == result::UpdateStatus::kError) {
       // If the metadata verification failed, inform the backend immediately.
@@ -62,7 +82,7 @@ bool Aktualizr::UptaneCycle() {
 
   if (!uptane_client_->hasPendingUpdates()) {
     // If updates were applied and no any reboot/finalization is required then send/put manifest
-    // as soon as possible, don't wait for config_.uptane.polling_sec
+    // as soon as possible, don't wait for the next poll
     SendManifest().get();
   }
 
@@ -71,6 +91,14 @@ bool Aktualizr::UptaneCycle() {
 
 std::future<void> Aktualizr::RunForever() {
   std::future<void> future = std::async(std::launch::async, [&]() {
+    {
+      // Devices that are started together, e.g. after a power outage, do
+      // not all contact the server at once.
+      std::unique_lock<std::mutex> l(exit_cond_.m);
+      if (exit_cond_.cv.wait_for(l, polling_.initialDelay(), [this] { return exit_cond_.flag; })) {
+        return;
+      }
+    }
     SendDeviceData().get();
 
     std::unique_lock<std::mutex> l(exit_cond_.m);
@@ -79,8 +107,7 @@ std::future<void> Aktualizr::RunForever() {
         break;
       }
 
-      if (exit_cond_.cv.wait_for(l, std::chrono::seconds(config_.uptane.polling_sec),
-                                 [this] { return exit_cond_.flag; })) {
+      if (exit_cond_.cv.wait_for(l, polling_.nextDelay(), [this] { return exit_cond_.flag; })) {
         break;
       }
     }
@@ -114,7 +141,7 @@ std::vector<SecondaryInfo> Aktualizr::GetSecondaries() const {
 
 std::future<result::CampaignCheck> Aktualizr::CampaignCheck() {
   std::function<result::CampaignCheck()> task([this] { return uptane_client_->campaignCheck(); });
-  return api_queue_.enqueue(task);
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kControlLane);
 }
 
 std::future<void> Aktualizr::CampaignControl(const std::string &campaign_id, campaign::Cmd cmd) {
@@ -133,33 +160,35 @@ std::future<void> Aktualizr::CampaignControl(const std::string &campaign_id, cam
         break;
     }
   });
-  return api_queue_.enqueue(task);
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kControlLane);
 }
 
 std::future<void> Aktualizr::SendDeviceData() {
   std::function<void()> task([this] { uptane_client_->sendDeviceData(); });
-  return api_queue_.enqueue(task);
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kMetadataLane);
 }
 
 std::future<result::UpdateCheck> Aktualizr::CheckUpdates() {
   std::function<result::UpdateCheck()> task([this] { return uptane_client_->fetchMeta(); });
-  return api_queue_.enqueue(task);
+  // Replaces the metadata that downloads and installations check targets against.
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kMetadataLane | api::CommandQueue::kTransferLane);
 }
 
 std::future<result::Download> Aktualizr::Download(const std::vector<Uptane::Target> &updates) {
   std::function<result::Download(const api::FlowControlToken *)> task(
       [this, updates](const api::FlowControlToken *token) { return uptane_client_->downloadImages(updates, token); });
-  return api_queue_.enqueue(task);
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kTransferLane);
 }
 
 std::future<result::Install> Aktualizr::Install(const std::vector<Uptane::Target> &updates) {
   std::function<result::Install()> task([this, updates] { return uptane_client_->uptaneInstall(updates); });
-  return api_queue_.enqueue(task);
+  // Manifests are not assembled while the ECUs are being updated.
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kTransferLane | api::CommandQueue::kMetadataLane);
 }
 
 std::future<bool> Aktualizr::SendManifest(const Json::Value &custom) {
   std::function<bool()> task([this, custom]() { return uptane_client_->putManifest(custom); });
-  return api_queue_.enqueue(task);
+  return api_queue_.enqueue(flushingEvents(task), api::CommandQueue::kMetadataLane);
 }
 
 result::Pause Aktualizr::Pause() {
@@ -7,7 +7,9 @@
 #include <boost/signals2.hpp>
 
 #include "config/config.h"
+#include "primary/event_dispatcher.h"
 #include "primary/events.h"
+#include "primary/polling_scheduler.h"
 #include "sotauptaneclient.h"
 #include "storage/invstorage.h"
 #include "uptane/secondaryinterface.h"
@@ -16,6 +18,11 @@
 /**
  * This class provides the main APIs necessary for launching and controlling
  * libaktualizr.
+ *
+ * The asynchronous calls are run in the background in the order they are
+ * made, except that campaign calls, and manifests or device data sent during
+ * a download, do not wait for the calls that are unrelated to them. Update
+ * checks, downloads and installations always run one after the other.
  */
 class Aktualizr {
  public:
@@ -39,6 +46,8 @@ class Aktualizr {
 
   /**
    * Asynchronously run aktualizr indefinitely until Shutdown is called.
+   * Updates are checked about every `uptane.polling_sec` seconds, less often
+   * after failed checks or when the server asks for it.
    * @return Empty std::future object
    */
   std::future<void> RunForever();
@@ -161,15 +170,15 @@ class Aktualizr {
   /**
    * Resume the library operations.
    * Target downloads will resume and API calls issued during the pause will
-   * execute in fifo order.
+   * execute in the order described above.
    *
    * @return Information about resume results.
    */
   result::Pause Resume();
 
   /**
-   * Aborts the currently running command, if it can be aborted, or waits for it
-   * to finish; then removes all other queued calls.
+   * Aborts the currently running commands, if they can be aborted, or waits
+   * for them to finish; then removes all other queued calls.
    * This doesn't reset the `Paused` state, i.e. if the queue was previously
    * paused, it will remain paused, but with an emptied queue.
    * The call is blocking.
@@ -210,6 +219,11 @@ class Aktualizr {
 
   /**
    * Provide a function to receive event notifications.
+   * The handlers are called one event at a time on a thread of the library,
+   * so that slow handlers do not delay updates. Download progress reports
+   * can be merged or dropped if the handlers do not keep up; other events
+   * are all delivered in order, and those sent by a call before its future
+   * is ready.
    * @param handler a function that can receive event objects.
    * @return a signal connection object, which can be disconnected if desired.
    */
@@ -230,9 +244,15 @@ class Aktualizr {
     bool flag = false;
   } exit_cond_;
 
+  // Wraps a command so that its future is only ready once the events it sent have been delivered.
+  template <class R, class... Args>
+  std::function<R(Args...)> flushingEvents(std::function<R(Args...)> task);
+
   std::shared_ptr<INvStorage> storage_;
   std::shared_ptr<event::Channel> sig_;
+  std::shared_ptr<event::Dispatcher> events_;
   api::CommandQueue api_queue_;
+  PollingScheduler polling_;
 };
 
 #endif  // AKTUALIZR_H_
@@ -0,0 +1,86 @@
+#include "event_dispatcher.h"
+
+#include <exception>
+#include <utility>
+
+#include "logging/logging.h"
+
+namespace event {
+
+const size_t Dispatcher::kDefaultCapacity = 1024;
+
+Dispatcher::Dispatcher(std::shared_ptr<Channel> channel, const size_t capacity)
+    : channel_(std::move(channel)), capacity_(capacity > 0 ? capacity : 1) {
+  thread_ = std::thread([this] { run(); });
+}
+
+Dispatcher::~Dispatcher() {
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  // The events still in the queue are delivered before the thread ends.
+  thread_.join();
+}
+
+void Dispatcher::post(std::shared_ptr<BaseEvent> event) {
+  std::unique_lock<std::mutex> lock(m_);
+  if (event->isTypeOf<DownloadProgressReport>() &&
+      !DownloadProgressReport::isDownloadCompleted(static_cast<const DownloadProgressReport &>(*event))) {
+    const auto &report = static_cast<const DownloadProgressReport &>(*event);
+    if (!queue_.empty() && queue_.back()->isTypeOf<DownloadProgressReport>()) {
+      const auto &last = static_cast<const DownloadProgressReport &>(*queue_.back());
+      if (!DownloadProgressReport::isDownloadCompleted(last) && last.target.filename() == report.target.filename()) {
+        queue_.back() = std::move(event);
+        return;
+      }
+    }
+    if (queue_.size() >= capacity_) {
+      return;
+    }
+  }
+
+  // An event sent from a handler cannot wait for the handlers to make room.
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    cv_.wait(lock, [this] { return queue_.size() < capacity_ || shutdown_; });
+  }
+  queue_.push_back(std::move(event));
+  ++posted_;
+  lock.unlock();
+  cv_.notify_all();
+}
+
+void Dispatcher::flush() {
+  std::unique_lock<std::mutex> lock(m_);
+  if (std::this_thread::get_id() == thread_.get_id()) {
+    return;
+  }
+  const uint64_t posted = posted_;
+  cv_.wait(lock, [this, posted] { return delivered_ >= posted; });
+}
+
+void Dispatcher::run() {
+  std::unique_lock<std::mutex> lock(m_);
+  for (;;) {
+    cv_.wait(lock, [this] { return !queue_.empty() || shutdown_; });
+    if (queue_.empty()) {
+      break;
+    }
+    std::shared_ptr<BaseEvent> event = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    // Someone may be waiting for room in the queue.
+    cv_.notify_all();
+    try {
+      (*channel_)(event);
+    } catch (const std::exception &e) {
+      LOG_ERROR << "Handler of " << event->variant << " event failed: " << e.what();
+    }
+    lock.lock();
+    ++delivered_;
+    cv_.notify_all();
+  }
+}
+
+}  // namespace event
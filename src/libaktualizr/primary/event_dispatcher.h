@@ -0,0 +1,65 @@
+#ifndef PRIMARY_EVENT_DISPATCHER_H_
+#define PRIMARY_EVENT_DISPATCHER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "primary/events.h"
+
+namespace event {
+
+/**
+ * Delivers events to the handlers of a Channel on a thread of its own, so
+ * that slow handlers do not hold up the code that sends the events. Events
+ * are delivered in the order they were posted.
+ *
+ * At most `capacity` events wait for delivery. Download progress reports
+ * are the only events that come in at a high rate and that only matter until
+ * the next one, so:
+ * - a progress report replaces the one that was posted just before it for
+ *   the same target, if that one is still waiting;
+ * - a progress report is dropped if the queue is full.
+ * Other events, and the report of a completed download, wait for room in
+ * the queue and are never dropped.
+ */
+class Dispatcher {
+ public:
+  static const size_t kDefaultCapacity;
+
+  explicit Dispatcher(std::shared_ptr<Channel> channel, size_t capacity = kDefaultCapacity);
+  ~Dispatcher();
+  Dispatcher(const Dispatcher &) = delete;
+  Dispatcher &operator=(const Dispatcher &) = delete;
+
+  void post(std::shared_ptr<BaseEvent> event);
+
+  /**
+   * Wait until all the events posted so far have been delivered, or replaced
+   * or dropped as described above. Returns at once when called from an event
+   * handler.
+   */
+  void flush();
+
+ private:
+  void run();
+
+  std::shared_ptr<Channel> channel_;
+  const size_t capacity_;
+  std::deque<std::shared_ptr<BaseEvent>> queue_;
+  // Events that were queued, and that were taken out of the queue and delivered.
+  uint64_t posted_{0};
+  uint64_t delivered_{0};
+  bool shutdown_{false};
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+}  // namespace event
+
+#endif  // PRIMARY_EVENT_DISPATCHER_H_
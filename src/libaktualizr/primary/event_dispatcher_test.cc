@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "primary/event_dispatcher.h"
+
+namespace {
+
+// Records the events it gets, and can be held up until released.
+class Recorder {
+ public:
+  explicit Recorder(event::Channel &channel) : released_(release_.get_future()) {
+    channel.connect([this](const std::shared_ptr<event::BaseEvent> &event) {
+      if (hold_) {
+        released_.wait();
+      }
+      std::lock_guard<std::mutex> guard(m_);
+      events_.push_back(event);
+    });
+  }
+  void hold() { hold_ = true; }
+  void release() { release_.set_value(); }
+  std::vector<std::shared_ptr<event::BaseEvent>> events() {
+    std::lock_guard<std::mutex> guard(m_);
+    return events_;
+  }
+
+ private:
+  std::atomic_bool hold_{false};
+  std::promise<void> release_;
+  std::shared_future<void> released_;
+  std::mutex m_;
+  std::vector<std::shared_ptr<event::BaseEvent>> events_;
+};
+
+std::shared_ptr<event::BaseEvent> progress(const std::string &filename, unsigned int value) {
+  Json::Value target_json;
+  target_json["length"] = 0;
+  return std::make_shared<event::DownloadProgressReport>(Uptane::Target(filename, target_json), "", value);
+}
+
+unsigned int progressOf(const std::shared_ptr<event::BaseEvent> &event) {
+  return std::static_pointer_cast<event::DownloadProgressReport>(event)->progress;
+}
+
+}  // namespace
+
+/* Events are delivered in order, and flush() waits for them. */
+TEST(EventDispatcher, Order) {
+  auto channel = std::make_shared<event::Channel>();
+  Recorder recorder(*channel);
+  event::Dispatcher dispatcher(channel);
+  for (int i = 0; i < 100; ++i) {
+    dispatcher.post(std::make_shared<event::PutManifestComplete>(i % 2 == 0));
+  }
+  dispatcher.post(std::make_shared<event::SendDeviceDataComplete>());
+  dispatcher.flush();
+
+  const auto events = recorder.events();
+  ASSERT_EQ(events.size(), 101);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(events[i]->isTypeOf<event::PutManifestComplete>());
+    EXPECT_EQ(std::static_pointer_cast<event::PutManifestComplete>(events[i])->success, i % 2 == 0);
+  }
+  EXPECT_TRUE(events[100]->isTypeOf<event::SendDeviceDataComplete>());
+}
+
+/* Progress reports that wait for delivery are replaced by newer ones for the
+ * same target, but completed downloads and other events are kept. */
+TEST(EventDispatcher, CoalesceProgress) {
+  auto channel = std::make_shared<event::Channel>();
+  Recorder recorder(*channel);
+  recorder.hold();
+  event::Dispatcher dispatcher(channel);
+  // Held up in the handler.
+  dispatcher.post(std::make_shared<event::SendDeviceDataComplete>());
+  dispatcher.post(progress("a", 10));
+  dispatcher.post(progress("a", 20));
+  dispatcher.post(progress("b", 30));
+  dispatcher.post(progress("b", 40));
+  dispatcher.post(progress("b", 100));
+  dispatcher.post(progress("b", 50));
+  recorder.release();
+  dispatcher.flush();
+
+  const auto events = recorder.events();
+  ASSERT_EQ(events.size(), 5);
+  EXPECT_TRUE(events[0]->isTypeOf<event::SendDeviceDataComplete>());
+  EXPECT_EQ(progressOf(events[1]), 20);
+  EXPECT_EQ(progressOf(events[2]), 40);
+  EXPECT_EQ(progressOf(events[3]), 100);
+  EXPECT_EQ(progressOf(events[4]), 50);
+}
+
+/* Progress reports are dropped when the queue is full, other events wait. */
+TEST(EventDispatcher, Full) {
+  auto channel = std::make_shared<event::Channel>();
+  Recorder recorder(*channel);
+  recorder.hold();
+  event::Dispatcher dispatcher(channel, 2);
+  dispatcher.post(std::make_shared<event::SendDeviceDataComplete>());
+  dispatcher.post(std::make_shared<event::PutManifestComplete>(true));
+  dispatcher.post(std::make_shared<event::PutManifestComplete>(false));
+  // The queue is full, whether or not the first event was taken out of it.
+  dispatcher.post(progress("a", 10));
+
+  auto blocked = std::async(std::launch::async, [&dispatcher] {
+    dispatcher.post(std::make_shared<event::SendDeviceDataComplete>());
+  });
+  EXPECT_EQ(blocked.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+  recorder.release();
+  blocked.get();
+  dispatcher.flush();
+
+  const auto events = recorder.events();
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_TRUE(events[0]->isTypeOf<event::SendDeviceDataComplete>());
+  EXPECT_TRUE(events[1]->isTypeOf<event::PutManifestComplete>());
+  EXPECT_TRUE(events[2]->isTypeOf<event::PutManifestComplete>());
+  EXPECT_TRUE(events[3]->isTypeOf<event::SendDeviceDataComplete>());
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
@@ -0,0 +1,43 @@
+#include "polling_scheduler.h"
+
+#include <algorithm>
+
+const std::chrono::seconds PollingScheduler::kMaxServerDelay{24 * 3600};
+
+PollingScheduler::PollingScheduler(const std::chrono::seconds interval, const std::chrono::seconds max_interval,
+                                   const unsigned int jitter_percent, const std::mt19937::result_type seed)
+    : interval_(interval),
+      max_interval_(std::max(interval, max_interval)),
+      jitter_(std::min(jitter_percent, 100U) / 100.0),
+      random_(seed) {}
+
+void PollingScheduler::checkDone(const bool success, const std::chrono::seconds server_delay) {
+  std::lock_guard<std::mutex> guard(m_);
+  if (success) {
+    failures_ = 0;
+  } else {
+    ++failures_;
+  }
+  server_delay_ = std::min(std::max(server_delay, std::chrono::seconds(0)), kMaxServerDelay);
+}
+
+std::chrono::milliseconds PollingScheduler::initialDelay() {
+  std::lock_guard<std::mutex> guard(m_);
+  std::uniform_real_distribution<double> jitter(0.0, jitter_);
+  return std::chrono::milliseconds(
+      static_cast<std::chrono::milliseconds::rep>(static_cast<double>(interval_.count()) * jitter(random_)));
+}
+
+std::chrono::milliseconds PollingScheduler::nextDelay() {
+  std::lock_guard<std::mutex> guard(m_);
+  std::chrono::milliseconds base = interval_;
+  for (unsigned int i = 0; i < failures_ && base < max_interval_; ++i) {
+    base *= 2;
+  }
+  base = std::min(base, max_interval_);
+
+  std::uniform_real_distribution<double> jitter(-jitter_, jitter_);
+  const auto delay = std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(
+      static_cast<double>(base.count()) * (1.0 + jitter(random_))));
+  return std::max(delay, server_delay_);
+}
@@ -0,0 +1,56 @@
+#ifndef PRIMARY_POLLING_SCHEDULER_H_
+#define PRIMARY_POLLING_SCHEDULER_H_
+
+#include <chrono>
+#include <mutex>
+#include <random>
+
+/**
+ * Decides how long Aktualizr::RunForever() waits between two update checks.
+ *
+ * Every wait is randomly lengthened or shortened by up to a percentage of
+ * the polling interval, so that devices which were started at the same time
+ * drift apart instead of polling the server all at once. The interval is
+ * doubled after each failed check, up to a maximum, and reset by the next
+ * successful one. A delay requested by the server is always waited out.
+ * The first check is also put off by a random part of the jitter.
+ */
+class PollingScheduler {
+ public:
+  /**
+   * A server that asks for a longer delay than this is assumed to be
+   * misconfigured.
+   */
+  static const std::chrono::seconds kMaxServerDelay;
+
+  PollingScheduler(std::chrono::seconds interval, std::chrono::seconds max_interval, unsigned int jitter_percent,
+                   std::mt19937::result_type seed = std::random_device{}());
+
+  /**
+   * Record the outcome of an update check, with the delay the server asked
+   * for, or zero if it did not.
+   */
+  void checkDone(bool success, std::chrono::seconds server_delay);
+
+  /**
+   * The time to wait before the first update check, between zero and the
+   * jitter percentage of the interval.
+   */
+  std::chrono::milliseconds initialDelay();
+
+  /**
+   * The time to wait before the next update check.
+   */
+  std::chrono::milliseconds nextDelay();
+
+ private:
+  const std::chrono::milliseconds interval_;
+  const std::chrono::milliseconds max_interval_;
+  const double jitter_;
+  std::mutex m_;
+  std::mt19937 random_;
+  unsigned int failures_{0};
+  std::chrono::milliseconds server_delay_{0};
+};
+
+#endif  // PRIMARY_POLLING_SCHEDULER_H_
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+
+#include "primary/polling_scheduler.h"
+
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+/* Waits are spread around the interval, within the jitter. */
+TEST(PollingScheduler, Jitter) {
+  PollingScheduler scheduler(seconds(100), seconds(3600), 10, 42);
+  std::set<milliseconds::rep> delays;
+  for (int i = 0; i < 100; ++i) {
+    const milliseconds delay = scheduler.nextDelay();
+    EXPECT_GE(delay, milliseconds(90000));
+    EXPECT_LE(delay, milliseconds(110000));
+    delays.insert(delay.count());
+  }
+  EXPECT_GT(delays.size(), 50);
+
+  PollingScheduler fixed(seconds(100), seconds(3600), 0);
+  EXPECT_EQ(fixed.nextDelay(), milliseconds(100000));
+}
+
+/* The first check is put off by up to the jitter. */
+TEST(PollingScheduler, InitialDelay) {
+  PollingScheduler scheduler(seconds(100), seconds(3600), 10, 42);
+  std::set<milliseconds::rep> delays;
+  for (int i = 0; i < 100; ++i) {
+    const milliseconds delay = scheduler.initialDelay();
+    EXPECT_GE(delay, milliseconds(0));
+    EXPECT_LE(delay, milliseconds(10000));
+    delays.insert(delay.count());
+  }
+  EXPECT_GT(delays.size(), 50);
+
+  PollingScheduler fixed(seconds(100), seconds(3600), 0);
+  EXPECT_EQ(fixed.initialDelay(), milliseconds(0));
+}
+
+/* The interval doubles after each failed check up to the maximum, and is
+ * reset by a successful one. */
+TEST(PollingScheduler, Backoff) {
+  PollingScheduler scheduler(seconds(10), seconds(60), 0);
+  scheduler.checkDone(false, seconds(0));
+  EXPECT_EQ(scheduler.nextDelay(), milliseconds(20000));
+  scheduler.checkDone(false, seconds(0));
+  EXPECT_EQ(scheduler.nextDelay(), milliseconds(40000));
+  for (int i = 0; i < 100; ++i) {
+    scheduler.checkDone(false, seconds(0));
+  }
+  EXPECT_EQ(scheduler.nextDelay(), milliseconds(60000));
+  scheduler.checkDone(true, seconds(0));
+  EXPECT_EQ(scheduler.nextDelay(), milliseconds(10000));
+
+  // A maximum below the interval does not shorten it.
+  PollingScheduler short_max(seconds(10), seconds(5), 0);
+  short_max.checkDone(false, seconds(0));
+  EXPECT_EQ(short_max.nextDelay(), milliseconds(10000));
+}
+
+/* The delay requested by the server is waited out, within reason. */
+TEST(PollingScheduler, ServerDelay) {
+  PollingScheduler scheduler(seconds(10), seconds(60), 10);
+  scheduler.checkDone(true, seconds(600));
+  EXPECT_EQ(scheduler.nextDelay(), milliseconds(600000));
+  scheduler.checkDone(false, seconds(1));
+  EXPECT_LE(scheduler.nextDelay(), milliseconds(22000));
+  scheduler.checkDone(true, seconds(365 * 24 * 3600));
+  EXPECT_EQ(scheduler.nextDelay(), PollingScheduler::kMaxServerDelay);
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
@@ -1,6 +1,5 @@
 #include "sotauptaneclient.h"
 
-#include <fnmatch.h>
 #include <unistd.h>
 #include <memory>
 #include <utility>
@@ -15,15 +14,6 @@
 #include "utilities/fault_injection.h"
 #include "utilities/utils.h"
 
-static void report_progress_cb(event::Channel *channel, const Uptane::Target &target, const std::string &description,
-                               unsigned int progress) {
-  if (channel == nullptr) {
-    return;
-  }
-  auto event = std::make_shared<event::DownloadProgressReport>(target, description, progress);
-  (*channel)(event);
-}
-
 void SotaUptaneClient::addSecondary(const std::shared_ptr<Uptane::SecondaryInterface> &sec) {
   Uptane::EcuSerial serial = sec->getSerial();
 
@@ -225,6 +215,15 @@ Json::Value SotaUptaneClient::AssembleManifest() {
   }
   version_manifest[primary_ecu_serial.ToString()] = uptane_manifest->sign(primary_manifest, report_counter);
 
+  // Secondaries are asked for their manifests one after the other, but the
+  // signatures are all checked at once.
+  struct SecondaryManifest {
+    Uptane::EcuSerial ecu_serial;
+    Uptane::Manifest manifest;
+    bool from_cache;
+    PublicKey key;
+  };
+  std::vector<SecondaryManifest> secondary_manifests;
   for (auto it = secondaries.begin(); it != secondaries.end(); it++) {
     const Uptane::EcuSerial &ecu_serial = it->first;
     Uptane::Manifest secmanifest = it->second->getManifest();
@@ -241,15 +240,26 @@ Json::Value SotaUptaneClient::AssembleManifest() {
         LOG_ERROR << "Could not fetch a valid secondary manifest from cache";
       }
     }
+    secondary_manifests.push_back(SecondaryManifest{ecu_serial, secmanifest, from_cache, it->second->getPublicKey()});
+  }
 
-    if (secmanifest.verifySignature(it->second->getPublicKey())) {
-      version_manifest[ecu_serial.ToString()] = secmanifest;
-      if (!from_cache) {
-        storage->storeCachedEcuManifest(ecu_serial, Utils::jsonToCanonicalStr(secmanifest));
+  std::vector<std::pair<const Uptane::Manifest *, const PublicKey *>> signed_by;
+  for (const SecondaryManifest &secondary : secondary_manifests) {
+    signed_by.emplace_back(&secondary.manifest, &secondary.key);
+  }
+  const std::vector<bool> valid = Uptane::Manifest::verifySignatures(signed_by);
+
+  for (size_t i = 0; i < secondary_manifests.size(); ++i) {
+    const SecondaryManifest &secondary = secondary_manifests[i];
+    if (valid[i]) {
+      version_manifest[secondary.ecu_serial.ToString()] = secondary.manifest;
+      if (!secondary.from_cache) {
+        storage->storeCachedEcuManifest(secondary.ecu_serial, Utils::jsonToCanonicalStr(secondary.manifest));
       }
     } else {
       // TODO(OTA-4305): send a corresponding event/report in this case
-      LOG_ERROR << "Secondary manifest is corrupted or not signed, or signature is invalid manifest: " << secmanifest;
+      LOG_ERROR << "Secondary manifest is corrupted or not signed, or signature is invalid manifest: "
+                << secondary.manifest;
     }
   }
   manifest["ecu_version_manifests"] = version_manifest;
@@ -293,19 +303,23 @@ bool SotaUptaneClient::hasPendingUpdates() const { return storage->hasPendingIns
 
 void SotaUptaneClient::initialize() {
   LOG_DEBUG << "Checking if device is provisioned...";
-  auto keys = std::make_shared<KeyManager>(storage, config.keymanagerConfig());
-  Initializer initializer(config.provision, storage, http, *keys, secondaries);
+  Initializer initializer(config.provision, storage, http, *keys_, secondaries);
 
   if (!initializer.isSuccessful()) {
     throw std::runtime_error("Fatal error during provisioning or ECU device registration.");
   }
+  {
+    // Provisioning may have replaced the TLS credentials.
+    std::lock_guard<std::mutex> guard(tls_keys_mutex_);
+    tls_keys_loaded_ = false;
+  }
 
   EcuSerials serials;
   if (!storage->loadEcuSerials(&serials) || serials.size() == 0) {
     throw std::runtime_error("Unable to load ECU serials after device registration.");
   }
 
-  uptane_manifest = std::make_shared<Uptane::ManifestIssuer>(keys, serials[0].first);
+  uptane_manifest = std::make_shared<Uptane::ManifestIssuer>(keys_, serials[0].first);
   primary_ecu_serial_ = serials[0].first;
   primary_ecu_hw_id_ = serials[0].second;
   LOG_INFO << "Primary ECU serial: " << primary_ecu_serial_ << " with hardware ID: " << primary_ecu_hw_id_;
@@ -323,7 +337,7 @@ void SotaUptaneClient::initialize() {
   std::string issuer;
   std::string not_before;
   std::string not_after;
-  keys->getCertInfo(&subject, &issuer, &not_before, &not_after);
+  keys_->getCertInfo(&subject, &issuer, &not_before, &not_after);
   LOG_INFO << "Certificate subject: " << subject;
   LOG_INFO << "Certificate issuer: " << issuer;
   LOG_INFO << "Certificate valid from: " << not_before << " until: " << not_after;
@@ -505,11 +519,10 @@ bool SotaUptaneClient::getNewTargets(std::vector<Uptane::Target> *new_targets, u
 std::unique_ptr<Uptane::Target> SotaUptaneClient::findTargetHelper(const Uptane::Targets &cur_targets,
                                                                    const Uptane::Target &queried_target,
                                                                    const int level, const bool terminating,
-                                                                   const bool offline) {
-  TargetCompare target_comp(queried_target);
-  const auto it = std::find_if(cur_targets.targets.cbegin(), cur_targets.targets.cend(), target_comp);
-  if (it != cur_targets.targets.cend()) {
-    return std_::make_unique<Uptane::Target>(*it);
+                                                                   Uptane::DelegationResolver &resolver) {
+  const Uptane::Target *found = cur_targets.findTarget(queried_target.filename());
+  if (found != nullptr && found->MatchTarget(queried_target)) {
+    return std_::make_unique<Uptane::Target>(*found);
   }
 
   if (terminating || level >= Uptane::kDelegationsMaxDepth) {
@@ -518,27 +531,14 @@ std::unique_ptr<Uptane::Target> SotaUptaneClient::findTargetHelper(const Uptane:
 
   for (const auto &delegate_name : cur_targets.delegated_role_names_) {
     Uptane::Role delegate_role = Uptane::Role::Delegation(delegate_name);
-    auto patterns = cur_targets.paths_for_role_.find(delegate_role);
-    if (patterns == cur_targets.paths_for_role_.end()) {
-      continue;
-    }
-
-    bool match = false;
-    for (const auto &pattern : patterns->second) {
-      if (fnmatch(pattern.c_str(), queried_target.filename().c_str(), 0) == 0) {
-        match = true;
-        break;
-      }
-    }
-    if (!match) {
+    if (!cur_targets.isDelegatedPath(delegate_role, queried_target.filename())) {
       continue;
     }
 
     // Target name matches one of the patterns
 
-    auto delegation =
-        Uptane::getTrustedDelegation(delegate_role, cur_targets, image_repo, *storage, *uptane_fetcher, offline);
-    if (delegation.isExpired(TimeStamp::Now())) {
+    auto delegation = resolver.get(delegate_role, cur_targets);
+    if (delegation->isExpired(TimeStamp::Now())) {
       continue;
     }
 
@@ -547,7 +547,7 @@ std::unique_ptr<Uptane::Target> SotaUptaneClient::findTargetHelper(const Uptane:
       throw Uptane::Exception("image", "Inconsistent delegations");
     }
 
-    auto found_target = findTargetHelper(delegation, queried_target, level + 1, is_terminating->second, offline);
+    auto found_target = findTargetHelper(*delegation, queried_target, level + 1, is_terminating->second, resolver);
     if (found_target != nullptr) {
       return found_target;
     }
@@ -557,13 +557,13 @@ std::unique_ptr<Uptane::Target> SotaUptaneClient::findTargetHelper(const Uptane:
 }
 
 std::unique_ptr<Uptane::Target> SotaUptaneClient::findTargetInDelegationTree(const Uptane::Target &target,
-                                                                             const bool offline) {
+                                                                             Uptane::DelegationResolver &resolver) {
   auto toplevel_targets = image_repo.getTargets();
   if (toplevel_targets == nullptr) {
     return std::unique_ptr<Uptane::Target>(nullptr);
   }
 
-  return findTargetHelper(*toplevel_targets, target, 0, false, offline);
+  return findTargetHelper(*toplevel_targets, target, 0, false, resolver);
 }
 
 result::Download SotaUptaneClient::downloadImages(const std::vector<Uptane::Target> &targets,
@@ -623,6 +623,14 @@ void SotaUptaneClient::reportResume() {
   report_queue->enqueue(std_::make_unique<DeviceResumedReport>(correlation_id));
 }
 
+void SotaUptaneClient::loadTlsKeys() {
+  std::lock_guard<std::mutex> guard(tls_keys_mutex_);
+  if (!tls_keys_loaded_) {
+    keys_->loadKeys();
+    tls_keys_loaded_ = true;
+  }
+}
+
 std::pair<bool, Uptane::Target> SotaUptaneClient::downloadImage(const Uptane::Target &target,
                                                                 const api::FlowControlToken *token) {
   // TODO: support downloading encrypted targets from director
@@ -633,10 +641,9 @@ std::pair<bool, Uptane::Target> SotaUptaneClient::downloadImage(const Uptane::Ta
     report_queue->enqueue(std_::make_unique<EcuDownloadStartedReport>(ecu.first, correlation_id));
   }
 
-  KeyManager keys(storage, config.keymanagerConfig());
-  keys.loadKeys();
+  loadTlsKeys();
   auto prog_cb = [this](const Uptane::Target &t, const std::string &description, unsigned int progress) {
-    report_progress_cb(events_channel.get(), t, description, progress);
+    sendEvent<event::DownloadProgressReport>(t, description, progress);
   };
 
   bool success = false;
@@ -649,7 +656,7 @@ std::pair<bool, Uptane::Target> SotaUptaneClient::downloadImage(const Uptane::Ta
     std::chrono::milliseconds wait(500);
 
     for (; tries < max_tries; tries++) {
-      success = package_manager_->fetchTarget(target, *uptane_fetcher, keys, prog_cb, token);
+      success = package_manager_->fetchTarget(target, *uptane_fetcher, *keys_, prog_cb, token);
       // Skip trying to fetch the 'target' if control flow token transaction
       // was set to the 'abort' or 'pause' state, see the CommandQueue and FlowControlToken.
       if (success || (token != nullptr && !token->canContinue(false))) {
@@ -758,6 +765,8 @@ void SotaUptaneClient::sendDeviceData() {
 
 result::UpdateCheck SotaUptaneClient::fetchMeta() {
   result::UpdateCheck result;
+  // Only a delay that the server asks for during this check applies to it.
+  server_retry_after_ = 0;
 
   reportNetworkInfo();
 
@@ -809,8 +818,14 @@ result::UpdateCheck SotaUptaneClient::checkUpdates() {
   // repositories match. A Primary ECU MUST perform this check on metadata for
   // all images listed in the Targets metadata file from the Director
   // repository.
+  std::vector<std::string> filenames;
+  for (const auto &target : updates) {
+    filenames.push_back(target.filename());
+  }
+  Uptane::DelegationResolver resolver(image_repo, *storage, *uptane_fetcher, false);
+  resolver.prefetch(filenames);
   for (auto &target : updates) {
-    auto image_target = findTargetInDelegationTree(target, false);
+    auto image_target = findTargetInDelegationTree(target, resolver);
     if (image_target == nullptr) {
       // TODO: Could also be a missing target or delegation expiration.
       last_exception = Uptane::TargetMismatch(target.filename());
@@ -865,6 +880,12 @@ result::UpdateStatus SotaUptaneClient::checkUpdatesOffline(const std::vector<Upt
   // For every target in the Director Targets metadata, walk the delegation
   // tree (if necessary) and find a matching target in the Image repo
   // metadata.
+  std::vector<std::string> filenames;
+  for (const auto &target : targets) {
+    filenames.push_back(target.filename());
+  }
+  Uptane::DelegationResolver resolver(image_repo, *storage, *uptane_fetcher, true);
+  resolver.prefetch(filenames);
   for (const auto &target : targets) {
     TargetCompare target_comp(target);
     const auto it = std::find_if(director_targets.cbegin(), director_targets.cend(), target_comp);
@@ -873,7 +894,7 @@ result::UpdateStatus SotaUptaneClient::checkUpdatesOffline(const std::vector<Upt
       return result::UpdateStatus::kError;
     }
 
-    const auto image_target = findTargetInDelegationTree(target, true);
+    const auto image_target = findTargetInDelegationTree(target, resolver);
     if (image_target == nullptr) {
       LOG_ERROR << "No matching target in Image repo Targets metadata for " << target;
       return result::UpdateStatus::kError;
@@ -1062,22 +1083,22 @@ bool SotaUptaneClient::putManifestSimple(const Json::Value &custom) {
     return false;
   }
 
-  static bool connected = true;
+  std::lock_guard<std::mutex> guard(installation_results_mutex_);
   auto manifest = AssembleManifest();
   if (custom != Json::nullValue) {
     manifest["custom"] = custom;
   }
   auto signed_manifest = uptane_manifest->sign(manifest);
   HttpResponse response = http->put(config.uptane.director_server + "/manifest", signed_manifest);
+  server_retry_after_ = response.retry_after.count();
   if (response.isOk()) {
-    if (!connected) {
+    if (!connected_.exchange(true)) {
       LOG_INFO << "Connectivity is restored.";
     }
-    connected = true;
     storage->clearInstallationResults();
     return true;
   } else {
-    connected = false;
+    connected_ = false;
   }
 
   LOG_WARNING << "Put manifest request failed: " << response.getStatusStr();
@@ -1190,6 +1211,7 @@ bool SotaUptaneClient::waitSecondariesReachable(const std::vector<Uptane::Target
 void SotaUptaneClient::storeInstallationFailure(const data::InstallationResult &result) {
   // Store installation report to inform Director of the update failure before
   // we actually got to the install step.
+  std::lock_guard<std::mutex> guard(installation_results_mutex_);
   const std::string &correlation_id = director_repo.getCorrelationId();
   storage->storeDeviceInstallationResult(result, "", correlation_id);
   // Fix for OTA-2587, listen to backend again after end of install.
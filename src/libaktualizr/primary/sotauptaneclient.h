@@ -1,8 +1,11 @@
 #ifndef SOTA_UPTANE_CLIENT_H_
 #define SOTA_UPTANE_CLIENT_H_
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -17,6 +20,7 @@
 #include "http/httpclient.h"
 #include "package_manager/packagemanagerfactory.h"
 #include "package_manager/packagemanagerinterface.h"
+#include "primary/event_dispatcher.h"
 #include "primary/events.h"
 #include "primary/results.h"
 #include "reportqueue.h"
@@ -36,6 +40,7 @@ class SotaUptaneClient {
                    const Uptane::HardwareIdentifier &hwid = Uptane::HardwareIdentifier::Unknown())
       : config(config_in),
         storage(std::move(storage_in)),
+        keys_(std::make_shared<KeyManager>(storage, config.keymanagerConfig())),
         http(std::move(http_in)),
         package_manager_(PackageManagerFactory::makePackageManager(config.pacman, config.bootloader, storage, http)),
         uptane_fetcher(new Uptane::Fetcher(config, http)),
@@ -47,7 +52,14 @@ class SotaUptaneClient {
 
   SotaUptaneClient(Config &config_in, const std::shared_ptr<INvStorage> &storage_in,
                    std::shared_ptr<HttpInterface> http_in)
-      : SotaUptaneClient(config_in, storage_in, std::move(http_in), nullptr) {}
+      : SotaUptaneClient(config_in, storage_in, std::move(http_in), std::shared_ptr<event::Channel>()) {}
+
+  // Events are delivered to the handlers by the dispatcher, on its own thread.
+  SotaUptaneClient(Config &config_in, const std::shared_ptr<INvStorage> &storage_in,
+                   std::shared_ptr<HttpInterface> http_in, std::shared_ptr<event::Dispatcher> events_dispatcher_in)
+      : SotaUptaneClient(config_in, storage_in, std::move(http_in), std::shared_ptr<event::Channel>()) {
+    events_dispatcher = std::move(events_dispatcher_in);
+  }
 
   SotaUptaneClient(Config &config_in, const std::shared_ptr<INvStorage> &storage_in)
       : SotaUptaneClient(config_in, storage_in, std::make_shared<HttpClient>()) {}
@@ -71,6 +83,8 @@ class SotaUptaneClient {
   void campaignPostpone(const std::string &campaign_id);
 
   bool hasPendingUpdates() const;
+  // The delay the Director asked for during the last update check, zero if it did not.
+  std::chrono::seconds serverRetryAfter() const { return std::chrono::seconds(server_retry_after_); }
   bool isInstallCompletionRequired() const;
   void completeInstall() const;
   Uptane::LazyTargetsList allTargets() const;
@@ -129,6 +143,7 @@ class SotaUptaneClient {
   void reportNetworkInfo();
   void reportAktualizrConfiguration();
   void verifySecondaries();
+  void loadTlsKeys();
   bool waitSecondariesReachable(const std::vector<Uptane::Target> &updates);
   void sendMetadataToEcus(const std::vector<Uptane::Target> &targets);
   std::future<data::ResultCode::Numeric> sendFirmwareAsync(Uptane::SecondaryInterface &secondary,
@@ -142,10 +157,11 @@ class SotaUptaneClient {
   bool updateDirectorMeta();
   bool checkDirectorMetaOffline();
   void computeDeviceInstallationResult(data::InstallationResult *result, std::string *raw_installation_report) const;
-  std::unique_ptr<Uptane::Target> findTargetInDelegationTree(const Uptane::Target &target, bool offline);
+  std::unique_ptr<Uptane::Target> findTargetInDelegationTree(const Uptane::Target &target,
+                                                             Uptane::DelegationResolver &resolver);
   std::unique_ptr<Uptane::Target> findTargetHelper(const Uptane::Targets &cur_targets,
                                                    const Uptane::Target &queried_target, int level, bool terminating,
-                                                   bool offline);
+                                                   Uptane::DelegationResolver &resolver);
   void checkAndUpdatePendingSecondaries();
   const Uptane::EcuSerial &primaryEcuSerial() const { return primary_ecu_serial_; }
   boost::optional<Uptane::HardwareIdentifier> ecuHwId(const Uptane::EcuSerial &serial) const;
@@ -153,7 +169,9 @@ class SotaUptaneClient {
   template <class T, class... Args>
   void sendEvent(Args &&... args) {
     std::shared_ptr<event::BaseEvent> event = std::make_shared<T>(std::forward<Args>(args)...);
-    if (events_channel) {
+    if (events_dispatcher) {
+      events_dispatcher->post(std::move(event));
+    } else if (events_channel) {
       (*events_channel)(std::move(event));
     } else if (!event->isTypeOf<event::DownloadProgressReport>()) {
       LOG_INFO << "got " << event->variant << " event";
@@ -165,6 +183,12 @@ class SotaUptaneClient {
   Uptane::ImageRepository image_repo;
   Uptane::ManifestIssuer::Ptr uptane_manifest;
   std::shared_ptr<INvStorage> storage;
+  std::shared_ptr<KeyManager> keys_;
+  // The TLS credentials are written out for the package manager on the first
+  // download after provisioning, as they only change then. Downloads run on
+  // another lane than manifest signing, so the latch is guarded.
+  std::mutex tls_keys_mutex_;
+  bool tls_keys_loaded_{false};
   std::shared_ptr<HttpInterface> http;
   std::shared_ptr<PackageManagerInterface> package_manager_;
   std::shared_ptr<Uptane::Fetcher> uptane_fetcher;
@@ -172,11 +196,17 @@ class SotaUptaneClient {
   Json::Value last_network_info_reported;
   Json::Value last_hw_info_reported;
   std::shared_ptr<event::Channel> events_channel;
+  std::shared_ptr<event::Dispatcher> events_dispatcher;
   boost::signals2::scoped_connection conn;
   Uptane::Exception last_exception{"", ""};
   // ecu_serial => secondary*
   std::map<Uptane::EcuSerial, Uptane::SecondaryInterface::Ptr> secondaries;
   std::mutex download_mutex;
+  // Held from assembling a manifest until the installation results in it are
+  // cleared, so that results stored meanwhile by a download are not lost.
+  std::mutex installation_results_mutex_;
+  std::atomic_bool connected_{true};
+  std::atomic<std::chrono::seconds::rep> server_retry_after_{0};
   Uptane::EcuSerial primary_ecu_serial_;
   Uptane::HardwareIdentifier primary_ecu_hw_id_;
 };
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -954,6 +955,8 @@ void SQLStorage::storeEcuSerials(const EcuSerials& serials) {
     }
 
     db.commitTransaction();
+    // The primary's versions may have been stored without its serial.
+    forgetInstalledVersions();
   }
 }
 
@@ -1007,6 +1010,7 @@ void SQLStorage::clearEcuSerials() {
   }
 
   db.commitTransaction();
+  forgetInstalledVersions();
 }
 
 void SQLStorage::storeCachedEcuManifest(const Uptane::EcuSerial& ecu_serial, const std::string& manifest) {
@@ -1210,6 +1214,7 @@ void SQLStorage::saveInstalledVersion(const std::string& ecu_serial, const Uptan
   }
 
   db.commitTransaction();
+  forgetInstalledVersions();
 }
 
 static void loadEcuMap(SQLite3Guard& db, std::string& ecu_serial, Uptane::EcuMap& ecu_map) {
@@ -1316,6 +1321,32 @@ bool SQLStorage::loadInstalledVersions(const std::string& ecu_serial, boost::opt
                                        boost::optional<Uptane::Target>* pending_version) {
   SQLite3Guard db = dbConnection();
 
+  if (readonly_) {
+    return loadInstalledVersionsFromDb(db, ecu_serial, current_version, pending_version);
+  }
+
+  auto it = installed_versions_.find(ecu_serial);
+  if (it == installed_versions_.end()) {
+    InstalledVersions versions;
+    if (!loadInstalledVersionsFromDb(db, ecu_serial, &versions.current, &versions.pending)) {
+      // Only report errors about the versions that were asked for.
+      return loadInstalledVersionsFromDb(db, ecu_serial, current_version, pending_version);
+    }
+    it = installed_versions_.emplace(ecu_serial, std::move(versions)).first;
+  }
+
+  if (current_version != nullptr) {
+    *current_version = it->second.current;
+  }
+  if (pending_version != nullptr) {
+    *pending_version = it->second.pending;
+  }
+  return true;
+}
+
+bool SQLStorage::loadInstalledVersionsFromDb(SQLite3Guard& db, const std::string& ecu_serial,
+                                             boost::optional<Uptane::Target>* current_version,
+                                             boost::optional<Uptane::Target>* pending_version) {
   std::string ecu_serial_real = ecu_serial;
   Uptane::EcuMap ecu_map;
   loadEcuMap(db, ecu_serial_real, ecu_map);
@@ -1441,8 +1472,12 @@ void SQLStorage::clearInstalledVersions() {
     LOG_ERROR << "Can't clear installed_versions: " << db.errmsg();
     return;
   }
+  forgetInstalledVersions();
 }
 
+// To be called with a database connection open, as it holds the mutex.
+void SQLStorage::forgetInstalledVersions() { installed_versions_.clear(); }
+
 void SQLStorage::saveEcuInstallationResult(const Uptane::EcuSerial& ecu_serial,
                                            const data::InstallationResult& result) {
   SQLite3Guard db = dbConnection();
@@ -1975,4 +2010,8 @@ void SQLStorage::removeTargetFile(const std::string& target_name) {
   db.commitTransaction();
 }
 
-void SQLStorage::cleanUp() { boost::filesystem::remove_all(dbPath()); }
+void SQLStorage::cleanUp() {
+  std::lock_guard<std::mutex> guard(*mutex_);
+  boost::filesystem::remove_all(dbPath());
+  forgetInstalledVersions();
+}
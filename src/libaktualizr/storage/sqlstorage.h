@@ -1,6 +1,9 @@
 #ifndef SQLSTORAGE_H_
 #define SQLSTORAGE_H_
 
+#include <map>
+#include <string>
+
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
@@ -107,9 +110,23 @@ class SQLStorage : public SQLStorageBase, public INvStorage {
   StorageType type() override { return StorageType::kSqlite; };
 
  private:
+  struct InstalledVersions {
+    boost::optional<Uptane::Target> current;
+    boost::optional<Uptane::Target> pending;
+  };
+
   boost::filesystem::path images_path_{sqldb_path_.parent_path() / "images"};
+  // Installed versions by the ECU serial they were loaded for, as they are
+  // checked on every update check but only change through this instance.
+  // Read-only instances do not keep them, as another process writes the
+  // database then. Guarded by the database mutex.
+  std::map<std::string, InstalledVersions> installed_versions_;
 
   void cleanMetaVersion(Uptane::RepositoryType repo, const Uptane::Role& role);
+  static bool loadInstalledVersionsFromDb(SQLite3Guard& db, const std::string& ecu_serial,
+                                          boost::optional<Uptane::Target>* current_version,
+                                          boost::optional<Uptane::Target>* pending_version);
+  void forgetInstalledVersions();
 };
 
 #endif  // SQLSTORAGE_H_
@@ -422,6 +422,40 @@ TEST(storage, load_store_installed_versions) {
   }
 }
 
+/* Installed versions that were loaded before are seen to change when the ECU
+ * serials are stored and when they are cleared. */
+TEST(storage, reload_installed_versions) {
+  TemporaryDirectory temp_dir;
+  std::unique_ptr<INvStorage> storage = Storage(temp_dir.Path());
+
+  Uptane::EcuMap primary_ecu{{Uptane::EcuSerial("primary"), Uptane::HardwareIdentifier("primary_hw")}};
+  Uptane::Target t1{"update.bin", primary_ecu, {Uptane::Hash{Uptane::Hash::Type::kSha256, "2561"}}, 1};
+  storage->savePrimaryInstalledVersion(t1, InstalledVersionUpdateMode::kCurrent);
+  {
+    boost::optional<Uptane::Target> current;
+    EXPECT_TRUE(storage->loadPrimaryInstalledVersions(&current, nullptr));
+    ASSERT_TRUE(!!current);
+    EXPECT_TRUE(current->ecus().empty());
+  }
+
+  storage->storeEcuSerials({{Uptane::EcuSerial("primary"), Uptane::HardwareIdentifier("primary_hw")}});
+  {
+    boost::optional<Uptane::Target> current;
+    EXPECT_TRUE(storage->loadPrimaryInstalledVersions(&current, nullptr));
+    ASSERT_TRUE(!!current);
+    EXPECT_EQ(current->ecus(), primary_ecu);
+  }
+
+  storage->clearInstalledVersions();
+  {
+    boost::optional<Uptane::Target> current;
+    boost::optional<Uptane::Target> pending;
+    EXPECT_TRUE(storage->loadPrimaryInstalledVersions(&current, &pending));
+    EXPECT_FALSE(!!current);
+    EXPECT_FALSE(!!pending);
+  }
+}
+
 /*
  * Load and store an ecu installation result in an SQL database.
  * Load and store a device installation result in an SQL database.
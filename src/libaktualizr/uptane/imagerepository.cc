@@ -1,7 +1,44 @@
 #include "imagerepository.h"
 
+#include "utilities/json_scanner.h"
+
 namespace Uptane {
 
+namespace {
+// Metadata that is already in canonical form is used as it is, instead of
+// being parsed and written back.
+std::string canonicalMetadata(const std::string& raw) {
+  try {
+    const JsonScanner scanner(raw);
+    return scanner.canonical(scanner.document());
+  } catch (const JsonScanner::Error&) {
+    return Utils::jsonToCanonicalStr(Utils::parseJSON(raw));
+  }
+}
+}  // namespace
+
+std::shared_ptr<const Targets> DelegationCache::find(const Role& role, const std::string& raw, const int version,
+                                                     const std::vector<Hash>& hashes, const Targets& parent) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = entries_.find(role);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  const Entry& entry = it->second;
+  if (entry.version != version || entry.hashes != hashes || entry.parent != parent.name() ||
+      entry.parent_version != parent.version() || entry.raw != raw) {
+    return nullptr;
+  }
+  return entry.targets;
+}
+
+void DelegationCache::store(const Role& role, const std::string& raw, const int version,
+                            const std::vector<Hash>& hashes, const Targets& parent,
+                            std::shared_ptr<const Targets> targets) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_[role] = Entry{raw, version, hashes, parent.name(), parent.version(), std::move(targets)};
+}
+
 void ImageRepository::resetMeta() {
   resetRoot();
   targets.reset();
@@ -59,7 +96,7 @@ bool ImageRepository::fetchSnapshot(INvStorage& storage, const IMetadataFetcher&
 
 bool ImageRepository::verifySnapshot(const std::string& snapshot_raw, bool prefetch) {
   try {
-    const std::string canonical = Utils::jsonToCanonicalStr(Utils::parseJSON(snapshot_raw));
+    const std::string canonical = canonicalMetadata(snapshot_raw);
     bool hash_exists = false;
     for (const auto& it : timestamp.snapshot_hashes()) {
       switch (it.type()) {
@@ -137,10 +174,14 @@ bool ImageRepository::fetchTargets(INvStorage& storage, const IMetadataFetcher&
 }
 
 bool ImageRepository::verifyRoleHashes(const std::string& role_data, const Uptane::Role& role, bool prefetch) const {
-  const std::string canonical = Utils::jsonToCanonicalStr(Utils::parseJSON(role_data));
   // Hashes are not required. If present, however, we may as well check them.
   // This provides no security benefit, but may help with fault detection.
-  for (const auto& it : snapshot.role_hashes(role)) {
+  const std::vector<Hash> hashes = snapshot.role_hashes(role);
+  if (hashes.empty()) {
+    return true;
+  }
+  const std::string canonical = canonicalMetadata(role_data);
+  for (const auto& it : hashes) {
     switch (it.type()) {
       case Hash::Type::kSha256:
         if (Hash(Hash::Type::kSha256, boost::algorithm::hex(Crypto::sha256digest(canonical))) != it) {
@@ -168,6 +209,8 @@ bool ImageRepository::verifyRoleHashes(const std::string& role_data, const Uptan
 
 int ImageRepository::getRoleVersion(const Uptane::Role& role) const { return snapshot.role_version(role); }
 
+std::vector<Hash> ImageRepository::getRoleHashes(const Uptane::Role& role) const { return snapshot.role_hashes(role); }
+
 int64_t ImageRepository::getRoleSize(const Uptane::Role& role) const { return snapshot.role_size(role); }
 
 bool ImageRepository::verifyTargets(const std::string& targets_raw, bool prefetch) {
@@ -176,12 +219,9 @@ bool ImageRepository::verifyTargets(const std::string& targets_raw, bool prefetc
       return false;
     }
 
-    auto targets_json = Utils::parseJSON(targets_raw);
-
     // Verify the signature:
     auto signer = std::make_shared<MetaWithKeys>(root);
-    targets = std::make_shared<Uptane::Targets>(
-        Targets(RepositoryType::Image(), Uptane::Role::Targets(), targets_json, signer));
+    targets = std::make_shared<Uptane::Targets>(RepositoryType::Image(), Uptane::Role::Targets(), targets_raw, signer);
 
     if (targets->version() != snapshot.role_version(Uptane::Role::Targets())) {
       return false;
@@ -198,12 +238,9 @@ std::shared_ptr<Uptane::Targets> ImageRepository::verifyDelegation(const std::st
                                                                    const Uptane::Role& role,
                                                                    const Targets& parent_target) {
   try {
-    const Json::Value delegation_json = Utils::parseJSON(delegation_raw);
-    const std::string canonical = Utils::jsonToCanonicalStr(delegation_json);
-
     // Verify the signature:
     auto signer = std::make_shared<MetaWithKeys>(parent_target);
-    return std::make_shared<Uptane::Targets>(Targets(RepositoryType::Image(), role, delegation_json, signer));
+    return std::make_shared<Uptane::Targets>(RepositoryType::Image(), role, delegation_raw, signer);
   } catch (const Exception& e) {
     LOG_ERROR << "Signature verification for Image repo delegated Targets metadata failed";
     throw e;
@@ -2,6 +2,9 @@
 #define IMAGE_REPOSITORY_H_
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "uptanerepository.h"
@@ -10,6 +13,34 @@ namespace Uptane {
 
 constexpr int kDelegationsMaxDepth = 5;
 
+/*
+ * Delegated Targets metadata verified before, by role. An entry is only used
+ * again for the very same metadata, listed with the same version and hashes
+ * in Snapshot and delegated by the same version of the same role: the outcome
+ * of the verification can not have changed then. Any other version replaces
+ * it.
+ */
+class DelegationCache {
+ public:
+  std::shared_ptr<const Targets> find(const Role& role, const std::string& raw, int version,
+                                      const std::vector<Hash>& hashes, const Targets& parent) const;
+  void store(const Role& role, const std::string& raw, int version, const std::vector<Hash>& hashes,
+             const Targets& parent, std::shared_ptr<const Targets> targets);
+
+ private:
+  struct Entry {
+    std::string raw;
+    int version;
+    std::vector<Hash> hashes;
+    std::string parent;
+    int parent_version;
+    std::shared_ptr<const Targets> targets;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<Role, Entry> entries_;
+};
+
 class ImageRepository : public RepositoryCommon {
  public:
   ImageRepository() : RepositoryCommon(RepositoryType::Image()) {}
@@ -28,11 +59,15 @@ class ImageRepository : public RepositoryCommon {
 
   bool verifyRoleHashes(const std::string& role_data, const Uptane::Role& role, bool prefetch) const;
   int getRoleVersion(const Uptane::Role& role) const;
+  std::vector<Hash> getRoleHashes(const Uptane::Role& role) const;
   int64_t getRoleSize(const Uptane::Role& role) const;
 
   bool checkMetaOffline(INvStorage& storage);
   bool updateMeta(INvStorage& storage, const IMetadataFetcher& fetcher) override;
 
+  // Kept across metadata updates, unlike the rest of the metadata.
+  DelegationCache& delegationCache() const { return delegation_cache_; }
+
  private:
   bool timestampExpired();
   bool snapshotExpired();
@@ -44,6 +79,7 @@ class ImageRepository : public RepositoryCommon {
   std::shared_ptr<Uptane::Targets> targets;
   Uptane::TimestampMeta timestamp;
   Uptane::Snapshot snapshot;
+  mutable DelegationCache delegation_cache_;
 };
 
 }  // namespace Uptane
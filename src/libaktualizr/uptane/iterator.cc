@@ -1,14 +1,30 @@
 #include "iterator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+
 namespace Uptane {
 
-Targets getTrustedDelegation(const Role &delegate_role, const Targets &parent_targets,
-                             const ImageRepository &image_repo, INvStorage &storage, Fetcher &fetcher,
-                             const bool offline) {
+namespace {
+
+std::shared_ptr<const Targets> trustedDelegation(const Role &delegate_role, const Targets &parent_targets,
+                                                 const ImageRepository &image_repo, INvStorage &storage,
+                                                 Fetcher &fetcher, const bool offline) {
   std::string delegation_meta;
   auto version_in_snapshot = image_repo.getRoleVersion(delegate_role);
+  // A cache hit skips verifyRoleHashes(), so the hashes are part of the key.
+  const std::vector<Hash> hashes_in_snapshot = image_repo.getRoleHashes(delegate_role);
+  DelegationCache &cache = image_repo.delegationCache();
 
   if (storage.loadDelegation(&delegation_meta, delegate_role)) {
+    // The stored metadata still is what was verified last time.
+    auto cached = cache.find(delegate_role, delegation_meta, version_in_snapshot, hashes_in_snapshot, parent_targets);
+    if (cached != nullptr) {
+      return cached;
+    }
+
     auto version = extractVersionUntrusted(delegation_meta);
 
     if (version > version_in_snapshot) {
@@ -47,13 +63,185 @@ Targets getTrustedDelegation(const Role &delegate_role, const Targets &parent_ta
     storage.storeDelegation(delegation_meta, delegate_role);
   }
 
-  return *delegation;
+  if (delegation->version() == version_in_snapshot) {
+    cache.store(delegate_role, delegation_meta, version_in_snapshot, hashes_in_snapshot, parent_targets, delegation);
+  }
+  return delegation;
+}
+
+}  // namespace
+
+Targets getTrustedDelegation(const Role &delegate_role, const Targets &parent_targets,
+                             const ImageRepository &image_repo, INvStorage &storage, Fetcher &fetcher,
+                             const bool offline) {
+  return *trustedDelegation(delegate_role, parent_targets, image_repo, storage, fetcher, offline);
+}
+
+DelegationResolver::DelegationResolver(const ImageRepository &image_repo, INvStorage &storage, Fetcher &fetcher,
+                                       const bool offline, const unsigned int max_parallel)
+    : image_repo_{image_repo},
+      storage_{storage},
+      fetcher_{fetcher},
+      offline_{offline},
+      max_parallel_{std::max(max_parallel, 1U)} {}
+
+DelegationResolver::Entry DelegationResolver::resolve(const Role &delegate_role, const Targets &parent_targets) {
+  Entry entry;
+  try {
+    entry.targets = trustedDelegation(delegate_role, parent_targets, image_repo_, storage_, fetcher_, offline_);
+  } catch (...) {
+    entry.error = std::current_exception();
+  }
+  return entry;
+}
+
+std::shared_ptr<const Targets> DelegationResolver::get(const Role &delegate_role, const Targets &parent_targets) {
+  const Key key{parent_targets.name(), delegate_role};
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      entry = it->second;
+    }
+  }
+  if (!entry.targets && !entry.error) {
+    entry = resolve(delegate_role, parent_targets);
+    std::lock_guard<std::mutex> guard(mutex_);
+    cache_[key] = entry;
+  }
+  if (entry.error) {
+    std::rethrow_exception(entry.error);
+  }
+  return entry.targets;
+}
+
+void DelegationResolver::prefetch(const std::vector<std::string> &filenames) {
+  if (filenames.empty()) {
+    if (prefetched_all_) {
+      return;
+    }
+    prefetched_all_ = true;
+  }
+
+  // Prune the tree the way SotaUptaneClient::findTargetHelper() searches it,
+  // so that only roles it may ask for are fetched: it stops at the first role
+  // listing a target and never looks below an expired or terminating role.
+  const bool all = filenames.empty();
+  struct Node {
+    std::shared_ptr<const Targets> targets;
+    std::vector<std::string> wanted;  // filenames still looked for below it, unless all
+  };
+  struct Job {
+    Role role;
+    std::shared_ptr<const Targets> parent;
+    bool terminating;
+    std::vector<std::string> wanted;
+    Entry entry;
+  };
+  auto not_listed = [](const Targets &targets, const std::vector<std::string> &names) {
+    std::vector<std::string> result;
+    std::copy_if(names.cbegin(), names.cend(), std::back_inserter(result),
+                 [&targets](const std::string &name) { return targets.findTarget(name) == nullptr; });
+    return result;
+  };
+
+  std::vector<Node> level_nodes;
+  const auto top = image_repo_.getTargets();
+  if (top != nullptr) {
+    level_nodes.push_back(Node{top, not_listed(*top, filenames)});
+  }
+  const TimeStamp now = TimeStamp::Now();
+  for (int level = 0; level < kDelegationsMaxDepth && !level_nodes.empty(); ++level) {
+    std::vector<Job> jobs;
+    for (const auto &node : level_nodes) {
+      for (const auto &delegate_name : node.targets->delegated_role_names_) {
+        const Role role = Role::Delegation(delegate_name);
+        const auto terminating = node.targets->terminating_role_.find(role);
+        if (node.targets->paths_for_role_.count(role) == 0 || terminating == node.targets->terminating_role_.end()) {
+          continue;
+        }
+        std::vector<std::string> wanted;
+        std::copy_if(node.wanted.cbegin(), node.wanted.cend(), std::back_inserter(wanted),
+                     [&node, &role](const std::string &name) { return node.targets->isDelegatedPath(role, name); });
+        if (!all && wanted.empty()) {
+          continue;
+        }
+        jobs.push_back(Job{role, node.targets, terminating->second, std::move(wanted), Entry()});
+      }
+    }
+
+    std::vector<Job *> pending;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      for (auto &job : jobs) {
+        auto it = cache_.find(Key{job.parent->name(), job.role});
+        if (it != cache_.end()) {
+          job.entry = it->second;
+        } else {
+          pending.push_back(&job);
+        }
+      }
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [this, &pending, &next]() {
+      for (size_t i = next++; i < pending.size(); i = next++) {
+        pending[i]->entry = resolve(pending[i]->role, *pending[i]->parent);
+      }
+    };
+    std::vector<std::thread> workers;
+    const size_t workers_count = std::min<size_t>(max_parallel_, pending.size());
+    for (size_t i = 1; i < workers_count; ++i) {
+      workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+      thread.join();
+    }
+
+    level_nodes.clear();
+    std::lock_guard<std::mutex> guard(mutex_);
+    // Jobs are grouped by parent, in the order the search visits them. A
+    // target listed by a role is not looked for in its later siblings.
+    const Targets *parent = nullptr;
+    std::vector<std::string> listed;
+    for (auto &job : jobs) {
+      cache_.emplace(Key{job.parent->name(), job.role}, job.entry);
+      if (job.parent.get() != parent) {
+        parent = job.parent.get();
+        listed.clear();
+      }
+      if (!job.entry.targets || job.entry.targets->isExpired(now)) {
+        continue;
+      }
+      std::vector<std::string> wanted;
+      for (const auto &name : job.wanted) {
+        if (std::find(listed.cbegin(), listed.cend(), name) != listed.cend()) {
+          continue;
+        }
+        if (job.entry.targets->findTarget(name) != nullptr) {
+          listed.push_back(name);
+        } else {
+          wanted.push_back(name);
+        }
+      }
+      if (!job.terminating && (all || !wanted.empty())) {
+        level_nodes.push_back(Node{job.entry.targets, std::move(wanted)});
+      }
+    }
+  }
 }
 
 LazyTargetsList::DelegationIterator::DelegationIterator(const ImageRepository &repo,
                                                         std::shared_ptr<INvStorage> storage,
-                                                        std::shared_ptr<Fetcher> fetcher, bool is_end)
-    : repo_{repo}, storage_{std::move(storage)}, fetcher_{std::move(fetcher)}, is_end_{is_end} {
+                                                        std::shared_ptr<Fetcher> fetcher,
+                                                        std::shared_ptr<DelegationResolver> resolver, bool is_end)
+    : repo_{repo},
+      storage_{std::move(storage)},
+      fetcher_{std::move(fetcher)},
+      resolver_{std::move(resolver)},
+      is_end_{is_end} {
   tree_ = std::make_shared<DelegatedTargetTreeNode>();
   tree_node_ = tree_.get();
 
@@ -67,6 +255,9 @@ void LazyTargetsList::DelegationIterator::renewTargetsData() {
   if (role == Role::Targets()) {
     cur_targets_ = repo_.getTargets();
   } else {
+    // Resolve the whole tree at once the first time it is needed.
+    resolver_->prefetch();
+
     // go to the top of the delegation tree
     std::stack<std::vector<std::shared_ptr<DelegatedTargetTreeNode>>::size_type> indices;
     auto *node = tree_node_->parent;
@@ -81,11 +272,9 @@ void LazyTargetsList::DelegationIterator::renewTargetsData() {
       indices.pop();
 
       auto fetched_role = Role(parent_targets->delegated_role_names_[idx], true);
-      parent_targets = std::make_shared<const Targets>(
-          getTrustedDelegation(fetched_role, *parent_targets, repo_, *storage_, *fetcher_, false));
+      parent_targets = resolver_->get(fetched_role, *parent_targets);
     }
-    cur_targets_ =
-        std::make_shared<Targets>(getTrustedDelegation(role, *parent_targets, repo_, *storage_, *fetcher_, false));
+    cur_targets_ = resolver_->get(role, *parent_targets);
   }
 }
 
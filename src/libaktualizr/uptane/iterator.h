@@ -1,14 +1,74 @@
 #ifndef AKTUALIZR_UPTANE_ITERATOR_H_
 #define AKTUALIZR_UPTANE_ITERATOR_H_
 
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "fetcher.h"
 #include "imagerepository.h"
 
 namespace Uptane {
 
+constexpr unsigned int kMaxParallelDelegationFetches = 8;
+
 Targets getTrustedDelegation(const Role &delegate_role, const Targets &parent_targets,
                              const ImageRepository &image_repo, INvStorage &storage, Fetcher &fetcher, bool offline);
 
+/*
+ * Resolves delegated Image repo Targets metadata and keeps what it verified
+ * for as long as it lives, so that each role is fetched and verified once per
+ * walk of the delegation tree.
+ *
+ * prefetch() resolves the tree level by level: all the roles of a level only
+ * depend on their (already verified) parents, so they are fetched and
+ * verified concurrently, with up to max_parallel roles in flight.
+ */
+class DelegationResolver {
+ public:
+  DelegationResolver(const ImageRepository &image_repo, INvStorage &storage, Fetcher &fetcher, bool offline,
+                     unsigned int max_parallel = kMaxParallelDelegationFetches);
+
+  /*
+   * Resolve every delegated role that could contain one of the given target
+   * filenames, or all delegated roles if there are none. The roles below an
+   * expired or terminating role are skipped, as the search never gets there,
+   * and so are, for a given target, the roles below the first role listing
+   * it and below the roles after that one.
+   * Failures are not reported here, but by get() for the roles that are
+   * actually needed.
+   */
+  void prefetch(const std::vector<std::string> &filenames = {});
+
+  /*
+   * The verified metadata of delegate_role, delegated by parent_targets.
+   * Throws the same exceptions as getTrustedDelegation().
+   */
+  std::shared_ptr<const Targets> get(const Role &delegate_role, const Targets &parent_targets);
+
+ private:
+  struct Entry {
+    std::shared_ptr<const Targets> targets;
+    std::exception_ptr error;
+  };
+  using Key = std::pair<std::string, Role>;  // parent role name, delegated role
+
+  Entry resolve(const Role &delegate_role, const Targets &parent_targets);
+
+  const ImageRepository &image_repo_;
+  INvStorage &storage_;
+  Fetcher &fetcher_;
+  const bool offline_;
+  const unsigned int max_parallel_;
+  std::mutex mutex_;
+  std::map<Key, Entry> cache_;
+  bool prefetched_all_{false};
+};
+
 class LazyTargetsList {
  public:
   struct DelegatedTargetTreeNode {
@@ -27,7 +87,8 @@ class LazyTargetsList {
 
    public:
     explicit DelegationIterator(const ImageRepository &repo, std::shared_ptr<INvStorage> storage,
-                                std::shared_ptr<Uptane::Fetcher> fetcher, bool is_end = false);
+                                std::shared_ptr<Uptane::Fetcher> fetcher,
+                                std::shared_ptr<DelegationResolver> resolver, bool is_end = false);
     DelegationIterator operator++();
     bool operator==(const DelegationIterator &other) const;
     bool operator!=(const DelegationIterator &other) const { return !(*this == other); }
@@ -39,6 +100,7 @@ class LazyTargetsList {
     const ImageRepository &repo_;
     std::shared_ptr<INvStorage> storage_;
     std::shared_ptr<Fetcher> fetcher_;
+    std::shared_ptr<DelegationResolver> resolver_;
     std::shared_ptr<const Targets> cur_targets_;
     std::vector<Targets>::size_type target_idx_{0};
     std::vector<std::shared_ptr<DelegatedTargetTreeNode>>::size_type children_idx_{0};
@@ -51,14 +113,18 @@ class LazyTargetsList {
 
   explicit LazyTargetsList(const ImageRepository &repo, std::shared_ptr<INvStorage> storage,
                            std::shared_ptr<Fetcher> fetcher)
-      : repo_{repo}, storage_{std::move(storage)}, fetcher_{std::move(fetcher)} {}
-  DelegationIterator begin() { return DelegationIterator(repo_, storage_, fetcher_); }
-  DelegationIterator end() { return DelegationIterator(repo_, storage_, fetcher_, true); }
+      : repo_{repo},
+        storage_{std::move(storage)},
+        fetcher_{std::move(fetcher)},
+        resolver_{std::make_shared<DelegationResolver>(repo_, *storage_, *fetcher_, false)} {}
+  DelegationIterator begin() { return DelegationIterator(repo_, storage_, fetcher_, resolver_); }
+  DelegationIterator end() { return DelegationIterator(repo_, storage_, fetcher_, resolver_, true); }
 
  private:
   const ImageRepository &repo_;
   std::shared_ptr<INvStorage> storage_;
   std::shared_ptr<Uptane::Fetcher> fetcher_;
+  std::shared_ptr<DelegationResolver> resolver_;
 };
 }  // namespace Uptane
 
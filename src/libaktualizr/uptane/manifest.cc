@@ -23,12 +23,31 @@ std::string Manifest::signedBody() const {
 }
 
 bool Manifest::verifySignature(const PublicKey &pub_key) const {
-  if (!(isMember("signatures") && isMember("signed"))) {
-    LOG_ERROR << "Missing either signature or the signing body/subject: " << *this;
-    return false;
+  return verifySignatures({std::make_pair(this, &pub_key)}).front();
+}
+
+std::vector<bool> Manifest::verifySignatures(
+    const std::vector<std::pair<const Manifest *, const PublicKey *>> &signed_by) {
+  std::vector<std::string> bodies(signed_by.size());
+  std::vector<SignatureCheck> checks;
+  std::vector<size_t> checked;
+  for (size_t i = 0; i < signed_by.size(); ++i) {
+    const Manifest &manifest = *signed_by[i].first;
+    if (!(manifest.isMember("signatures") && manifest.isMember("signed"))) {
+      LOG_ERROR << "Missing either signature or the signing body/subject: " << manifest;
+      continue;
+    }
+    bodies[i] = manifest.signedBody();
+    checks.emplace_back(*signed_by[i].second, manifest.signature(), bodies[i]);
+    checked.push_back(i);
   }
 
-  return pub_key.VerifySignature(signature(), signedBody());
+  std::vector<bool> valid(signed_by.size(), false);
+  const std::vector<bool> checks_valid = Crypto::VerifySignatures(checks);
+  for (size_t i = 0; i < checked.size(); ++i) {
+    valid[checked[i]] = checks_valid[i];
+  }
+  return valid;
 }
 
 Manifest ManifestIssuer::sign(const Manifest &manifest, const std::string &report_counter) const {
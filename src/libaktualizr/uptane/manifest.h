@@ -5,6 +5,8 @@
 #include "tuf.h"
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 class KeyManager;
 
@@ -20,6 +22,11 @@ class Manifest : public Json::Value {
   std::string signature() const;
   std::string signedBody() const;
   bool verifySignature(const PublicKey &pub_key) const;
+
+  /* Check the signatures of several manifests, each with its own key, together
+   * (see Crypto::VerifySignatures()). Returns whether each one is valid. */
+  static std::vector<bool> verifySignatures(
+      const std::vector<std::pair<const Manifest *, const PublicKey *>> &signed_by);
 };
 
 class ManifestIssuer {
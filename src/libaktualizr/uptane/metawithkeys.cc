@@ -57,9 +57,14 @@ void Uptane::MetaWithKeys::ParseRole(const RepositoryType repo, const Json::Valu
 
 void Uptane::MetaWithKeys::UnpackSignedObject(const RepositoryType repo, const Role &role,
                                               const Json::Value &signed_object) {
+  VerifySignatures(repo, role, Uptane::Role(signed_object["signed"]["_type"].asString()),
+                   Utils::jsonToCanonicalStr(signed_object["signed"]), signed_object["signatures"]);
+}
+
+void Uptane::MetaWithKeys::VerifySignatures(const RepositoryType repo, const Role &role, const Role &type,
+                                            const std::string &canonical, const Json::Value &signatures) {
   const std::string repository = repo;
 
-  const Uptane::Role type(signed_object["signed"]["_type"].asString());
   if (role.IsDelegation()) {
     if (type != Uptane::Role::Targets()) {
       LOG_ERROR << "Delegated role " << role << " has an invalid type: " << type;
@@ -71,10 +76,10 @@ void Uptane::MetaWithKeys::UnpackSignedObject(const RepositoryType repo, const R
                             "Metadata type " + type.ToString() + " does not match expected role " + role.ToString());
   }
 
-  const std::string canonical = Utils::jsonToCanonicalStr(signed_object["signed"]);
-  const Json::Value signatures = signed_object["signatures"];
-  int valid_signatures = 0;
-
+  // Collect the signatures that count for this role first, so that they can
+  // be checked all at once.
+  std::vector<SignatureCheck> checks;
+  std::vector<std::string> check_keyids;
   std::set<std::string> used_keyids;
   for (auto sig = signatures.begin(); sig != signatures.end(); ++sig) {
     const std::string keyid = (*sig)["keyid"].asString();
@@ -99,11 +104,17 @@ void Uptane::MetaWithKeys::UnpackSignedObject(const RepositoryType repo, const R
       LOG_WARNING << "KeyId " << keyid << " is not valid to sign for this role (" << role.ToString() << ").";
       continue;
     }
-    const std::string signature = (*sig)["sig"].asString();
-    if (keys_[keyid].VerifySignature(signature, canonical)) {
+    checks.emplace_back(keys_[keyid], (*sig)["sig"].asString(), canonical);
+    check_keyids.push_back(keyid);
+  }
+
+  int valid_signatures = 0;
+  const std::vector<bool> valid = Crypto::VerifySignatures(checks);
+  for (size_t i = 0; i < checks.size(); ++i) {
+    if (valid[i]) {
       valid_signatures++;
     } else {
-      LOG_WARNING << "Signature was present but invalid: " << signature << " with KeyId: " << keyid;
+      LOG_WARNING << "Signature was present but invalid: " << checks[i].signature << " with KeyId: " << check_keyids[i];
     }
   }
   const int64_t threshold = thresholds_for_role_[role];
@@ -26,7 +26,8 @@ Root::Root(const RepositoryType repo, const Json::Value &json) : MetaWithKeys(js
   }
 }
 
-void Uptane::Root::UnpackSignedObject(const RepositoryType repo, const Role &role, const Json::Value &signed_object) {
+void Uptane::Root::VerifySignatures(const RepositoryType repo, const Role &role, const Role &type,
+                                    const std::string &canonical, const Json::Value &signatures) {
   const std::string repository = repo;
 
   if (policy_ == Policy::kAcceptAll) {
@@ -37,5 +38,5 @@ void Uptane::Root::UnpackSignedObject(const RepositoryType repo, const Role &rol
   }
   assert(policy_ == Policy::kCheck);
 
-  Uptane::MetaWithKeys::UnpackSignedObject(repo, role, signed_object);
+  Uptane::MetaWithKeys::VerifySignatures(repo, role, type, canonical, signatures);
 }
@@ -1,5 +1,6 @@
 #include "uptane/tuf.h"
 
+#include <algorithm>
 #include <ctime>
 #include <ostream>
 #include <sstream>
@@ -11,7 +12,10 @@
 #include "crypto/crypto.h"
 #include "logging/logging.h"
 #include "utilities/exceptions.h"
+#include "utilities/utils.h"
 
+using Uptane::HardwareIdentifier;
+using Uptane::HardwareIdPool;
 using Uptane::Hash;
 using Uptane::MetaPack;
 using Uptane::Root;
@@ -134,58 +138,95 @@ std::vector<Uptane::Hash> Hash::decodeVector(std::string hashes_str) {
   return hash_v;
 }
 
-Target::Target(std::string filename, const Json::Value &content) : filename_(std::move(filename)) {
+namespace {
+const std::shared_ptr<const std::vector<HardwareIdentifier>> &noHardwareIds() {
+  static const auto empty = std::make_shared<const std::vector<HardwareIdentifier>>();
+  return empty;
+}
+
+void sortHashes(std::vector<Hash> &hashes) {
+  // sort hashes so that higher priority hash algorithm goes first
+  std::sort(hashes.begin(), hashes.end(), [](const Hash &l, const Hash &r) { return l.type() < r.type(); });
+}
+}  // namespace
+
+std::shared_ptr<const std::vector<HardwareIdentifier>> HardwareIdPool::get(std::vector<HardwareIdentifier> hwids) {
+  if (hwids.empty()) {
+    return noHardwareIds();
+  }
+  auto it = pool_.find(hwids);
+  if (it == pool_.end()) {
+    auto shared = std::make_shared<const std::vector<HardwareIdentifier>>(hwids);
+    it = pool_.emplace(std::move(hwids), std::move(shared)).first;
+  }
+  return it->second;
+}
+
+Target::Target(std::string filename, const Json::Value &content, HardwareIdPool *hwid_pool)
+    : data_(std::make_shared<Data>()) {
+  Data &data = *data_;
+  data.filename = std::move(filename);
+  std::vector<HardwareIdentifier> hwids;
   if (content.isMember("custom")) {
-    custom_ = content["custom"];
+    const Json::Value &custom = content["custom"];
+    setCustom(custom);
 
     // Image repo provides an array of hardware IDs.
-    if (custom_.isMember("hardwareIds")) {
-      Json::Value hwids = custom_["hardwareIds"];
-      for (auto i = hwids.begin(); i != hwids.end(); ++i) {
-        hwids_.emplace_back(HardwareIdentifier((*i).asString()));
+    if (custom.isMember("hardwareIds")) {
+      const Json::Value &hwids_json = custom["hardwareIds"];
+      for (auto i = hwids_json.begin(); i != hwids_json.end(); ++i) {
+        hwids.emplace_back(HardwareIdentifier((*i).asString()));
       }
     }
 
     // Director provides a map of ECU serials to hardware IDs.
-    Json::Value ecus = custom_["ecuIdentifiers"];
+    const Json::Value &ecus = custom["ecuIdentifiers"];
     for (auto i = ecus.begin(); i != ecus.end(); ++i) {
-      ecus_.insert({EcuSerial(i.key().asString()), HardwareIdentifier((*i)["hardwareId"].asString())});
+      data.ecus.insert({EcuSerial(i.key().asString()), HardwareIdentifier((*i)["hardwareId"].asString())});
     }
 
-    if (custom_.isMember("targetFormat")) {
-      type_ = custom_["targetFormat"].asString();
+    if (custom.isMember("targetFormat")) {
+      data.type = custom["targetFormat"].asString();
     }
 
-    if (custom_.isMember("uri")) {
-      std::string custom_uri = custom_["uri"].asString();
+    if (custom.isMember("uri")) {
+      std::string custom_uri = custom["uri"].asString();
       // Ignore this exact URL for backwards compatibility with old defaults that inserted it.
       if (custom_uri != "https://example.com/") {
-        uri_ = std::move(custom_uri);
+        data.uri = std::move(custom_uri);
       }
     }
   }
+  if (hwid_pool != nullptr) {
+    data.hwids = hwid_pool->get(std::move(hwids));
+  } else if (!hwids.empty()) {
+    data.hwids = std::make_shared<const std::vector<HardwareIdentifier>>(std::move(hwids));
+  } else {
+    data.hwids = noHardwareIds();
+  }
 
-  length_ = content["length"].asUInt64();
+  data.length = content["length"].asUInt64();
 
-  Json::Value hashes = content["hashes"];
+  const Json::Value &hashes = content["hashes"];
   for (auto i = hashes.begin(); i != hashes.end(); ++i) {
     Hash h(i.key().asString(), (*i).asString());
     if (h.HaveAlgorithm()) {
-      hashes_.push_back(h);
+      data.hashes.push_back(h);
     }
   }
-  // sort hashes so that higher priority hash algorithm goes first
-  std::sort(hashes_.begin(), hashes_.end(), [](const Hash &l, const Hash &r) { return l.type() < r.type(); });
+  sortHashes(data.hashes);
 }
 
 Target::Target(std::string filename, EcuMap ecus, std::vector<Hash> hashes, uint64_t length, std::string correlation_id)
-    : filename_(std::move(filename)),
-      ecus_(std::move(ecus)),
-      hashes_(std::move(hashes)),
-      length_(length),
-      correlation_id_(std::move(correlation_id)) {
-  // sort hashes so that higher priority hash algorithm goes first
-  std::sort(hashes_.begin(), hashes_.end(), [](const Hash &l, const Hash &r) { return l.type() < r.type(); });
+    : data_(std::make_shared<Data>()) {
+  Data &data = *data_;
+  data.filename = std::move(filename);
+  data.ecus = std::move(ecus);
+  data.hashes = std::move(hashes);
+  data.hwids = noHardwareIds();
+  data.length = length;
+  data.correlation_id = std::move(correlation_id);
+  sortHashes(data.hashes);
 }
 
 Target Target::Unknown() {
@@ -194,18 +235,57 @@ Target Target::Unknown() {
   t_json["length"] = 0;
   Uptane::Target target{"unknown", t_json};
 
-  target.valid = false;
+  target.mutableData().valid = false;
 
   return target;
 }
 
+Target::Data &Target::mutableData() {
+  if (data_.use_count() > 1) {
+    data_ = std::make_shared<Data>(*data_);
+  }
+  return *data_;
+}
+
+void Target::setCustom(const Json::Value &custom) {
+  static const Json::StreamWriterBuilder writer = []() {
+    Json::StreamWriterBuilder w;
+    w["indentation"] = "";
+    return w;
+  }();
+
+  Data &data = mutableData();
+  data.custom_parsed.value.reset();
+  if (custom.isNull()) {
+    data.custom.clear();
+    data.custom_version.clear();
+    return;
+  }
+  data.custom = Json::writeString(writer, custom);
+  data.custom_version = custom["version"].asString();
+}
+
+Json::Value Target::custom_data() const {
+  if (data_->custom.empty()) {
+    return Json::Value();
+  }
+  std::shared_ptr<const Json::Value> parsed = std::atomic_load(&data_->custom_parsed.value);
+  if (!parsed) {
+    parsed = std::make_shared<const Json::Value>(Utils::parseJSON(data_->custom));
+    std::atomic_store(&data_->custom_parsed.value, parsed);
+  }
+  return *parsed;
+}
+
+void Target::updateCustom(Json::Value &custom) { setCustom(custom); }
+
 bool Target::MatchHash(const Hash &hash) const {
-  return (std::find(hashes_.begin(), hashes_.end(), hash) != hashes_.end());
+  return (std::find(data_->hashes.begin(), data_->hashes.end(), hash) != data_->hashes.end());
 }
 
 std::string Target::hashString(Hash::Type type) const {
   std::vector<Uptane::Hash>::const_iterator it;
-  for (it = hashes_.begin(); it != hashes_.end(); it++) {
+  for (it = data_->hashes.begin(); it != data_->hashes.end(); it++) {
     if (it->type() == type) {
       return boost::algorithm::to_lower_copy(it->HashString());
     }
@@ -218,10 +298,10 @@ std::string Target::sha256Hash() const { return hashString(Hash::Type::kSha256);
 std::string Target::sha512Hash() const { return hashString(Hash::Type::kSha512); }
 
 bool Target::IsOstree() const {
-  if (type_ == "OSTREE") {
+  if (data_->type == "OSTREE") {
     // Modern servers explicitly specify the type of the target
     return true;
-  } else if (type_.empty() && length() == 0) {
+  } else if (data_->type.empty() && length() == 0) {
     // Older servers don't specify the type of the target. Assume that it is
     // an OSTree target if the length is zero.
     return true;
@@ -233,16 +313,18 @@ bool Target::IsOstree() const {
 }
 
 bool Target::MatchTarget(const Target &t2) const {
-  // type_ (targetFormat) is only provided by the Image repo.
-  // ecus_ is only provided by the Image repo.
-  // correlation_id_ is only provided by the Director.
-  // uri_ is not matched. If the Director provides it, we use that. If not, but
+  // type (targetFormat) is only provided by the Image repo.
+  // ecus is only provided by the Image repo.
+  // correlation_id is only provided by the Director.
+  // uri is not matched. If the Director provides it, we use that. If not, but
   // the Image repository does, use that. Otherwise, leave it empty and use the
   // default.
-  if (filename_ != t2.filename_) {
+  const Data &d1 = *data_;
+  const Data &d2 = *t2.data_;
+  if (d1.filename != d2.filename) {
     return false;
   }
-  if (length_ != t2.length_) {
+  if (d1.length != d2.length) {
     return false;
   }
 
@@ -251,15 +333,15 @@ bool Target::MatchTarget(const Target &t2) const {
   // empty) and a Target from the Image repo (HWID vector populated,
   // ECU->HWID map empty). Figure out which Target has the map, and then for
   // every item in the map, make sure it's in the other Target's HWID vector.
-  if (hwids_ != t2.hwids_ || ecus_ != t2.ecus_) {
-    std::shared_ptr<EcuMap> ecu_map;                               // Director
-    std::shared_ptr<std::vector<HardwareIdentifier>> hwid_vector;  // Image repo
-    if (!hwids_.empty() && ecus_.empty() && t2.hwids_.empty() && !t2.ecus_.empty()) {
-      ecu_map = std::make_shared<EcuMap>(t2.ecus_);
-      hwid_vector = std::make_shared<std::vector<HardwareIdentifier>>(hwids_);
-    } else if (!t2.hwids_.empty() && t2.ecus_.empty() && hwids_.empty() && !ecus_.empty()) {
-      ecu_map = std::make_shared<EcuMap>(ecus_);
-      hwid_vector = std::make_shared<std::vector<HardwareIdentifier>>(t2.hwids_);
+  if (*d1.hwids != *d2.hwids || d1.ecus != d2.ecus) {
+    const EcuMap *ecu_map;                                // Director
+    const std::vector<HardwareIdentifier> *hwid_vector;  // Image repo
+    if (!d1.hwids->empty() && d1.ecus.empty() && d2.hwids->empty() && !d2.ecus.empty()) {
+      ecu_map = &d2.ecus;
+      hwid_vector = d1.hwids.get();
+    } else if (!d2.hwids->empty() && d2.ecus.empty() && d1.hwids->empty() && !d1.ecus.empty()) {
+      ecu_map = &d1.ecus;
+      hwid_vector = d2.hwids.get();
     } else {
       return false;
     }
@@ -275,8 +357,8 @@ bool Target::MatchTarget(const Target &t2) const {
   // - all hashes of the same type should match
   // - at least one pair of hashes should match
   bool oneMatchingHash = false;
-  for (const Hash &hash : hashes_) {
-    for (const Hash &hash2 : t2.hashes_) {
+  for (const Hash &hash : d1.hashes) {
+    for (const Hash &hash2 : d2.hashes) {
       if (hash.type() == hash2.type() && !(hash == hash2)) {
         return false;
       }
@@ -290,40 +372,41 @@ bool Target::MatchTarget(const Target &t2) const {
 
 Json::Value Target::toDebugJson() const {
   Json::Value res;
-  for (const auto &ecu : ecus_) {
+  for (const auto &ecu : data_->ecus) {
     res["custom"]["ecuIdentifiers"][ecu.first.ToString()]["hardwareId"] = ecu.second.ToString();
   }
-  if (!hwids_.empty()) {
+  const std::vector<HardwareIdentifier> &hwids_vector = *data_->hwids;
+  if (!hwids_vector.empty()) {
     Json::Value hwids;
-    for (Json::Value::ArrayIndex i = 0; i < hwids_.size(); ++i) {
-      hwids[i] = hwids_[i].ToString();
+    for (Json::Value::ArrayIndex i = 0; i < hwids_vector.size(); ++i) {
+      hwids[i] = hwids_vector[i].ToString();
     }
     res["custom"]["hardwareIds"] = hwids;
   }
-  res["custom"]["targetFormat"] = type_;
+  res["custom"]["targetFormat"] = data_->type;
 
-  for (const auto &hash : hashes_) {
+  for (const auto &hash : data_->hashes) {
     res["hashes"][hash.TypeString()] = hash.HashString();
   }
-  res["length"] = Json::Value(static_cast<Json::Value::Int64>(length_));
+  res["length"] = Json::Value(static_cast<Json::Value::Int64>(data_->length));
   return res;
 }
 
 std::ostream &Uptane::operator<<(std::ostream &os, const Target &t) {
-  os << "Target(" << t.filename_;
+  os << "Target(" << t.data_->filename;
   os << " ecu_identifiers: (";
-  for (const auto &ecu : t.ecus_) {
+  for (const auto &ecu : t.data_->ecus) {
     os << ecu.first << " (hw_id: " << ecu.second << "), ";
   }
   os << ")"
      << " hw_ids: (";
-  for (const auto &hwid : t.hwids_) {
+  for (const auto &hwid : *t.data_->hwids) {
     os << hwid << ", ";
   }
   os << ")"
      << " length:" << t.length();
   os << " hashes: (";
-  for (const auto &hash : t.hashes_) {
+  for (const auto &hash : t.data_->hashes) {
     os << hash << ", ";
   }
   os << "))";
@@ -332,6 +415,11 @@ std::ostream &Uptane::operator<<(std::ostream &os, const Target &t) {
 }
 
 void Uptane::BaseMeta::init(const Json::Value &json) {
+  parseHeader(json);
+  original_object_ = std::make_shared<const Json::Value>(json);
+}
+
+void Uptane::BaseMeta::parseHeader(const Json::Value &json) {
   if (!json.isObject() || !json.isMember("signed")) {
     LOG_ERROR << "Failure during base metadata initialization from json";
     throw Uptane::InvalidMetadata("", "", "invalid metadata json");
@@ -343,7 +431,6 @@ void Uptane::BaseMeta::init(const Json::Value &json) {
   } catch (const TimeStamp::InvalidTimeStamp &exc) {
     throw Uptane::InvalidMetadata("", "", "invalid timestamp");
   }
-  original_object_ = json;
 }
 Uptane::BaseMeta::BaseMeta(const Json::Value &json) { init(json); }
 
@@ -364,9 +451,11 @@ void Uptane::Targets::init(const Json::Value &json) {
   }
 
   const Json::Value target_list = json["signed"]["targets"];
+  targets.reserve(target_list.size());
+  target_index_.reserve(target_list.size());
+  HardwareIdPool hwid_pool;
   for (auto t_it = target_list.begin(); t_it != target_list.end(); t_it++) {
-    Target t(t_it.key().asString(), *t_it);
-    targets.push_back(t);
+    addTarget(Target(t_it.key().asString(), *t_it, &hwid_pool));
   }
 
   if (json["signed"]["delegations"].isObject()) {
@@ -385,6 +474,7 @@ void Uptane::Targets::init(const Json::Value &json) {
       for (auto p_it = paths_list.begin(); p_it != paths_list.end(); p_it++) {
         paths.emplace_back((*p_it).asString());
       }
+      path_matchers_[role] = std::make_shared<const GlobMatcher>(paths);
       paths_for_role_[role] = paths;
 
       terminating_role_[role] = (*it)["terminating"].asBool();
@@ -400,12 +490,110 @@ void Uptane::Targets::init(const Json::Value &json) {
 
 Uptane::Targets::Targets(const Json::Value &json) : MetaWithKeys(json) { init(json); }
 
+const Uptane::Target *Uptane::Targets::findTarget(const std::string &filename) const {
+  const auto it = target_index_.find(filename);
+  if (it != target_index_.end() && it->second < targets.size() && targets[it->second].filename() == filename) {
+    return &targets[it->second];
+  }
+  if (target_index_.size() == targets.size()) {
+    return nullptr;
+  }
+  // The targets have been modified since the metadata was parsed.
+  const auto found = std::find_if(targets.cbegin(), targets.cend(),
+                                  [&filename](const Target &target) { return target.filename() == filename; });
+  return found != targets.cend() ? &*found : nullptr;
+}
+
+bool Uptane::Targets::isDelegatedPath(const Role &role, const std::string &filename) const {
+  const auto matcher = path_matchers_.find(role);
+  if (matcher != path_matchers_.end()) {
+    return matcher->second->matches(filename);
+  }
+  // Paths that were not parsed from metadata have no matcher.
+  const auto paths = paths_for_role_.find(role);
+  return paths != paths_for_role_.end() && GlobMatcher(paths->second).matches(filename);
+}
+
 Uptane::Targets::Targets(RepositoryType repo, const Role &role, const Json::Value &json,
                          const std::shared_ptr<MetaWithKeys> &signer)
     : MetaWithKeys(repo, role, json, signer), name_(role.ToString()) {
   init(json);
 }
 
+Uptane::Targets::Targets(RepositoryType repo, const Role &role, const std::string &raw,
+                         const std::shared_ptr<MetaWithKeys> &signer)
+    : name_(role.ToString()) {
+  try {
+    const JsonScanner scanner(raw);
+    initFromText(repo, role, scanner, signer);
+  } catch (const JsonScanner::Error &e) {
+    // Not strict JSON (jsoncpp accepts comments, for instance) or not shaped
+    // like metadata: leave it to the full parser to cope with it or to report
+    // what is wrong.
+    LOG_TRACE << "Parsing " << name_ << " metadata as a whole: " << e.what();
+    *this = Targets(repo, role, Utils::parseJSON(raw), signer);
+  }
+}
+
+void Uptane::Targets::initFromText(RepositoryType repo, const Role &role, const JsonScanner &scanner,
+                                   const std::shared_ptr<MetaWithKeys> &signer) {
+  JsonScanner::Span signed_span;
+  if (!scanner.findMember(scanner.document(), "signed", &signed_span)) {
+    throw Uptane::InvalidMetadata("", "", "invalid metadata json");
+  }
+  JsonScanner::Span signatures_span;
+  const Json::Value signatures =
+      scanner.findMember(scanner.document(), "signatures", &signatures_span) ? scanner.parse(signatures_span)
+                                                                             : Json::Value();
+
+  // Everything but the targets themselves, which are parsed one at a time
+  // once the signatures have been checked.
+  Json::Value json;
+  json["signed"] = Json::Value(Json::objectValue);
+  JsonScanner::Span targets_span;
+  bool has_targets = false;
+  scanner.forEachMember(signed_span, [&](const std::string &name, const JsonScanner::Span &value) {
+    if (name == "targets") {
+      targets_span = value;
+      has_targets = true;
+    } else {
+      json["signed"][name] = scanner.parse(value);
+    }
+  });
+
+  signer->VerifySignatures(repo, role, Role(json["signed"]["_type"].asString()), scanner.canonical(signed_span),
+                           signatures);
+  parseHeader(json);
+  init(json);
+
+  if (has_targets) {
+    HardwareIdPool hwid_pool;
+    scanner.forEachMember(targets_span, [&](const std::string &name, const JsonScanner::Span &value) {
+      addTarget(Target(name, scanner.parse(value), &hwid_pool));
+    });
+    // Keep the order of Json::Value, which sorts the targets by filename.
+    const auto by_filename = [](const Target &l, const Target &r) { return l.filename() < r.filename(); };
+    if (!std::is_sorted(targets.cbegin(), targets.cend(), by_filename)) {
+      std::sort(targets.begin(), targets.end(), by_filename);
+      target_index_.clear();
+      for (size_t i = 0; i < targets.size(); ++i) {
+        target_index_.emplace(targets[i].filename(), i);
+      }
+    }
+  }
+}
+
+void Uptane::Targets::addTarget(Target target) {
+  // When a filename appears several times, the last one wins, as with Json::Value.
+  const auto it = target_index_.find(target.filename());
+  if (it != target_index_.end()) {
+    targets[it->second] = std::move(target);
+    return;
+  }
+  target_index_.emplace(target.filename(), targets.size());
+  targets.push_back(std::move(target));
+}
+
 void Uptane::TimestampMeta::init(const Json::Value &json) {
   Json::Value hashes_list = json["signed"]["meta"]["snapshot.json"]["hashes"];
   Json::Value meta_size = json["signed"]["meta"]["snapshot.json"]["length"];
@@ -525,7 +713,18 @@ bool MetaPack::isConsistent() const {
 }
 
 int Uptane::extractVersionUntrusted(const std::string &meta) {
-  auto version_json = Utils::parseJSON(meta)["signed"]["version"];
+  Json::Value version_json;
+  try {
+    const JsonScanner scanner(meta);
+    JsonScanner::Span signed_span;
+    JsonScanner::Span version_span;
+    if (scanner.findMember(scanner.document(), "signed", &signed_span) &&
+        scanner.findMember(signed_span, "version", &version_span)) {
+      version_json = scanner.parse(version_span);
+    }
+  } catch (const JsonScanner::Error &) {
+    version_json = Utils::parseJSON(meta)["signed"]["version"];
+  }
   if (!version_json.isIntegral()) {
     return -1;
   } else {
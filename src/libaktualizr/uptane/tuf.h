@@ -7,12 +7,16 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include "uptane/exceptions.h"
 
 #include "crypto/crypto.h"
+#include "utilities/glob_matcher.h"
+#include "utilities/json_scanner.h"
 #include "utilities/types.h"
 
 namespace Uptane {
@@ -235,40 +239,60 @@ std::ostream &operator<<(std::ostream &os, const Hash &h);
 
 using EcuMap = std::map<EcuSerial, HardwareIdentifier>;
 
+/**
+ * Lets targets that list the same hardware IDs share a single copy of them.
+ * Most targets of a large repository are built for a handful of devices.
+ */
+class HardwareIdPool {
+ public:
+  std::shared_ptr<const std::vector<HardwareIdentifier>> get(std::vector<HardwareIdentifier> hwids);
+
+ private:
+  std::map<std::vector<HardwareIdentifier>, std::shared_ptr<const std::vector<HardwareIdentifier>>> pool_;
+};
+
+/**
+ * A target described by Uptane metadata.
+ *
+ * Repositories can list tens of thousands of targets that are copied around
+ * freely, so the data is kept in a single immutable block that copies share.
+ * The mutators copy it first if it is shared. The custom metadata is kept
+ * serialized and only parsed the first time it is asked for.
+ */
 class Target {
  public:
   // From Uptane metadata
-  Target(std::string filename, const Json::Value &content);
+  Target(std::string filename, const Json::Value &content, HardwareIdPool *hwid_pool = nullptr);
   // Internal, does not have type. Only used for reading installation_versions
   // list and by various tests.
   Target(std::string filename, EcuMap ecus, std::vector<Hash> hashes, uint64_t length, std::string correlation_id = "");
 
   static Target Unknown();
 
-  const EcuMap &ecus() const { return ecus_; }
-  std::string filename() const { return filename_; }
+  const EcuMap &ecus() const { return data_->ecus; }
+  std::string filename() const { return data_->filename; }
   std::string sha256Hash() const;
   std::string sha512Hash() const;
-  const std::vector<Hash> &hashes() const { return hashes_; };
-  const std::vector<HardwareIdentifier> &hardwareIds() const { return hwids_; };
-  std::string custom_version() const { return custom_["version"].asString(); }
-  Json::Value custom_data() const { return custom_; }
-  void updateCustom(Json::Value &custom) { custom_ = custom; };
-  std::string correlation_id() const { return correlation_id_; };
-  void setCorrelationId(std::string correlation_id) { correlation_id_ = std::move(correlation_id); };
-  uint64_t length() const { return length_; }
-  bool IsValid() const { return valid; }
-  std::string uri() const { return uri_; };
-  void setUri(std::string uri) { uri_ = std::move(uri); };
+  const std::vector<Hash> &hashes() const { return data_->hashes; };
+  const std::vector<HardwareIdentifier> &hardwareIds() const { return *data_->hwids; };
+  std::string custom_version() const { return data_->custom_version; }
+  Json::Value custom_data() const;
+  void updateCustom(Json::Value &custom);
+  std::string correlation_id() const { return data_->correlation_id; };
+  void setCorrelationId(std::string correlation_id) { mutableData().correlation_id = std::move(correlation_id); };
+  uint64_t length() const { return data_->length; }
+  bool IsValid() const { return data_->valid; }
+  std::string uri() const { return data_->uri; };
+  void setUri(std::string uri) { mutableData().uri = std::move(uri); };
   bool MatchHash(const Hash &hash) const;
 
-  void InsertEcu(const std::pair<EcuSerial, HardwareIdentifier> &pair) { ecus_.insert(pair); }
+  void InsertEcu(const std::pair<EcuSerial, HardwareIdentifier> &pair) { mutableData().ecus.insert(pair); }
 
   bool IsForEcu(const EcuSerial &ecuIdentifier) const {
-    return (std::find_if(ecus_.cbegin(), ecus_.cend(),
+    return (std::find_if(data_->ecus.cbegin(), data_->ecus.cend(),
                          [&ecuIdentifier](const std::pair<EcuSerial, HardwareIdentifier> &pair) {
                            return pair.first == ecuIdentifier;
-                         }) != ecus_.cend());
+                         }) != data_->ecus.cend());
   };
 
   /**
@@ -278,7 +302,7 @@ class Target {
    * root commit object.
    */
   bool IsOstree() const;
-  std::string type() const { return type_; }
+  std::string type() const { return data_->type; }
 
   // Comparison is usually not meaningful. Use MatchTarget instead.
   bool operator==(const Target &t2) = delete;
@@ -288,17 +312,41 @@ class Target {
   InstalledImageInfo getTargetImageInfo() const { return {filename(), length(), sha256Hash()}; }
 
  private:
-  bool valid{true};
-  std::string filename_;
-  std::string type_;
-  EcuMap ecus_;  // Director only
-  std::vector<Hash> hashes_;
-  std::vector<HardwareIdentifier> hwids_;  // Image repo only
-  Json::Value custom_;
-  uint64_t length_{0};
-  std::string correlation_id_;
-  std::string uri_;
+  // The parsed custom metadata, filled in on first use. Shared copies of the
+  // data may fill it in concurrently, so it is only accessed atomically.
+  struct ParsedCustom {
+    ParsedCustom() = default;
+    ParsedCustom(const ParsedCustom &other) : value(std::atomic_load(&other.value)) {}
+    ParsedCustom &operator=(const ParsedCustom &other) {
+      if (this != &other) {
+        std::atomic_store(&value, std::atomic_load(&other.value));
+      }
+      return *this;
+    }
+    std::shared_ptr<const Json::Value> value;
+  };
+
+  struct Data {
+    bool valid{true};
+    std::string filename;
+    std::string type;
+    EcuMap ecus;  // Director only
+    std::vector<Hash> hashes;
+    std::shared_ptr<const std::vector<HardwareIdentifier>> hwids;  // Image repo only
+    std::string custom;                                            // serialized, empty if there is none
+    ParsedCustom custom_parsed;
+    std::string custom_version;
+    uint64_t length{0};
+    std::string correlation_id;
+    std::string uri;
+  };
+
+  // Never modified while it is shared with another Target, apart from filling
+  // in custom_parsed.
+  std::shared_ptr<Data> data_;
 
+  Data &mutableData();
+  void setCustom(const Json::Value &custom);
   std::string hashString(Hash::Type type) const;
 };
 
@@ -314,14 +362,18 @@ class BaseMeta {
   int version() const { return version_; }
   TimeStamp expiry() const { return expiry_; }
   bool isExpired(const TimeStamp &now) const { return expiry_.IsExpiredAt(now); }
-  Json::Value original() const { return original_object_; }
+  Json::Value original() const { return original_object_ ? *original_object_ : Json::Value(); }
 
   bool operator==(const BaseMeta &rhs) const { return version_ == rhs.version() && expiry_ == rhs.expiry(); }
 
  protected:
   int version_ = {-1};
   TimeStamp expiry_;
-  Json::Value original_object_;
+  // Shared by copies, since it can be as large as the whole metadata file.
+  std::shared_ptr<const Json::Value> original_object_;
+
+  // Reads the version and expiry, without keeping the document.
+  void parseHeader(const Json::Value &json);
 
  private:
   void init(const Json::Value &json);
@@ -367,6 +419,16 @@ class MetaWithKeys : public BaseMeta {
    */
   virtual void UnpackSignedObject(RepositoryType repo, const Role &role, const Json::Value &signed_object);
 
+  /**
+   * The same checks as UnpackSignedObject(), for metadata that has already
+   * been taken apart.
+   * @param type - The value of "_type" in the 'signed' part
+   * @param canonical - The canonical form of the 'signed' part
+   * @param signatures - The 'signatures' part
+   */
+  virtual void VerifySignatures(RepositoryType repo, const Role &role, const Role &type, const std::string &canonical,
+                                const Json::Value &signatures);
+
   bool operator==(const MetaWithKeys &rhs) const {
     return version_ == rhs.version_ && expiry_ == rhs.expiry_ && keys_ == rhs.keys_ &&
            keys_for_role_ == rhs.keys_for_role_ && thresholds_for_role_ == rhs.thresholds_for_role_;
@@ -399,20 +461,11 @@ class Root : public MetaWithKeys {
   ~Root() override = default;
 
   /**
-   * Take a JSON blob that contains a signatures/signed component that is supposedly for a given role, and check that is
-   * suitably signed.
-   * If it is, it returns the contents of the 'signed' part.
-   *
-   * It performs the following checks:
-   * * "_type" matches the given role
-   * * "expires" is in the past (vs 'now')
-   * * The blob has valid signatures from enough keys to cross the threshold for this role
-   * @param repo - Repository type (only used to improve the error messages)
-   * @param role - The Uptane role of the signed metadata object
-   * @param signed_object
-   * @return
+   * Check signatures according to the policy of this Root: not at all,
+   * rejecting all of them, or as MetaWithKeys does.
    */
-  void UnpackSignedObject(RepositoryType repo, const Role &role, const Json::Value &signed_object) override;
+  void VerifySignatures(RepositoryType repo, const Role &role, const Role &type, const std::string &canonical,
+                        const Json::Value &signatures) override;
 
   bool operator==(const Root &rhs) const {
     return version_ == rhs.version_ && expiry_ == rhs.expiry_ && keys_ == rhs.keys_ &&
@@ -441,6 +494,14 @@ class Targets : public MetaWithKeys {
  public:
   explicit Targets(const Json::Value &json);
   Targets(RepositoryType repo, const Role &role, const Json::Value &json, const std::shared_ptr<MetaWithKeys> &signer);
+  /**
+   * Verify and parse metadata straight from its text. Only one target at a
+   * time is turned into a Json::Value, and the signature is checked against
+   * the text itself when it is already in canonical form, so that large
+   * metadata does not need to be held as a whole Json::Value. original() is
+   * not available on the result.
+   */
+  Targets(RepositoryType repo, const Role &role, const std::string &raw, const std::shared_ptr<MetaWithKeys> &signer);
   Targets() = default;
   ~Targets() override = default;
 
@@ -449,11 +510,14 @@ class Targets : public MetaWithKeys {
   }
 
   const std::string &correlation_id() const { return correlation_id_; }
+  const std::string &name() const { return name_; }
 
   void clear() {
     targets.clear();
+    target_index_.clear();
     delegated_role_names_.clear();
     paths_for_role_.clear();
+    path_matchers_.clear();
     terminating_role_.clear();
   }
 
@@ -473,6 +537,20 @@ class Targets : public MetaWithKeys {
     return result;
   }
 
+  /**
+   * The target with the given filename, or nullptr if there is none. Uses an
+   * index built when the metadata is parsed, so that matching Director
+   * targets against a large Image repo does not scan all of its targets.
+   */
+  const Uptane::Target *findTarget(const std::string &filename) const;
+
+  /**
+   * Whether filename matches one of the paths delegated to role. The paths
+   * of each role are compiled into a single matcher when the metadata is
+   * parsed, rather than tried one at a time.
+   */
+  bool isDelegatedPath(const Role &role, const std::string &filename) const;
+
   std::vector<Uptane::Target> targets;
   std::vector<std::string> delegated_role_names_;
   std::map<Role, std::vector<std::string>> paths_for_role_;
@@ -480,9 +558,14 @@ class Targets : public MetaWithKeys {
 
  private:
   void init(const Json::Value &json);
+  void initFromText(RepositoryType repo, const Role &role, const JsonScanner &scanner,
+                    const std::shared_ptr<MetaWithKeys> &signer);
+  void addTarget(Target target);
 
   std::string name_;
   std::string correlation_id_;  // custom non-tuf
+  std::unordered_map<std::string, size_t> target_index_;  // filename -> position in targets
+  std::map<Role, std::shared_ptr<const GlobMatcher>> path_matchers_;  // compiled paths_for_role_
 };
 
 class TimestampMeta : public BaseMeta {
@@ -272,6 +272,171 @@ TEST(Target, HashMismatch) {
   EXPECT_FALSE(target2.MatchTarget(target1));
 }
 
+/* Copies of a Target share their data, but changing one of them does not
+ * affect the others. The custom metadata survives the round trip, and its
+ * parsed form is not shared with a copy whose custom metadata changed. */
+TEST(Target, CopyOnWrite) {
+  std::vector<Uptane::HardwareIdentifier> hardwareIds{Uptane::HardwareIdentifier("fake-test")};
+  Json::Value json = generateImageTarget("hash_good", 739, hardwareIds);
+  json["custom"]["version"] = "42";
+  json["custom"]["uri"] = "https://example.com/abc";
+  const Uptane::Target target("abc", json);
+  EXPECT_EQ(target.custom_version(), "42");
+  EXPECT_EQ(target.custom_data(), json["custom"]);
+
+  Uptane::Target copy = target;
+  EXPECT_EQ(&copy.hardwareIds(), &target.hardwareIds());
+  copy.setUri("https://example.com/def");
+  copy.setCorrelationId("id");
+  copy.InsertEcu({Uptane::EcuSerial("serial"), Uptane::HardwareIdentifier("fake-test")});
+  Json::Value custom;
+  custom["version"] = "43";
+  copy.updateCustom(custom);
+
+  EXPECT_EQ(target.uri(), "https://example.com/abc");
+  EXPECT_EQ(target.correlation_id(), "");
+  EXPECT_TRUE(target.ecus().empty());
+  EXPECT_EQ(target.custom_version(), "42");
+  EXPECT_EQ(copy.uri(), "https://example.com/def");
+  EXPECT_EQ(copy.correlation_id(), "id");
+  EXPECT_EQ(copy.ecus().size(), 1);
+  EXPECT_EQ(copy.custom_version(), "43");
+  EXPECT_EQ(copy.custom_data(), custom);
+  EXPECT_EQ(target.custom_data(), json["custom"]);
+  EXPECT_TRUE(copy.MatchTarget(target));
+
+  EXPECT_FALSE(Uptane::Target::Unknown().IsValid());
+  EXPECT_TRUE(target.IsValid());
+}
+
+/* Targets can be looked up by filename, also in a copy of the metadata. */
+TEST(Targets, FindTarget) {
+  std::vector<Uptane::HardwareIdentifier> hardwareIds{Uptane::HardwareIdentifier("fake-test")};
+  Json::Value json;
+  json["signed"]["_type"] = "Targets";
+  json["signed"]["version"] = 1;
+  json["signed"]["expires"] = "2038-01-19T03:14:06Z";
+  for (int i = 0; i < 100; ++i) {
+    json["signed"]["targets"]["target" + std::to_string(i)] =
+        generateImageTarget("hash" + std::to_string(i), i, hardwareIds);
+  }
+  const Uptane::Targets targets(json);
+  ASSERT_EQ(targets.targets.size(), 100);
+  // Targets for the same hardware share the list of hardware IDs.
+  EXPECT_EQ(&targets.targets[0].hardwareIds(), &targets.targets[99].hardwareIds());
+
+  const Uptane::Target* found = targets.findTarget("target42");
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(found->filename(), "target42");
+  EXPECT_EQ(found->length(), 42);
+  EXPECT_EQ(targets.findTarget("target100"), nullptr);
+
+  Uptane::Targets copy = targets;
+  found = copy.findTarget("target7");
+  ASSERT_NE(found, nullptr);
+  EXPECT_TRUE(found >= copy.targets.data() && found < copy.targets.data() + copy.targets.size());
+  EXPECT_EQ(found->length(), 7);
+
+  copy.clear();
+  EXPECT_EQ(copy.findTarget("target7"), nullptr);
+}
+
+/* Target names are routed to the delegated roles whose paths they match. */
+TEST(Targets, DelegatedPaths) {
+  Json::Value json;
+  json["signed"]["_type"] = "Targets";
+  json["signed"]["version"] = 1;
+  json["signed"]["expires"] = "2038-01-19T03:14:06Z";
+  json["signed"]["delegations"]["keys"] = Json::objectValue;
+  Json::Value role;
+  role["name"] = "role-abc";
+  role["threshold"] = 1;
+  role["terminating"] = false;
+  role["paths"].append("abc/*");
+  role["paths"].append("exact/name");
+  role["paths"].append("img/*.bin");
+  json["signed"]["delegations"]["roles"].append(role);
+  role["name"] = "role-none";
+  role["paths"] = Json::arrayValue;
+  json["signed"]["delegations"]["roles"].append(role);
+
+  const Uptane::Targets targets(json);
+  const auto abc = Uptane::Role::Delegation("role-abc");
+  EXPECT_TRUE(targets.isDelegatedPath(abc, "abc/target"));
+  EXPECT_TRUE(targets.isDelegatedPath(abc, "exact/name"));
+  EXPECT_TRUE(targets.isDelegatedPath(abc, "img/sub/file.bin"));
+  EXPECT_FALSE(targets.isDelegatedPath(abc, "exact/name2"));
+  EXPECT_FALSE(targets.isDelegatedPath(abc, "img/file.img"));
+  EXPECT_FALSE(targets.isDelegatedPath(Uptane::Role::Delegation("role-none"), "abc/target"));
+  EXPECT_FALSE(targets.isDelegatedPath(Uptane::Role::Delegation("role-unknown"), "abc/target"));
+
+  Uptane::Targets copy = targets;
+  EXPECT_TRUE(copy.isDelegatedPath(abc, "abc/target"));
+  copy.clear();
+  EXPECT_FALSE(copy.isDelegatedPath(abc, "abc/target"));
+}
+
+/* A signer that records what it is asked to verify and accepts it. */
+class RecordingSigner : public Uptane::MetaWithKeys {
+ public:
+  void VerifySignatures(Uptane::RepositoryType repo, const Uptane::Role& role, const Uptane::Role& type,
+                        const std::string& canonical, const Json::Value& signatures) override {
+    (void)repo;
+    (void)role;
+    type_ = type.ToString();
+    canonical_ = canonical;
+    signatures_ = signatures;
+  }
+
+  std::string type_;
+  std::string canonical_;
+  Json::Value signatures_;
+};
+
+/* Targets parsed straight from the metadata text are the same as when
+ * parsed from a Json::Value, whether the text is in canonical form or not,
+ * and the signatures are checked against the canonical form. */
+TEST(Targets, FromText) {
+  std::vector<Uptane::HardwareIdentifier> hardwareIds{Uptane::HardwareIdentifier("fake-test")};
+  Json::Value json;
+  json["signed"]["_type"] = "Targets";
+  json["signed"]["version"] = 3;
+  json["signed"]["expires"] = "2038-01-19T03:14:06Z";
+  json["signed"]["custom"]["correlationId"] = "id";
+  for (int i = 0; i < 20; ++i) {
+    json["signed"]["targets"]["dir/target" + std::to_string(i)] =
+        generateImageTarget("hash" + std::to_string(i), i, hardwareIds);
+  }
+  json["signatures"][0]["keyid"] = "key";
+  json["signatures"][0]["method"] = "ed25519";
+  json["signatures"][0]["sig"] = "sig";
+  const Uptane::Targets expected(json);
+
+  const std::vector<std::string> texts{Utils::jsonToCanonicalStr(json), Utils::jsonToStr(json),
+                                       "// not strict JSON\n" + Utils::jsonToStr(json)};
+  for (const auto& text : texts) {
+    auto signer = std::make_shared<RecordingSigner>();
+    const Uptane::Targets targets(Uptane::RepositoryType::Image(), Uptane::Role::Targets(), text, signer);
+    EXPECT_EQ(signer->type_, "targets");
+    EXPECT_EQ(signer->canonical_, Utils::jsonToCanonicalStr(json["signed"]));
+    EXPECT_EQ(signer->signatures_, json["signatures"]);
+
+    EXPECT_TRUE(targets == expected);
+    EXPECT_EQ(targets.correlation_id(), "id");
+    ASSERT_EQ(targets.targets.size(), expected.targets.size());
+    for (size_t i = 0; i < targets.targets.size(); ++i) {
+      EXPECT_EQ(targets.targets[i].filename(), expected.targets[i].filename());
+    }
+    const Uptane::Target* found = targets.findTarget("dir/target12");
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->length(), 12);
+  }
+
+  auto signer = std::make_shared<RecordingSigner>();
+  EXPECT_THROW(Uptane::Targets(Uptane::RepositoryType::Image(), Uptane::Role::Targets(), std::string("[]"), signer),
+               Uptane::InvalidMetadata);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
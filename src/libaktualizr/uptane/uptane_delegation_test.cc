@@ -9,6 +9,7 @@
 #include "httpfake.h"
 #include "primary/aktualizr.h"
 #include "primary/events.h"
+#include "uptane/iterator.h"
 #include "uptane_test_common.h"
 
 boost::filesystem::path uptane_generator_path;
@@ -35,6 +36,14 @@ void delegation_nested(const boost::filesystem::path& delegation_path, bool revo
   EXPECT_EQ(retval, EXIT_SUCCESS) << output;
 }
 
+void delegation_pruned(const boost::filesystem::path& delegation_path) {
+  std::string output;
+  std::string cmd = "tests/uptane_repo_generation/delegation_pruned.sh " + uptane_generator_path.string() + " " +
+                    delegation_path.string();
+  int retval = Utils::shell(cmd, &output, true);
+  EXPECT_EQ(retval, EXIT_SUCCESS) << output;
+}
+
 class HttpFakeDelegation : public HttpFake {
  public:
   HttpFakeDelegation(const boost::filesystem::path& test_dir_in)
@@ -236,6 +245,121 @@ TEST(Delegation, IterateAll) {
   EXPECT_TRUE(expected_target_names.empty());
 }
 
+/* Resolve the roles of the delegation tree that may contain the given
+ * targets, or all of them, and report failures only for the roles that are
+ * asked for. Roles verified before are reused while the stored metadata does
+ * not change. */
+TEST(Delegation, Resolver) {
+  TemporaryDirectory temp_dir;
+  auto delegation_path = temp_dir.Path() / "delegation_test";
+  delegation_nested(delegation_path, false);
+  auto http = std::make_shared<HttpFakeDelegation>(temp_dir.Path());
+
+  Config conf = UptaneTestCommon::makeTestConfig(temp_dir, http->tls_server);
+  auto storage = INvStorage::newStorage(conf.storage);
+  Uptane::Fetcher fetcher(conf, http);
+  Uptane::ImageRepository image_repo;
+  ASSERT_TRUE(image_repo.updateMeta(*storage, fetcher));
+  std::string meta;
+
+  {
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, false, 4);
+    resolver.prefetch({"abc/target0"});
+    EXPECT_TRUE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-abc")));
+    EXPECT_FALSE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-bcd")));
+    const auto top = resolver.get(Uptane::Role::Delegation("delegation-top"), *image_repo.getTargets());
+    const auto abc = resolver.get(Uptane::Role::Delegation("role-abc"), *top);
+    EXPECT_EQ(abc->targets.size(), 4);
+  }
+  {
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, false, 4);
+    resolver.prefetch();
+    for (const auto* name : {"delegation-top", "role-abc", "role-bcd", "role-cde", "role-def"}) {
+      EXPECT_TRUE(storage->loadDelegation(&meta, Uptane::Role::Delegation(name))) << name;
+    }
+  }
+  {
+    // What was verified once is reused as long as storage and Snapshot agree.
+    Uptane::DelegationResolver first(image_repo, *storage, fetcher, true, 4);
+    Uptane::DelegationResolver second(image_repo, *storage, fetcher, true, 4);
+    const auto top = first.get(Uptane::Role::Delegation("delegation-top"), *image_repo.getTargets());
+    EXPECT_EQ(second.get(Uptane::Role::Delegation("delegation-top"), *image_repo.getTargets()), top);
+  }
+  {
+    storage->deleteDelegation(Uptane::Role::Delegation("role-def"));
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, true, 4);
+    resolver.prefetch();
+    const auto top = resolver.get(Uptane::Role::Delegation("delegation-top"), *image_repo.getTargets());
+    EXPECT_EQ(resolver.get(Uptane::Role::Delegation("role-bcd"), *top)->targets.size(), 1);
+    EXPECT_THROW(resolver.get(Uptane::Role::Delegation("role-def"), *top), Uptane::DelegationMissing);
+  }
+  {
+    storage->storeDelegation("{\"signed\": {\"version\": 1}}", Uptane::Role::Delegation("role-abc"));
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, true, 4);
+    const auto top = resolver.get(Uptane::Role::Delegation("delegation-top"), *image_repo.getTargets());
+    EXPECT_ANY_THROW(resolver.get(Uptane::Role::Delegation("role-abc"), *top));
+  }
+}
+
+/* Prefetching skips the roles that a search for a target never reaches:
+ * below an expired role, below a terminating role, and below the first role
+ * listing the target. */
+TEST(Delegation, ResolverPruning) {
+  TemporaryDirectory temp_dir;
+  auto delegation_path = temp_dir.Path() / "delegation_test";
+  delegation_pruned(delegation_path);
+  auto http = std::make_shared<HttpFakeDelegation>(temp_dir.Path());
+
+  Config conf = UptaneTestCommon::makeTestConfig(temp_dir, http->tls_server);
+  auto storage = INvStorage::newStorage(conf.storage);
+  Uptane::Fetcher fetcher(conf, http);
+  Uptane::ImageRepository image_repo;
+  ASSERT_TRUE(image_repo.updateMeta(*storage, fetcher));
+  std::string meta;
+
+  {
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, false, 4);
+    resolver.prefetch({"abe/target0"});
+    EXPECT_TRUE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-first")));
+    EXPECT_FALSE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-below-first")));
+    EXPECT_FALSE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-expired")));
+  }
+  {
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, false, 4);
+    resolver.prefetch({"abe/target1"});
+    EXPECT_TRUE(storage->loadDelegation(&meta, Uptane::Role::Delegation("role-below-first")));
+  }
+  {
+    Uptane::DelegationResolver resolver(image_repo, *storage, fetcher, false, 4);
+    resolver.prefetch();
+    for (const auto* name : {"delegation-top", "role-expired", "role-terminating"}) {
+      EXPECT_TRUE(storage->loadDelegation(&meta, Uptane::Role::Delegation(name))) << name;
+    }
+    for (const auto* name : {"role-below-expired", "role-below-terminating"}) {
+      EXPECT_FALSE(storage->loadDelegation(&meta, Uptane::Role::Delegation(name))) << name;
+    }
+  }
+}
+
+/* A cached delegation is only reused while Snapshot lists it with the same
+ * version and the same hashes, as the hashes are not checked again. */
+TEST(Delegation, CacheKey) {
+  Uptane::DelegationCache cache;
+  const Uptane::Role role = Uptane::Role::Delegation("role-abc");
+  const std::string raw = "{\"signed\": {\"version\": 2}}";
+  const Uptane::Targets parent;
+  const std::vector<Uptane::Hash> hashes{Uptane::Hash(Uptane::Hash::Type::kSha256, std::string(64, 'a'))};
+  const std::vector<Uptane::Hash> other_hashes{Uptane::Hash(Uptane::Hash::Type::kSha256, std::string(64, 'b'))};
+  auto targets = std::make_shared<const Uptane::Targets>();
+
+  cache.store(role, raw, 2, hashes, parent, targets);
+  EXPECT_EQ(cache.find(role, raw, 2, hashes, parent), targets);
+  EXPECT_EQ(cache.find(role, raw, 3, hashes, parent), nullptr);
+  EXPECT_EQ(cache.find(role, raw, 2, other_hashes, parent), nullptr);
+  EXPECT_EQ(cache.find(role, raw, 2, std::vector<Uptane::Hash>(), parent), nullptr);
+  EXPECT_EQ(cache.find(role, raw + " ", 2, hashes, parent), nullptr);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,4 +1,7 @@
 #include "apiqueue.h"
+
+#include <stdexcept>
+
 #include "logging/logging.h"
 
 namespace api {
@@ -43,6 +46,11 @@ void FlowControlToken::reset() {
   state_ = State::kRunning;
 }
 
+constexpr CommandQueue::Lanes CommandQueue::kControlLane;
+constexpr CommandQueue::Lanes CommandQueue::kMetadataLane;
+constexpr CommandQueue::Lanes CommandQueue::kTransferLane;
+constexpr CommandQueue::Lanes CommandQueue::kAllLanes;
+
 CommandQueue::~CommandQueue() {
   try {
     abort(false);
@@ -55,22 +63,60 @@ CommandQueue::~CommandQueue() {
 
 void CommandQueue::run() {
   std::lock_guard<std::mutex> g(thread_m_);
-  if (!thread_.joinable()) {
-    thread_ = std::thread([this] {
-      std::unique_lock<std::mutex> lock(m_);
-      for (;;) {
-        cv_.wait(lock, [this] { return (!queue_.empty() && !paused_) || shutdown_; });
-        if (shutdown_) {
-          break;
-        }
-        auto task = std::move(queue_.front());
-        queue_.pop();
-        lock.unlock();
-        task();
-        lock.lock();
+  if (threads_.empty()) {
+    for (Lanes lane = 1; (lane & kAllLanes) != 0; lane <<= 1U) {
+      threads_.emplace_back([this] { work(); });
+    }
+  }
+}
+
+void CommandQueue::work() {
+  std::unique_lock<std::mutex> lock(m_);
+  for (;;) {
+    auto next = queue_.end();
+    cv_.wait(lock, [this, &next] {
+      if (shutdown_) {
+        return true;
       }
+      next = paused_ ? queue_.end() : nextCommand();
+      return next != queue_.end();
     });
+    if (shutdown_) {
+      break;
+    }
+    Command command = std::move(*next);
+    queue_.erase(next);
+    busy_lanes_ |= command.lanes;
+    lock.unlock();
+    command.task();
+    lock.lock();
+    busy_lanes_ &= ~command.lanes;
+    cv_.notify_all();
+  }
+}
+
+std::deque<CommandQueue::Command>::iterator CommandQueue::nextCommand() {
+  // A command has to wait for the running ones and for those queued before it
+  // in any of its lanes.
+  Lanes blocked = busy_lanes_;
+  for (auto it = queue_.begin(); it != queue_.end() && blocked != kAllLanes; ++it) {
+    if ((it->lanes & blocked) == 0) {
+      return it;
+    }
+    blocked |= it->lanes;
+  }
+  return queue_.end();
+}
+
+void CommandQueue::push(std::packaged_task<void()> task, Lanes lanes) {
+  if ((lanes & kAllLanes) == 0) {
+    throw std::invalid_argument("A command needs at least one lane");
   }
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    queue_.push_back(Command{std::move(task), lanes & kAllLanes});
+  }
+  cv_.notify_all();
 }
 
 bool CommandQueue::pause(bool do_pause) {
@@ -95,13 +141,15 @@ void CommandQueue::abort(bool restart_thread) {
       shutdown_ = true;
     }
     cv_.notify_all();
-    if (thread_.joinable()) {
-      thread_.join();
+    for (auto& thread : threads_) {
+      thread.join();
     }
+    threads_.clear();
     {
       // Flush the queue and reset to initial state
       std::lock_guard<std::mutex> g(m_);
-      std::queue<std::packaged_task<void()>>().swap(queue_);
+      std::deque<Command>().swap(queue_);
+      busy_lanes_ = 0;
       token_.reset();
       shutdown_ = false;
     }
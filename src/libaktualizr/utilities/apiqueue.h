@@ -3,12 +3,13 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace api {
 
@@ -54,45 +55,66 @@ class FlowControlToken {
   mutable std::condition_variable cv_;
 };
 
+///
+/// Runs the commands of the library on background threads. Every command
+/// occupies one or more lanes. A command starts once all the commands queued
+/// before it in any of its lanes have finished, so the commands that share a
+/// lane run one at a time in FIFO order. Commands without a lane in common
+/// can run concurrently, so that a long download does not hold up a quick
+/// call on another lane.
+///
 class CommandQueue {
  public:
+  using Lanes = unsigned int;
+  /// Calls that only talk to the server, such as campaign handling.
+  static constexpr Lanes kControlLane = 1U << 0U;
+  /// Calls that report the state of the device or update the metadata.
+  static constexpr Lanes kMetadataLane = 1U << 1U;
+  /// Downloads and installations.
+  static constexpr Lanes kTransferLane = 1U << 2U;
+  static constexpr Lanes kAllLanes = kControlLane | kMetadataLane | kTransferLane;
+
   ~CommandQueue();
   void run();
   bool pause(bool do_pause);  // returns true iff pause→resume or resume→pause
   void abort(bool restart_thread = true);
 
   template <class R>
-  std::future<R> enqueue(const std::function<R()>& f) {
+  std::future<R> enqueue(const std::function<R()>& f, Lanes lanes = kAllLanes) {
     std::packaged_task<R()> task(f);
     auto r = task.get_future();
-    {
-      std::lock_guard<std::mutex> lock(m_);
-      queue_.push(std::packaged_task<void()>(std::move(task)));
-    }
-    cv_.notify_all();
+    push(std::packaged_task<void()>(std::move(task)), lanes);
     return r;
   }
 
   template <class R>
-  std::future<R> enqueue(const std::function<R(const api::FlowControlToken*)>& f) {
+  std::future<R> enqueue(const std::function<R(const api::FlowControlToken*)>& f, Lanes lanes = kAllLanes) {
     std::packaged_task<R()> task(std::bind(f, &token_));
     auto r = task.get_future();
-    {
-      std::lock_guard<std::mutex> lock(m_);
-      queue_.push(std::packaged_task<void()>(std::move(task)));
-    }
-    cv_.notify_all();
+    push(std::packaged_task<void()>(std::move(task)), lanes);
     return r;
   }
 
  private:
+  struct Command {
+    std::packaged_task<void()> task;
+    Lanes lanes;
+  };
+
+  void push(std::packaged_task<void()> task, Lanes lanes);
+  // The first command that can start, or queue_.end(). Call with m_ locked.
+  std::deque<Command>::iterator nextCommand();
+  void work();
+
   std::atomic_bool shutdown_{false};
   std::atomic_bool paused_{false};
 
-  std::thread thread_;
+  // One thread per lane, as at most one command runs in each lane.
+  std::vector<std::thread> threads_;
   std::mutex thread_m_;
 
-  std::queue<std::packaged_task<void()>> queue_;
+  std::deque<Command> queue_;
+  Lanes busy_lanes_{0};
   std::mutex m_;
   std::condition_variable cv_;
   FlowControlToken token_;
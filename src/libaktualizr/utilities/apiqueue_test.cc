@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utilities/apiqueue.h"
+
+using api::CommandQueue;
+
+namespace {
+
+const std::chrono::seconds kTimeout{10};
+
+// Records the order in which commands run.
+class Trace {
+ public:
+  std::function<void()> command(const std::string& name) {
+    return [this, name] {
+      std::lock_guard<std::mutex> guard(m_);
+      names_.push_back(name);
+    };
+  }
+  std::vector<std::string> names() {
+    std::lock_guard<std::mutex> guard(m_);
+    return names_;
+  }
+
+ private:
+  std::mutex m_;
+  std::vector<std::string> names_;
+};
+
+}  // namespace
+
+/* Commands on other lanes run while a long command is running. */
+TEST(CommandQueue, LanesRunConcurrently) {
+  CommandQueue queue;
+  queue.run();
+
+  std::promise<void> release;
+  std::shared_future<void> released(release.get_future());
+  std::function<void()> download([released] { released.wait(); });
+  auto download_done = queue.enqueue(download, CommandQueue::kTransferLane);
+
+  std::function<int()> campaign([] { return 1; });
+  std::function<int()> manifest([] { return 2; });
+  auto campaign_done = queue.enqueue(campaign, CommandQueue::kControlLane);
+  auto manifest_done = queue.enqueue(manifest, CommandQueue::kMetadataLane);
+  ASSERT_EQ(campaign_done.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(manifest_done.wait_for(kTimeout), std::future_status::ready);
+  EXPECT_EQ(campaign_done.get(), 1);
+  EXPECT_EQ(manifest_done.get(), 2);
+  EXPECT_NE(download_done.wait_for(std::chrono::milliseconds(0)), std::future_status::ready);
+
+  release.set_value();
+  EXPECT_EQ(download_done.wait_for(kTimeout), std::future_status::ready);
+}
+
+/* Commands that share a lane run in the order they were queued, even when a
+ * later one could start earlier. */
+TEST(CommandQueue, SharedLanesKeepOrder) {
+  CommandQueue queue;
+  Trace trace;
+
+  std::promise<void> release;
+  std::shared_future<void> released(release.get_future());
+  std::function<void()> download([&trace, released] {
+    released.wait();
+    trace.command("download")();
+  });
+  std::function<void()> check(trace.command("check"));
+  std::function<void()> manifest(trace.command("manifest"));
+  std::function<void()> install(trace.command("install"));
+  std::function<void()> campaign(trace.command("campaign"));
+
+  auto download_done = queue.enqueue(download, CommandQueue::kTransferLane);
+  auto check_done = queue.enqueue(check, CommandQueue::kMetadataLane | CommandQueue::kTransferLane);
+  auto manifest_done = queue.enqueue(manifest, CommandQueue::kMetadataLane);
+  auto install_done = queue.enqueue(install, CommandQueue::kTransferLane);
+  auto campaign_done = queue.enqueue(campaign, CommandQueue::kControlLane);
+  queue.run();
+
+  ASSERT_EQ(campaign_done.wait_for(kTimeout), std::future_status::ready);
+  // The check waits for the download, and the manifest for the check.
+  EXPECT_NE(manifest_done.wait_for(std::chrono::milliseconds(100)), std::future_status::ready);
+
+  release.set_value();
+  ASSERT_EQ(install_done.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(manifest_done.wait_for(kTimeout), std::future_status::ready);
+  const std::vector<std::string> names = trace.names();
+  ASSERT_EQ(names.size(), 5);
+  EXPECT_EQ(names[0], "campaign");
+  EXPECT_EQ(names[1], "download");
+  EXPECT_EQ(names[2], "check");
+  // The manifest and the installation have no lane in common.
+  EXPECT_TRUE((names[3] == "manifest" && names[4] == "install") ||
+              (names[3] == "install" && names[4] == "manifest"));
+}
+
+/* No command starts while the queue is paused, and abort drops the queued
+ * ones. */
+TEST(CommandQueue, PauseAndAbort) {
+  CommandQueue queue;
+  queue.run();
+  EXPECT_TRUE(queue.pause(true));
+  EXPECT_FALSE(queue.pause(true));
+
+  std::function<int()> campaign([] { return 1; });
+  auto paused_done = queue.enqueue(campaign, CommandQueue::kControlLane);
+  EXPECT_EQ(paused_done.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+
+  EXPECT_TRUE(queue.pause(false));
+  ASSERT_EQ(paused_done.wait_for(kTimeout), std::future_status::ready);
+  EXPECT_EQ(paused_done.get(), 1);
+
+  queue.pause(true);
+  auto dropped = queue.enqueue(campaign);
+  queue.abort();
+  EXPECT_THROW(dropped.get(), std::future_error);
+
+  queue.pause(false);
+  auto restarted = queue.enqueue(campaign);
+  ASSERT_EQ(restarted.wait_for(kTimeout), std::future_status::ready);
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
@@ -0,0 +1,130 @@
+#include "canonical_json.h"
+
+void CanonicalJsonWriter::write(const Json::Value &json, std::string *out) {
+  out->clear();
+  if (!CanonicalJsonWriter(*out).writeValue(json)) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    *out = Json::writeString(builder, json);
+  }
+}
+
+bool CanonicalJsonWriter::writeValue(const Json::Value &value) {
+  if (value.hasComment(Json::commentBefore) || value.hasComment(Json::commentAfterOnSameLine) ||
+      value.hasComment(Json::commentAfter)) {
+    return false;
+  }
+
+  switch (value.type()) {
+    case Json::nullValue:
+      buffer_ += "null";
+      return true;
+    case Json::intValue: {
+      const Json::LargestInt number = value.asLargestInt();
+      // Negate in unsigned arithmetic, which also works for the smallest value.
+      writeInteger(number < 0 ? 0 - static_cast<uint64_t>(number) : static_cast<uint64_t>(number), number < 0);
+      return true;
+    }
+    case Json::uintValue:
+      writeInteger(value.asLargestUInt(), false);
+      return true;
+    case Json::realValue:
+      buffer_ += Json::valueToString(value.asDouble());
+      return true;
+    case Json::stringValue: {
+      const char *begin = nullptr;
+      const char *end = nullptr;
+      value.getString(&begin, &end);
+      return writeString(begin, end);
+    }
+    case Json::booleanValue:
+      buffer_ += value.asBool() ? "true" : "false";
+      return true;
+    case Json::arrayValue: {
+      buffer_ += '[';
+      const Json::ArrayIndex size = value.size();
+      for (Json::ArrayIndex i = 0; i < size; ++i) {
+        if (i > 0) {
+          buffer_ += ',';
+        }
+        if (!writeValue(value[i])) {
+          return false;
+        }
+      }
+      buffer_ += ']';
+      return true;
+    }
+    case Json::objectValue: {
+      buffer_ += '{';
+      // Members are kept sorted by name, which is the canonical order.
+      for (auto it = value.begin(); it != value.end(); ++it) {
+        if (it != value.begin()) {
+          buffer_ += ',';
+        }
+        const char *name_end = nullptr;
+        const char *name = it.memberName(&name_end);
+        if (!writeString(name, name_end)) {
+          return false;
+        }
+        buffer_ += ':';
+        if (!writeValue(*it)) {
+          return false;
+        }
+      }
+      buffer_ += '}';
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CanonicalJsonWriter::writeString(const char *begin, const char *end) {
+  if (begin == nullptr) {
+    buffer_ += "\"\"";
+    return true;
+  }
+  bool escape = false;
+  for (const char *c = begin; c != end; ++c) {
+    const auto byte = static_cast<unsigned char>(*c);
+    if (byte == 0) {
+      // Not representable in what jsoncpp exposes for quoting strings.
+      return false;
+    }
+    if (byte < 0x20 || byte >= 0x80) {
+      // jsoncpp versions differ in how they write these, so leave it to the
+      // one in use.
+      buffer_ += Json::valueToQuotedString(std::string(begin, end).c_str());
+      return true;
+    }
+    escape = escape || byte == '"' || byte == '\\';
+  }
+
+  buffer_ += '"';
+  if (!escape) {
+    buffer_.append(begin, end);
+  } else {
+    for (const char *c = begin; c != end; ++c) {
+      if (*c == '"' || *c == '\\') {
+        buffer_ += '\\';
+      }
+      buffer_ += *c;
+    }
+  }
+  buffer_ += '"';
+  return true;
+}
+
+void CanonicalJsonWriter::writeInteger(uint64_t magnitude, const bool negative) {
+  char digits[20];
+  size_t count = 0;
+  do {
+    digits[count++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (negative) {
+    buffer_ += '-';
+  }
+  while (count > 0) {
+    buffer_ += digits[--count];
+  }
+}
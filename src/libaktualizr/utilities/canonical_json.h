@@ -0,0 +1,39 @@
+#ifndef UTILITIES_CANONICAL_JSON_H_
+#define UTILITIES_CANONICAL_JSON_H_
+
+#include <cstdint>
+#include <string>
+
+#include <json/json.h>
+
+/**
+ * Writes a Json::Value in the canonical form used for signatures: members
+ * sorted by name, no whitespace. The output is byte for byte what jsoncpp's
+ * StreamWriterBuilder writes without indentation, but it goes straight into
+ * the caller's buffer, which can be reused from one call to the next,
+ * without building a string for every node.
+ *
+ * The rare values that jsoncpp formats in version-dependent ways (strings
+ * with control or non-ASCII characters, floating point numbers) are
+ * formatted by jsoncpp itself, and a value that carries comments is handed
+ * to jsoncpp's writer as a whole.
+ */
+class CanonicalJsonWriter {
+ public:
+  /**
+   * Replace the contents of out with the canonical form of json, reusing
+   * its storage.
+   */
+  static void write(const Json::Value &json, std::string *out);
+
+ private:
+  explicit CanonicalJsonWriter(std::string &buffer) : buffer_(buffer) {}
+
+  bool writeValue(const Json::Value &value);
+  bool writeString(const char *begin, const char *end);
+  void writeInteger(uint64_t magnitude, bool negative);
+
+  std::string &buffer_;
+};
+
+#endif  // UTILITIES_CANONICAL_JSON_H_
@@ -0,0 +1,84 @@
+#include "glob_matcher.h"
+
+#include <fnmatch.h>
+#include <cstring>
+
+GlobMatcher::GlobMatcher(const std::vector<std::string> &patterns) {
+  for (const auto &pattern : patterns) {
+    add(pattern);
+  }
+}
+
+void GlobMatcher::add(const std::string &pattern) {
+  if (nodes_.empty()) {
+    nodes_.emplace_back();
+  }
+  // fnmatch() only sees the pattern up to its first NUL.
+  const char *text = pattern.c_str();
+  const size_t length = std::strlen(text);
+
+  size_t node = 0;
+  size_t pos = 0;
+  while (pos < length) {
+    char c = text[pos];
+    if (c == '*' || c == '?' || c == '[') {
+      break;
+    }
+    if (c == '\\') {
+      if (pos + 1 == length) {
+        // Leave a trailing backslash to fnmatch().
+        break;
+      }
+      c = text[pos + 1];
+      ++pos;
+    }
+    ++pos;
+
+    auto it = nodes_[node].children.find(c);
+    if (it != nodes_[node].children.end()) {
+      node = it->second;
+    } else {
+      nodes_[node].children.emplace(c, nodes_.size());
+      node = nodes_.size();
+      nodes_.emplace_back();
+    }
+  }
+
+  if (pos == length) {
+    nodes_[node].exact = true;
+  } else if (pos + 1 == length && text[pos] == '*') {
+    nodes_[node].any_suffix = true;
+  } else {
+    nodes_[node].globs.emplace_back(text, length);
+  }
+}
+
+bool GlobMatcher::matches(const std::string &name) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+  // Like fnmatch(), only look at the name up to its first NUL.
+  const char *text = name.c_str();
+  const size_t length = std::strlen(text);
+
+  size_t node = 0;
+  for (size_t pos = 0;; ++pos) {
+    const Node &current = nodes_[node];
+    if (current.any_suffix) {
+      return true;
+    }
+    for (const auto &glob : current.globs) {
+      if (fnmatch(glob.c_str(), text, 0) == 0) {
+        return true;
+      }
+    }
+    if (pos == length) {
+      return current.exact;
+    }
+    auto it = current.children.find(text[pos]);
+    if (it == current.children.end()) {
+      return false;
+    }
+    node = it->second;
+  }
+}
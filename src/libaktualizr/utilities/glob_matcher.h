@@ -0,0 +1,40 @@
+#ifndef UTILITIES_GLOB_MATCHER_H_
+#define UTILITIES_GLOB_MATCHER_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Matches names against a set of shell wildcard patterns, with the same
+ * result as trying each of them with fnmatch(3) and no flags.
+ *
+ * The patterns are compiled into a trie of their literal prefixes. Patterns
+ * without wildcards and patterns that only end with a '*', which are what
+ * delegations list most of the time, are matched by walking the name down
+ * the trie. Other patterns are only handed to fnmatch() when the name starts
+ * with their literal prefix.
+ */
+class GlobMatcher {
+ public:
+  GlobMatcher() = default;
+  explicit GlobMatcher(const std::vector<std::string> &patterns);
+
+  bool matches(const std::string &name) const;
+  bool empty() const { return nodes_.empty(); }
+
+ private:
+  struct Node {
+    std::map<char, size_t> children;
+    bool exact{false};               // a pattern without wildcards ends here
+    bool any_suffix{false};          // a pattern is this prefix followed by '*'
+    std::vector<std::string> globs;  // other patterns with this literal prefix
+  };
+
+  void add(const std::string &pattern);
+
+  std::vector<Node> nodes_;
+};
+
+#endif  // UTILITIES_GLOB_MATCHER_H_
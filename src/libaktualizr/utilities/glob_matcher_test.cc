@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <fnmatch.h>
+#include <string>
+#include <vector>
+
+#include "utilities/glob_matcher.h"
+
+namespace {
+
+bool anyFnmatch(const std::vector<std::string> &patterns, const std::string &name) {
+  for (const auto &pattern : patterns) {
+    if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+/* Each pattern on its own, and all of them together, match the same names as
+ * fnmatch() does. */
+TEST(GlobMatcher, SameAsFnmatch) {
+  const std::vector<std::string> patterns{
+      "",        "*",          "abc",      "abc/*",     "abc/*/x", "ab?/target", "a[bc]d",
+      "a[!b]d",  "a\\*c",      "a\\bc*",   "trailing\\", "*.bin",  "dir/sub*",   "dir/sub/*",
+      "[",       "x[a-c]*",    "?",        "**",        "a*b*c",   "abc/*.img",  ".hidden*"};
+  const std::vector<std::string> names{
+      "",         "a",          "abc",       "abc/",        "abc/def",    "abc/def/x", "abd/target",
+      "abcd",     "acd",        "aed",       "abd",         "a*c",        "abcde",     "trailing\\",
+      "trailing", "file.bin",   "dir/subdir", "dir/sub/x",  "[",          "xb/file",   "ab/.hidden",
+      ".hidden",  "aXbYc",      "abc/x.img", "abc/d/x.img", "ab",         "abc\\"};
+
+  for (const auto &pattern : patterns) {
+    const GlobMatcher matcher({pattern});
+    for (const auto &name : names) {
+      EXPECT_EQ(matcher.matches(name), anyFnmatch({pattern}, name)) << pattern << " " << name;
+    }
+  }
+
+  const GlobMatcher all(patterns);
+  const std::vector<std::string> some(patterns.begin() + 2, patterns.begin() + 8);
+  const GlobMatcher matcher_some(some);
+  for (const auto &name : names) {
+    EXPECT_EQ(all.matches(name), anyFnmatch(patterns, name)) << name;
+    EXPECT_EQ(matcher_some.matches(name), anyFnmatch(some, name)) << name;
+  }
+}
+
+/* Nothing matches an empty set of patterns. */
+TEST(GlobMatcher, Empty) {
+  const GlobMatcher matcher;
+  EXPECT_TRUE(matcher.empty());
+  EXPECT_FALSE(matcher.matches(""));
+  EXPECT_FALSE(matcher.matches("abc"));
+  EXPECT_TRUE(GlobMatcher(std::vector<std::string>()).empty());
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
@@ -0,0 +1,291 @@
+#include "json_scanner.h"
+
+#include <cctype>
+#include <cstring>
+
+#include "utilities/utils.h"
+
+const int JsonScanner::kMaxDepth = 1000;
+
+JsonScanner::JsonScanner(const std::string &text)
+    : text_(text), reader_(Json::CharReaderBuilder().newCharReader()) {
+  size_t pos = 0;
+  skipWhitespace(pos);
+  document_ = scanValue(pos, 0);
+  skipWhitespace(pos);
+  if (pos != text_.size()) {
+    throw Error("Unexpected data after the JSON document at offset " + std::to_string(pos));
+  }
+}
+
+void JsonScanner::forEachMember(const Span &object, const MemberCallback &fn) const {
+  size_t pos = object.begin;
+  if (pos >= text_.size() || text_[pos] != '{') {
+    throw Error("Not a JSON object at offset " + std::to_string(pos));
+  }
+  scanObject(pos, 0, &fn);
+}
+
+bool JsonScanner::findMember(const Span &object, const std::string &name, Span *value) const {
+  bool found = false;
+  forEachMember(object, [&](const std::string &member, const Span &member_value) {
+    if (member == name) {
+      *value = member_value;
+      found = true;
+    }
+  });
+  return found;
+}
+
+Json::Value JsonScanner::parse(const Span &span) const {
+  // Same settings as Utils::parseJSON(), without copying the text.
+  Json::Value value;
+  reader_->parse(text_.data() + span.begin, text_.data() + span.end, &value, nullptr);
+  return value;
+}
+
+std::string JsonScanner::canonical(const Span &span) const {
+  if (span.canonical) {
+    return str(span);
+  }
+  return Utils::jsonToCanonicalStr(parse(span));
+}
+
+JsonScanner::Span JsonScanner::scanValue(size_t &pos, const int depth) const {
+  if (depth > kMaxDepth) {
+    throw Error("JSON document nested too deeply");
+  }
+  if (pos >= text_.size()) {
+    throw Error("Unexpected end of JSON document");
+  }
+  Span span;
+  span.begin = pos;
+  switch (text_[pos]) {
+    case '{':
+      span.canonical = scanObject(pos, depth, nullptr);
+      break;
+    case '[':
+      span.canonical = scanArray(pos, depth);
+      break;
+    case '"':
+      span.canonical = scanString(pos, nullptr);
+      break;
+    case 't':
+      scanLiteral(pos, "true");
+      span.canonical = true;
+      break;
+    case 'f':
+      scanLiteral(pos, "false");
+      span.canonical = true;
+      break;
+    case 'n':
+      scanLiteral(pos, "null");
+      span.canonical = true;
+      break;
+    default:
+      span.canonical = scanNumber(pos);
+      break;
+  }
+  span.end = pos;
+  return span;
+}
+
+bool JsonScanner::scanObject(size_t &pos, const int depth, const MemberCallback *fn) const {
+  expect(pos, '{');
+  bool canonical = !skipWhitespace(pos);
+  if (pos < text_.size() && text_[pos] == '}') {
+    ++pos;
+    return canonical;
+  }
+  std::string previous;
+  bool first = true;
+  while (true) {
+    if (pos >= text_.size() || text_[pos] != '"') {
+      throw Error("Expected a member name at offset " + std::to_string(pos));
+    }
+    std::string name;
+    canonical = scanString(pos, &name) && canonical;
+    // Canonical objects have their members sorted, like Json::Value keeps them.
+    if (!first && !(previous < name)) {
+      canonical = false;
+    }
+    canonical = !skipWhitespace(pos) && canonical;
+    expect(pos, ':');
+    canonical = !skipWhitespace(pos) && canonical;
+    const Span value = scanValue(pos, depth + 1);
+    canonical = value.canonical && canonical;
+    if (fn != nullptr) {
+      (*fn)(name, value);
+    }
+    canonical = !skipWhitespace(pos) && canonical;
+    if (pos < text_.size() && text_[pos] == ',') {
+      ++pos;
+      canonical = !skipWhitespace(pos) && canonical;
+      previous = std::move(name);
+      first = false;
+      continue;
+    }
+    expect(pos, '}');
+    return canonical;
+  }
+}
+
+bool JsonScanner::scanArray(size_t &pos, const int depth) const {
+  expect(pos, '[');
+  bool canonical = !skipWhitespace(pos);
+  if (pos < text_.size() && text_[pos] == ']') {
+    ++pos;
+    return canonical;
+  }
+  while (true) {
+    canonical = scanValue(pos, depth + 1).canonical && canonical;
+    canonical = !skipWhitespace(pos) && canonical;
+    if (pos < text_.size() && text_[pos] == ',') {
+      ++pos;
+      canonical = !skipWhitespace(pos) && canonical;
+      continue;
+    }
+    expect(pos, ']');
+    return canonical;
+  }
+}
+
+bool JsonScanner::scanString(size_t &pos, std::string *value) const {
+  const size_t begin = pos;
+  expect(pos, '"');
+  bool canonical = true;
+  bool unicode_escapes = false;
+  while (true) {
+    if (pos >= text_.size()) {
+      throw Error("Unterminated JSON string at offset " + std::to_string(begin));
+    }
+    const auto c = static_cast<unsigned char>(text_[pos++]);
+    if (c == '"') {
+      break;
+    }
+    if (c < 0x20) {
+      throw Error("Control character in JSON string at offset " + std::to_string(pos - 1));
+    }
+    if (c >= 0x7f) {
+      // Would be escaped by the canonical writer.
+      canonical = false;
+    }
+    if (c != '\\') {
+      if (value != nullptr) {
+        value->push_back(static_cast<char>(c));
+      }
+      continue;
+    }
+    if (pos >= text_.size()) {
+      throw Error("Unterminated JSON string at offset " + std::to_string(begin));
+    }
+    const char escaped = text_[pos++];
+    switch (escaped) {
+      case '"':
+      case '\\':
+        break;
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        canonical = false;
+        break;
+      case 'u':
+        for (int i = 0; i < 4; ++i, ++pos) {
+          if (pos >= text_.size() || std::isxdigit(static_cast<unsigned char>(text_[pos])) == 0) {
+            throw Error("Invalid unicode escape in JSON string at offset " + std::to_string(pos));
+          }
+        }
+        canonical = false;
+        unicode_escapes = true;
+        break;
+      default:
+        throw Error("Invalid escape in JSON string at offset " + std::to_string(pos - 1));
+    }
+    if (value != nullptr) {
+      static const char *const kEscaped = "\"\\/bfnrt";
+      static const char *const kUnescaped = "\"\\/\b\f\n\r\t";
+      const char *found = std::strchr(kEscaped, escaped);
+      if (found != nullptr && escaped != 'u') {
+        value->push_back(kUnescaped[found - kEscaped]);
+      }
+    }
+  }
+  if (value != nullptr && unicode_escapes) {
+    // Leave the decoding of UTF-16 escapes to jsoncpp, so that they come out the same as with a full parse.
+    Span span;
+    span.begin = begin;
+    span.end = pos;
+    *value = parse(span).asString();
+  }
+  return canonical;
+}
+
+bool JsonScanner::scanNumber(size_t &pos) const {
+  const size_t begin = pos;
+  auto digits = [this, &pos]() {
+    const size_t start = pos;
+    while (pos < text_.size() && text_[pos] >= '0' && text_[pos] <= '9') {
+      ++pos;
+    }
+    return pos - start;
+  };
+
+  if (pos < text_.size() && text_[pos] == '-') {
+    ++pos;
+  }
+  const size_t int_begin = pos;
+  const size_t int_digits = digits();
+  if (int_digits == 0) {
+    throw Error("Invalid JSON value at offset " + std::to_string(begin));
+  }
+  if (int_digits > 1 && text_[int_begin] == '0') {
+    throw Error("Invalid JSON number at offset " + std::to_string(begin));
+  }
+  // Integers that fit in 64 bits are written back as they are, except for -0.
+  bool canonical = int_digits <= 18 && text_.compare(begin, pos - begin, "-0") != 0;
+  if (pos < text_.size() && text_[pos] == '.') {
+    ++pos;
+    if (digits() == 0) {
+      throw Error("Invalid JSON number at offset " + std::to_string(begin));
+    }
+    canonical = false;
+  }
+  if (pos < text_.size() && (text_[pos] == 'e' || text_[pos] == 'E')) {
+    ++pos;
+    if (pos < text_.size() && (text_[pos] == '+' || text_[pos] == '-')) {
+      ++pos;
+    }
+    if (digits() == 0) {
+      throw Error("Invalid JSON number at offset " + std::to_string(begin));
+    }
+    canonical = false;
+  }
+  return canonical;
+}
+
+void JsonScanner::scanLiteral(size_t &pos, const char *literal) const {
+  const size_t length = std::strlen(literal);
+  if (text_.compare(pos, length, literal) != 0) {
+    throw Error("Invalid JSON value at offset " + std::to_string(pos));
+  }
+  pos += length;
+}
+
+bool JsonScanner::skipWhitespace(size_t &pos) const {
+  const size_t begin = pos;
+  while (pos < text_.size() &&
+         (text_[pos] == ' ' || text_[pos] == '\t' || text_[pos] == '\n' || text_[pos] == '\r')) {
+    ++pos;
+  }
+  return pos != begin;
+}
+
+void JsonScanner::expect(size_t &pos, const char c) const {
+  if (pos >= text_.size() || text_[pos] != c) {
+    throw Error(std::string("Expected '") + c + "' at offset " + std::to_string(pos));
+  }
+  ++pos;
+}
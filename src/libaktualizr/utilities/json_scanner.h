@@ -0,0 +1,86 @@
+#ifndef UTILITIES_JSON_SCANNER_H_
+#define UTILITIES_JSON_SCANNER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <json/json.h>
+
+/**
+ * Walks the text of a JSON document without building a Json::Value for all
+ * of it, so that large metadata can be processed one member at a time.
+ *
+ * The document is checked to be well-formed when the scanner is created.
+ * The scanner also tells whether a value is already written exactly as
+ * Utils::jsonToCanonicalStr() would write it, so that its text can be used
+ * as is where the canonical form is needed. That check is conservative:
+ * a value with whitespace, unsorted or duplicate member names, escapes
+ * other than \" and \\, non-ASCII characters or non-integer numbers is
+ * never considered canonical.
+ */
+class JsonScanner {
+ public:
+  class Error : public std::runtime_error {
+   public:
+    explicit Error(const std::string &what_arg) : std::runtime_error(what_arg) {}
+  };
+
+  /**
+   * The position of a value in the document, end excluded.
+   */
+  struct Span {
+    size_t begin{0};
+    size_t end{0};
+    bool canonical{false};
+  };
+
+  using MemberCallback = std::function<void(const std::string &name, const Span &value)>;
+
+  /**
+   * The text must outlive the scanner. Throws Error if it is not a single
+   * well-formed JSON value.
+   */
+  explicit JsonScanner(const std::string &text);
+
+  const Span &document() const { return document_; }
+
+  /**
+   * Call fn for each member of an object, in the order of the document.
+   * Throws Error if the value is not an object.
+   */
+  void forEachMember(const Span &object, const MemberCallback &fn) const;
+
+  /**
+   * The span of the member with the given name, or of the last one if it
+   * appears several times. Returns false if there is none.
+   */
+  bool findMember(const Span &object, const std::string &name, Span *value) const;
+
+  Json::Value parse(const Span &span) const;
+  std::string str(const Span &span) const { return text_.substr(span.begin, span.end - span.begin); }
+  std::string canonical(const Span &span) const;
+
+ private:
+  /**
+   * Deeper documents are rejected rather than overflowing the stack.
+   */
+  static const int kMaxDepth;
+
+  Span scanValue(size_t &pos, int depth) const;
+  bool scanObject(size_t &pos, int depth, const MemberCallback *fn) const;
+  bool scanArray(size_t &pos, int depth) const;
+  bool scanString(size_t &pos, std::string *value) const;
+  bool scanNumber(size_t &pos) const;
+  void scanLiteral(size_t &pos, const char *literal) const;
+  bool skipWhitespace(size_t &pos) const;
+  void expect(size_t &pos, char c) const;
+
+  const std::string &text_;
+  std::unique_ptr<Json::CharReader> reader_;
+  Span document_;
+};
+
+#endif  // UTILITIES_JSON_SCANNER_H_
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+#include "utilities/json_scanner.h"
+#include "utilities/utils.h"
+
+/* Values written the way the canonical writer does are recognised as
+ * canonical, anything else is not. */
+TEST(JsonScanner, Canonical) {
+  const std::vector<std::string> canonical{
+      R"({"a":{},"b":[],"c":"a/b\"\\","d":-12,"e":true,"f":null,"g":[1,"x",false]})",
+      R"([])",
+      R"("")",
+      R"(123456789012345678)",
+  };
+  for (const auto &text : canonical) {
+    const JsonScanner scanner(text);
+    EXPECT_TRUE(scanner.document().canonical) << text;
+    EXPECT_EQ(Utils::jsonToCanonicalStr(Utils::parseJSON(text)), text);
+    EXPECT_EQ(scanner.canonical(scanner.document()), text);
+  }
+
+  const std::vector<std::string> not_canonical{
+      R"({"b":1,"a":2})", R"({"a":1,"a":2})", R"({"a": 1})", "[1,\n2]",
+      R"(["\u00e9"])", "[\"\xc3\xa9\"]", R"(["\n"])", R"([1.5])",
+      R"([1e3])", R"([-0])", R"([1234567890123456789])", R"({"a":[{"c":1,"b":2}]})",
+  };
+  for (const auto &text : not_canonical) {
+    const JsonScanner scanner(text);
+    EXPECT_FALSE(scanner.document().canonical) << text;
+    EXPECT_EQ(scanner.canonical(scanner.document()), Utils::jsonToCanonicalStr(Utils::parseJSON(text))) << text;
+  }
+}
+
+/* Members are visited in document order, with their names decoded and their
+ * values parsed the same way as in a full parse. */
+TEST(JsonScanner, Members) {
+  const std::string text = R"( { "b" : [1, 2], "a\"\u00e9" : {"x": "y"}, "c": "z" } )";
+  const JsonScanner scanner(text);
+  const Json::Value full = Utils::parseJSON(text);
+
+  std::vector<std::string> names;
+  scanner.forEachMember(scanner.document(), [&](const std::string &name, const JsonScanner::Span &value) {
+    names.push_back(name);
+    EXPECT_EQ(scanner.parse(value), full[name]);
+  });
+  EXPECT_EQ(names, (std::vector<std::string>{"b", "a\"\xc3\xa9", "c"}));
+
+  JsonScanner::Span value;
+  EXPECT_TRUE(scanner.findMember(scanner.document(), "c", &value));
+  EXPECT_EQ(scanner.str(value), "\"z\"");
+  EXPECT_FALSE(scanner.findMember(scanner.document(), "d", &value));
+  EXPECT_THROW(scanner.forEachMember(value, [](const std::string &, const JsonScanner::Span &) {}),
+               JsonScanner::Error);
+
+  const std::string duplicates = R"({"a":1,"a":2})";
+  const JsonScanner duplicates_scanner(duplicates);
+  EXPECT_TRUE(duplicates_scanner.findMember(duplicates_scanner.document(), "a", &value));
+  EXPECT_EQ(duplicates_scanner.str(value), "2");
+}
+
+/* Malformed documents are rejected. */
+TEST(JsonScanner, Malformed) {
+  const std::vector<std::string> malformed{
+      "", "{", R"({"a"})", R"({"a":})", R"({"a":1,})", R"([1 2])", R"(["abc)", R"(["\x"])",
+      R"(["\u12"])", R"([01])", R"([1.])", R"([tru])", R"({} {})", "[\"a\tb\"]", R"({a:1})",
+  };
+  for (const auto &text : malformed) {
+    EXPECT_THROW(JsonScanner scanner(text), JsonScanner::Error) << text;
+  }
+  EXPECT_THROW(JsonScanner scanner(std::string(2000, '[') + std::string(2000, ']')), JsonScanner::Error);
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
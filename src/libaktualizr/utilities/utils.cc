@@ -32,6 +32,7 @@
 #include <boost/uuid/uuid_io.hpp>
 
 #include "aktualizr_version.h"
+#include "canonical_json.h"
 #include "logging/logging.h"
 
 static const std::array<const char *, 132> adverbs = {
@@ -354,12 +355,9 @@ std::string Utils::jsonToStr(const Json::Value &json) {
 }
 
 std::string Utils::jsonToCanonicalStr(const Json::Value &json) {
-  static Json::StreamWriterBuilder wbuilder = []() {
-    Json::StreamWriterBuilder w;
-    wbuilder["indentation"] = "";
-    return w;
-  }();
-  return Json::writeString(wbuilder, json);
+  std::string canonical;
+  CanonicalJsonWriter::write(json, &canonical);
+  return canonical;
 }
 
 Json::Value Utils::getHardwareInfo() {
@@ -6,6 +6,7 @@
 
 #include <sys/stat.h>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <random>
 #include <set>
@@ -13,6 +14,7 @@
 #include <boost/algorithm/hex.hpp>
 #include <boost/archive/iterators/dataflow_exception.hpp>
 
+#include "utilities/canonical_json.h"
 #include "utilities/utils.h"
 
 bool CharOk(char c) {
@@ -63,6 +65,37 @@ TEST(Utils, jsonToCanonicalStr) {
   EXPECT_EQ(Utils::jsonToCanonicalStr(parsed), "0");
 }
 
+/* The canonical form is exactly what jsoncpp's writer produces without
+ * indentation, for all kinds of values, and the output buffer can be reused. */
+TEST(Utils, jsonToCanonicalStrMatchesJsoncpp) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+
+  Json::Value json;
+  json["int"] = Json::Value(std::numeric_limits<Json::Int64>::min());
+  json["uint"] = Json::Value(std::numeric_limits<Json::UInt64>::max());
+  json["real"].append(1.5);
+  json["real"].append(0.1);
+  json["real"].append(1e300);
+  json["string"] = "quote\" backslash\\ slash/";
+  json["control"] = "line\nfeed\x01";
+  json["unicode \xc3\xa9"] = "\xf0\x9f\x98\x80";
+  json["nul"] = std::string("a\0b", 3);
+  json["sparse"][3] = true;
+  json["empty"]["object"] = Json::Value(Json::objectValue);
+  json["empty"]["array"] = Json::Value(Json::arrayValue);
+  json["empty"]["string"] = "";
+  json["null"] = Json::Value();
+
+  std::string buffer;
+  for (const Json::Value &value :
+       {json, Utils::parseJSON("{\"b\": 1, // comment\n \"a\": [2]}"), Json::Value("x"), Json::Value(-7)}) {
+    EXPECT_EQ(Utils::jsonToCanonicalStr(value), Json::writeString(builder, value));
+    CanonicalJsonWriter::write(value, &buffer);
+    EXPECT_EQ(buffer, Json::writeString(builder, value));
+  }
+}
+
 /* Read hardware info from the system. */
 TEST(Utils, getHardwareInfo) {
   Json::Value hwinfo = Utils::getHardwareInfo();
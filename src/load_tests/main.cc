@@ -5,6 +5,7 @@
 #include <thread>
 
 #include "check.h"
+#include "metadata.h"
 #include "provision.h"
 #include "sslinit.h"
 #ifdef BUILD_OSTREE
@@ -138,6 +139,40 @@ void provisionDevicesCmd(const std::vector<std::string> &opts) {
   mkDevices(devicesDir, credentialsFile, gwUrl, parallelism, devicesNr, devicesPerSec);
 }
 
+void benchmarkMetadataCmd(const std::vector<std::string> &opts) {
+  std::string workDir;
+  std::vector<unsigned int> targetCounts;
+  unsigned int delegationDepth;
+  std::vector<std::string> keyTypeNames;
+  unsigned int iterations;
+  bpo::options_description description("Metadata parsing and verification benchmark");
+  // clang-format off
+  description.add_options()
+      ("workdir,w", bpo::value<std::string>(&workDir)->default_value(boost::filesystem::temp_directory_path().string()), "directory where repositories will be generated")
+      ("targets,n", bpo::value<std::vector<unsigned int>>(&targetCounts)->multitoken()->default_value({100, 1000, 10000}, "100 1000 10000"), "numbers of targets in the Image repo")
+      ("depth,d", bpo::value<unsigned int>(&delegationDepth)->default_value(0), "depth of the chain of nested delegations")
+      ("keytype,k", bpo::value<std::vector<std::string>>(&keyTypeNames)->multitoken()->default_value({"RSA2048", "ED25519"}, "RSA2048 ED25519"), "Uptane key types")
+      ("iterations,i", bpo::value<unsigned int>(&iterations)->default_value(5), "number of measured runs of each step");
+  // clang-format on
+
+  bpo::variables_map vm;
+  bpo::store(bpo::command_line_parser(opts).options(description).run(), vm);
+  bpo::notify(vm);
+
+  std::vector<KeyType> keyTypes;
+  for (const std::string &name : keyTypeNames) {
+    std::istringstream keyTypeStr{name};
+    KeyType keyType;
+    keyTypeStr >> keyType;
+    if (keyType == KeyType::kUnknown) {
+      LOG_ERROR << "Unknown key type: " << name;
+      return;
+    }
+    keyTypes.push_back(keyType);
+  }
+  benchmarkMetadata(workDir, targetCounts, delegationDepth, keyTypes, iterations);
+}
+
 void setLogLevel(const bpo::variables_map &vm) {
   // set the log level from command line option
   boost::log::trivial::severity_level severity =
@@ -159,7 +194,8 @@ int main(int argc, char *argv[]) {
   std::srand(static_cast<unsigned int>(std::time(0)));
 
   std::map<std::string, std::function<void(std::vector<std::string>)>> commands{{"provision", provisionDevicesCmd},
-                                                                                {"check", checkForUpdatesCmd}
+                                                                                {"check", checkForUpdatesCmd},
+                                                                                {"metadata", benchmarkMetadataCmd}
 #ifdef BUILD_OSTREE
                                                                                 ,
                                                                                 {"checkfetch", checkAndFetchCmd},
@@ -0,0 +1,286 @@
+#include "metadata.h"
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "crypto/crypto.h"
+#include "logging/logging.h"
+#include "storage/invstorage.h"
+#include "uptane/directorrepository.h"
+#include "uptane/fetcher.h"
+#include "uptane/imagerepository.h"
+#include "uptane/iterator.h"
+#include "uptane_repo.h"
+#include "utilities/canonical_json.h"
+#include "utilities/utils.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const unsigned int kDirectorTargets = 10;
+const char *const kHardwareId = "benchmark_hw";
+
+/* Serves the metadata of a generated repository straight from disk, so that
+ * the network does not show up in the measurements. */
+class LocalHttp : public HttpInterface {
+ public:
+  HttpResponse get(const std::string &url, int64_t maxsize) override {
+    const fs::path path(url);
+    if (!fs::exists(path)) {
+      return HttpResponse("", 404, CURLE_OK, "");
+    }
+    if (maxsize != kNoLimit && static_cast<int64_t>(fs::file_size(path)) > maxsize) {
+      return HttpResponse("", 200, CURLE_FILESIZE_EXCEEDED, "Maximum file size exceeded");
+    }
+    return HttpResponse(Utils::readFile(path), 200, CURLE_OK, "");
+  }
+  HttpResponse post(const std::string &, const std::string &, const std::string &) override { return unsupported(); }
+  HttpResponse post(const std::string &, const Json::Value &) override { return unsupported(); }
+  HttpResponse put(const std::string &, const std::string &, const std::string &) override { return unsupported(); }
+  HttpResponse put(const std::string &, const Json::Value &) override { return unsupported(); }
+  HttpResponse download(const std::string &, curl_write_callback, curl_xferinfo_callback, void *,
+                        curl_off_t) override {
+    return unsupported();
+  }
+  std::future<HttpResponse> downloadAsync(const std::string &, curl_write_callback, curl_xferinfo_callback, void *,
+                                          curl_off_t, CurlHandler *) override {
+    std::promise<HttpResponse> response;
+    response.set_value(unsupported());
+    return response.get_future();
+  }
+  void setCerts(const std::string &, CryptoSource, const std::string &, CryptoSource, const std::string &,
+                CryptoSource) override {}
+
+ private:
+  static HttpResponse unsupported() { return HttpResponse("", 405, CURLE_OK, ""); }
+};
+
+struct Timing {
+  double mean{0};
+  double best{0};
+};
+
+template <typename Fn>
+Timing measure(const unsigned int iterations, Fn fn) {
+  using clock = std::chrono::steady_clock;
+  Timing timing;
+  double total = 0;
+  for (unsigned int i = 0; i < iterations; ++i) {
+    const clock::time_point start = clock::now();
+    fn();
+    const double elapsed = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    total += elapsed;
+    timing.best = (i == 0) ? elapsed : std::min(timing.best, elapsed);
+  }
+  timing.mean = total / iterations;
+  return timing;
+}
+
+long peakMemoryKb() {  // NOLINT(google-runtime-int)
+  struct rusage usage {};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void report(const std::string &label, const Timing &timing) {
+  std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << timing.mean << " ms (best " << timing.best << " ms)" << std::endl;
+}
+
+std::string keyTypeName(const KeyType keyType) {
+  std::ostringstream name;
+  name << keyType;
+  return boost::algorithm::erase_all_copy(name.str(), "\"");
+}
+
+// Targets of the delegation at the given level live in level1/.../<level>/.
+std::string rolePrefix(const unsigned int level) {
+  std::string prefix;
+  for (unsigned int l = 1; l <= level; ++l) {
+    prefix += "level" + std::to_string(l) + "/";
+  }
+  return prefix;
+}
+
+std::string targetName(const unsigned int level, const unsigned int index) {
+  return rolePrefix(level) + "target" + std::to_string(index);
+}
+
+/* Describe a repository with targetCount targets evenly spread over the
+ * top-level Targets and a chain of delegationDepth nested delegations, and a
+ * few of the top-level targets assigned to ECUs by the Director. */
+Json::Value makeManifest(const unsigned int targetCount, const unsigned int delegationDepth, const KeyType keyType) {
+  Json::Value manifest;
+  std::string parent = "targets";
+  for (unsigned int level = 1; level <= delegationDepth; ++level) {
+    Json::Value delegation;
+    delegation["name"] = "level" + std::to_string(level);
+    delegation["parent"] = parent;
+    delegation["pattern"] = rolePrefix(level) + "*";
+    delegation["keytype"] = keyTypeName(keyType);
+    manifest["delegations"].append(delegation);
+    parent = delegation["name"].asString();
+  }
+
+  const unsigned int perRole = targetCount / (delegationDepth + 1);
+  for (unsigned int level = 0; level <= delegationDepth; ++level) {
+    const unsigned int count = (level == 0) ? targetCount - perRole * delegationDepth : perRole;
+    for (unsigned int i = 0; i < count; ++i) {
+      const std::string name = targetName(level, i);
+      Json::Value image;
+      image["targetname"] = name;
+      image["hwid"] = kHardwareId;
+      image["sha256"] = boost::algorithm::to_lower_copy(boost::algorithm::hex(Crypto::sha256digest(name)));
+      image["length"] = static_cast<Json::UInt64>(i + 1);
+      if (level > 0) {
+        image["delegation"] = "level" + std::to_string(level);
+      }
+      manifest["images"].append(image);
+    }
+  }
+
+  const unsigned int directorCount = std::min(kDirectorTargets, targetCount - perRole * delegationDepth);
+  for (unsigned int i = 0; i < directorCount; ++i) {
+    Json::Value target;
+    target["targetname"] = targetName(0, i);
+    target["hwid"] = kHardwareId;
+    target["serial"] = "ecu" + std::to_string(i);
+    manifest["targets"].append(target);
+  }
+  return manifest;
+}
+
+std::shared_ptr<INvStorage> newStorage(const fs::path &path) {
+  StorageConfig config;
+  config.path = path;
+  fs::remove_all(path);
+  fs::create_directories(path);
+  return INvStorage::newStorage(config);
+}
+
+void benchmarkRepo(const fs::path &repoDir, const unsigned int targetCount, const unsigned int delegationDepth,
+                   const KeyType keyType, const unsigned int iterations) {
+  std::cout << "Repository with " << targetCount << " targets, delegation depth " << delegationDepth << ", "
+            << keyTypeName(keyType) << " keys" << std::endl;
+
+  const Timing generation = measure(1, [&]() {
+    UptaneRepo repo(repoDir, "", "");
+    repo.generateRepo(keyType);
+    repo.addFromManifest(makeManifest(targetCount, delegationDepth, keyType));
+  });
+  report("generate", generation);
+
+  const fs::path imageDir = repoDir / ImageRepo::dir;
+  const fs::path directorDir = repoDir / DirectorRepo::dir;
+  const std::string targetsRaw = Utils::readFile(imageDir / "targets.json");
+  std::cout << "  top-level targets.json: " << targetsRaw.size() << " bytes" << std::endl;
+
+  report("parse JSON", measure(iterations, [&]() { Utils::parseJSON(targetsRaw); }));
+  const Json::Value targetsJson = Utils::parseJSON(targetsRaw);
+  // The canonical form is computed for every signature check.
+  Json::StreamWriterBuilder jsoncppWriter;
+  jsoncppWriter["indentation"] = "";
+  std::string canonical;
+  report("canonicalize (jsoncpp)",
+         measure(iterations, [&]() { canonical = Json::writeString(jsoncppWriter, targetsJson); }));
+  report("canonicalize", measure(iterations, [&]() { CanonicalJsonWriter::write(targetsJson, &canonical); }));
+  if (canonical != Json::writeString(jsoncppWriter, targetsJson)) {
+    LOG_ERROR << "The canonical forms of the targets metadata differ";
+  }
+  report("construct Targets", measure(iterations, [&]() { Uptane::Targets targets(targetsJson); }));
+
+  const auto root = std::make_shared<Uptane::Root>(Uptane::RepositoryType::Image(),
+                                                   Utils::parseJSONFile(imageDir / "root.json"));
+  report("verify signature", measure(iterations, [&]() {
+           root->UnpackSignedObject(Uptane::RepositoryType::Image(), Uptane::Role::Targets(), targetsJson);
+         }));
+  report("verify and construct", measure(iterations, [&]() {
+           Uptane::Targets targets(Uptane::RepositoryType::Image(), Uptane::Role::Targets(),
+                                   Utils::parseJSON(targetsRaw), root);
+         }));
+  report("verify and construct (text)", measure(iterations, [&]() {
+           Uptane::Targets targets(Uptane::RepositoryType::Image(), Uptane::Role::Targets(), targetsRaw, root);
+         }));
+
+  auto fetcher = std::make_shared<Uptane::Fetcher>(imageDir.string(), directorDir.string(),
+                                                   std::make_shared<LocalHttp>());
+  const fs::path storageDir = repoDir / "storage";
+  std::shared_ptr<INvStorage> storage;
+  std::unique_ptr<Uptane::ImageRepository> imageRepo;
+  bool updated = true;
+  report("update Image repo", measure(iterations, [&]() {
+           storage = newStorage(storageDir);
+           imageRepo = std_::make_unique<Uptane::ImageRepository>();
+           updated = imageRepo->updateMeta(*storage, *fetcher) && updated;
+         }));
+  if (!updated) {
+    // The most likely reason is that some metadata exceeds the size limits.
+    LOG_ERROR << "Failed to update the Image repo metadata, skipping the rest of this repository";
+    return;
+  }
+
+  size_t traversed = 0;
+  auto traverse = [&]() {
+    traversed = 0;
+    Uptane::LazyTargetsList targets(*imageRepo, storage, fetcher);
+    for (auto it = targets.begin(); it != targets.end(); ++it) {
+      (*it).filename();
+      ++traversed;
+    }
+  };
+  report("traverse delegations (cold)", measure(1, traverse));
+  report("traverse delegations (warm)", measure(iterations, traverse));
+  if (traversed != targetCount) {
+    LOG_ERROR << "Traversed " << traversed << " targets out of " << targetCount;
+  }
+
+  Uptane::DirectorRepository directorRepo;
+  if (!directorRepo.updateMeta(*storage, *fetcher)) {
+    LOG_ERROR << "Failed to update the Director metadata";
+    return;
+  }
+  bool matched = true;
+  report("match Director targets", measure(iterations, [&]() {
+           matched = matched && directorRepo.matchTargetsWithImageTargets(*imageRepo->getTargets());
+         }));
+  if (!matched) {
+    LOG_ERROR << "Director targets do not match the Image repo targets";
+  }
+
+  std::cout << "  peak memory: " << peakMemoryKb() / 1024 << " MB" << std::endl;
+}
+
+}  // namespace
+
+void benchmarkMetadata(const fs::path &workDir, const std::vector<unsigned int> &targetCounts,
+                       const unsigned int delegationDepth, const std::vector<KeyType> &keyTypes,
+                       const unsigned int iterations) {
+  if (delegationDepth > Uptane::kDelegationsMaxDepth) {
+    LOG_ERROR << "The client only follows delegations up to a depth of " << Uptane::kDelegationsMaxDepth;
+    return;
+  }
+  // Peak memory never goes down, so run the smallest repositories first.
+  std::vector<unsigned int> counts = targetCounts;
+  std::sort(counts.begin(), counts.end());
+  for (const KeyType keyType : keyTypes) {
+    for (const unsigned int count : counts) {
+      const fs::path repoDir = workDir / (keyTypeName(keyType) + "-" + std::to_string(count));
+      fs::remove_all(repoDir);
+      try {
+        benchmarkRepo(repoDir, count, delegationDepth, keyType, std::max(iterations, 1U));
+      } catch (const std::exception &e) {
+        LOG_ERROR << "Benchmark of " << repoDir << " failed: " << e.what();
+      }
+      fs::remove_all(repoDir);
+    }
+  }
+}
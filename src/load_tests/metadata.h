@@ -0,0 +1,18 @@
+#ifndef LT_METADATA_H_
+#define LT_METADATA_H_
+
+#include <boost/filesystem.hpp>
+#include <vector>
+
+#include "utilities/types.h"
+
+/*
+ * Generate Uptane repositories with the given numbers of Image repo targets,
+ * spread over a chain of delegationDepth nested delegations, for each key type,
+ * and report how long the client takes to parse, verify and traverse their
+ * metadata, as well as the peak memory usage of the process.
+ */
+void benchmarkMetadata(const boost::filesystem::path &workDir, const std::vector<unsigned int> &targetCounts,
+                       unsigned int delegationDepth, const std::vector<KeyType> &keyTypes, unsigned int iterations);
+
+#endif
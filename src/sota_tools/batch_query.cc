@@ -0,0 +1,116 @@
+#include "batch_query.h"
+
+#include <assert.h>
+
+#include <utility>
+
+#include "logging/logging.h"
+#include "request_pool.h"
+#include "utilities/utils.h"
+
+BatchQuery::BatchQuery(std::vector<OSTreeObject::ptr> objects) : objects_(std::move(objects)) {
+  for (const OSTreeObject::ptr &object : objects_) {
+    request_body_ += object->object_name() + "\n";
+  }
+}
+
+BatchQuery::~BatchQuery() {
+  if (curl_handle_ != nullptr) {
+    curl_easy_cleanup(curl_handle_);
+    curl_handle_ = nullptr;
+  }
+  curl_slist_free_all(request_headers_);
+}
+
+void BatchQuery::MakeRequest(const TreehubServer &push_target, CURLM *curl_multi_handle) {
+  assert(!curl_handle_);
+  curl_handle_ = curl_easy_init();
+  if (curl_handle_ == nullptr) {
+    throw std::runtime_error("Could not initialize curl handle");
+  }
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_VERBOSE, get_curlopt_verbose());
+
+  push_target.InjectIntoCurl("query/objects", curl_handle_);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_USERAGENT, Utils::getUserAgent());
+  request_headers_ = push_target.HeadersWithContentType("Content-Type: text/plain");
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_HTTPHEADER, request_headers_);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_POSTFIELDS, request_body_.c_str());
+  const auto body_size = static_cast<long>(request_body_.size());  // NOLINT(google-runtime-int)
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_POSTFIELDSIZE, body_size);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEFUNCTION, &BatchQuery::curl_handle_write);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEDATA, this);
+  http_response_.str("");  // Empty the response buffer
+
+  const CURLMcode err = curl_multi_add_handle(curl_multi_handle, curl_handle_);
+  if (err != 0) {
+    LOG_ERROR << "err:" << curl_multi_strerror(err);
+  }
+  request_start_time_ = std::chrono::steady_clock::now();
+}
+
+void BatchQuery::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
+  long rescode = 0;  // NOLINT(google-runtime-int)
+  curl_easy_getinfo(curl_handle_, CURLINFO_RESPONSE_CODE, &rescode);
+  curl_multi_remove_handle(curl_multi_handle, curl_handle_);
+  curl_easy_cleanup(curl_handle_);
+  curl_handle_ = nullptr;
+  curl_slist_free_all(request_headers_);
+  request_headers_ = nullptr;
+
+  if (IsUnsupportedResponse(rescode)) {
+    LOG_INFO << "Server does not support batched object queries (HTTP " << rescode
+             << "), falling back to one query per object";
+    // This is not a failure of the server, so don't let it count against the
+    // rate controller.
+    last_operation_result_ = ServerResponse::kOk;
+    pool.DisableBatchQueries();
+    for (const OSTreeObject::ptr &object : objects_) {
+      pool.AddQuery(object);
+    }
+  } else if (rescode == 200) {
+    last_operation_result_ = ServerResponse::kOk;
+    const std::set<std::string> present = ParseResponse(http_response_.str());
+    LOG_DEBUG << "Batched query: " << present.size() << " of " << objects_.size() << " objects present";
+    for (const OSTreeObject::ptr &object : objects_) {
+      object->PresenceCheckDone(pool, (present.count(object->object_name()) != 0U) ? 200 : 404);
+    }
+  } else {
+    LOG_WARNING << "Batched OSTree query reported an error code: " << rescode << " retrying...";
+    LOG_DEBUG << http_response_.str();
+    last_operation_result_ = ServerResponse::kTemporaryFailure;
+    for (const OSTreeObject::ptr &object : objects_) {
+      pool.AddQuery(object);
+    }
+  }
+  objects_.clear();
+}
+
+bool BatchQuery::IsUnsupportedResponse(const long rescode) {  // NOLINT(google-runtime-int)
+  // Client errors other than a timeout or throttling won't go away by asking
+  // again, whether the server lacks the endpoint or rejects the request.
+  const bool client_error = rescode >= 400 && rescode < 500 && rescode != 408 && rescode != 429;
+  return client_error || rescode == 501;
+}
+
+std::set<std::string> BatchQuery::ParseResponse(const std::string &body) {
+  std::set<std::string> present;
+  std::istringstream stream(body);
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      present.insert(line);
+    }
+  }
+  return present;
+}
+
+size_t BatchQuery::curl_handle_write(void *buffer, size_t size, size_t nmemb, void *userp) {
+  auto *that = static_cast<BatchQuery *>(userp);
+  that->http_response_.write(static_cast<const char *>(buffer), static_cast<std::streamsize>(size * nmemb));
+  return size * nmemb;
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
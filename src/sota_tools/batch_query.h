@@ -0,0 +1,66 @@
+#ifndef SOTA_CLIENT_TOOLS_BATCH_QUERY_H_
+#define SOTA_CLIENT_TOOLS_BATCH_QUERY_H_
+
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "ostree_object.h"
+#include "treehub_server.h"
+
+class RequestPool;
+
+/**
+ * Check the presence of many OSTree objects on Treehub with a single request.
+ *
+ * The request is a POST to query/objects with one object name (as in
+ * "ab/cdef...dirtree") per line in a text/plain body. The server responds with the
+ * subset of those names that it already has, also one per line. Servers that
+ * do not implement the endpoint are detected via the response code, in which
+ * case the objects are handed back to the pool to be checked one by one.
+ */
+class BatchQuery {
+ public:
+  explicit BatchQuery(std::vector<OSTreeObject::ptr> objects);
+  BatchQuery(const BatchQuery&) = delete;
+  BatchQuery operator=(const BatchQuery&) = delete;
+  ~BatchQuery();
+
+  /* Send the batched presence check to the destination server. */
+  void MakeRequest(const TreehubServer& push_target, CURLM* curl_multi_handle);
+
+  /* Process the completed curl transaction and report the presence of every
+   * object in the batch. */
+  void CurlDone(CURLM* curl_multi_handle, RequestPool& pool);
+
+  CURL* curl_handle() const { return curl_handle_; }
+  size_t size() const { return objects_.size(); }
+  std::chrono::steady_clock::time_point RequestStartTime() const { return request_start_time_; }
+  ServerResponse LastOperationResult() const { return last_operation_result_; }
+
+  /* HTTP response codes which indicate that the server does not support
+   * batched queries, as opposed to a (temporary) server failure: every client
+   * error except 408 (timeout) and 429 (throttling), and 501. */
+  static bool IsUnsupportedResponse(long rescode);  // NOLINT(google-runtime-int)
+
+  /* Parse a response body into the set of object names present on the server. */
+  static std::set<std::string> ParseResponse(const std::string& body);
+
+ private:
+  static size_t curl_handle_write(void* buffer, size_t size, size_t nmemb, void* userp);
+
+  std::vector<OSTreeObject::ptr> objects_;
+  std::string request_body_;
+  struct curl_slist* request_headers_{nullptr};
+  std::stringstream http_response_;
+  CURL* curl_handle_{nullptr};
+  std::chrono::steady_clock::time_point request_start_time_;
+  ServerResponse last_operation_result_{ServerResponse::kNoResponse};
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_BATCH_QUERY_H_
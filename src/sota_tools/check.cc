@@ -9,6 +9,7 @@
 #include "ostree_object.h"
 #include "rate_controller.h"
 #include "request_pool.h"
+#include "tree_verifier.h"
 #include "treehub_server.h"
 #include "utilities/types.h"
 #include "utilities/utils.h"
@@ -24,7 +25,7 @@ static size_t writeString(void *contents, size_t size, size_t nmemb, void *userp
 }
 
 int CheckRefValid(TreehubServer &treehub, const std::string &ref, RunMode mode, int max_curl_requests,
-                  const boost::filesystem::path &tree_dir) {
+                  const boost::filesystem::path &tree_dir, bool verify_content) {
   // Check if the ref is present on treehub. The traditional use case is that it
   // should be a commit object, but we allow walking the tree given any OSTree
   // ref.
@@ -62,7 +63,17 @@ int CheckRefValid(TreehubServer &treehub, const std::string &ref, RunMode mode,
     LOG_INFO << "OSTree commit " << ref << " is found on treehub";
   }
 
-  if (mode == RunMode::kWalkTree) {
+  if (mode == RunMode::kWalkTree && tree_dir.empty() && type != OstreeObjectType::OSTREE_OBJECT_TYPE_UNKNOWN) {
+    // Walk the entire tree and check for all objects, without keeping a copy.
+    TreeVerifier verifier(treehub, max_curl_requests, verify_content);
+    if (!verifier.Run(OSTreeHash::Parse(ref), type)) {
+      LOG_FATAL << "OSTree commit " << ref << " is incomplete on treehub: " << verifier.objects_missing()
+                << " objects missing, " << verifier.objects_corrupt() << " corrupt, " << verifier.objects_failed()
+                << " could not be checked";
+      return EXIT_FAILURE;
+    }
+    LOG_INFO << "All " << verifier.objects_checked() << " objects of " << ref << " are present on treehub";
+  } else if (mode == RunMode::kWalkTree) {
     // Walk the entire tree and check for all objects.
     OSTreeHttpRepo dest_repo(&treehub, tree_dir);
     OSTreeHash hash = OSTreeHash::Parse(ref);
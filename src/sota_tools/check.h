@@ -10,8 +10,13 @@
 
 /**
  * Check if the ref is present on the server and in targets.json
+ *
+ * In RunMode::kWalkTree, check every object of the tree as well. If tree_dir
+ * is given, the tree is downloaded there; otherwise the objects are checked
+ * in parallel without keeping them, and verify_content additionally
+ * downloads file objects to verify their checksums.
  */
 int CheckRefValid(TreehubServer& treehub, const std::string& ref, RunMode mode, int max_curl_requests,
-                  const boost::filesystem::path& tree_dir = "");
+                  const boost::filesystem::path& tree_dir = "", bool verify_content = false);
 
 #endif
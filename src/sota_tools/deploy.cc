@@ -1,10 +1,13 @@
 #include "deploy.h"
 
+#include <thread>
+
 #include <boost/filesystem.hpp>
 #include <boost/intrusive_ptr.hpp>
 
 #include "authenticate.h"
 #include "logging/logging.h"
+#include "object_graph_walker.h"
 #include "ostree_object.h"
 #include "rate_controller.h"
 #include "request_pool.h"
@@ -24,7 +27,7 @@ bool CheckPoolState(const OSTreeObject::ptr &root_object, const RequestPool &req
 }
 
 bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server, const OSTreeHash &ostree_commit,
-                     const RunMode mode, const int max_curl_requests) {
+                     const RunMode mode, const int max_curl_requests, ServerObjectCache *object_cache) {
   assert(max_curl_requests > 0);
 
   OSTreeObject::ptr root_object;
@@ -35,17 +38,37 @@ bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server
     return false;
   }
 
-  RequestPool request_pool(push_server, max_curl_requests, mode);
+  RequestPool request_pool(push_server, max_curl_requests, mode, object_cache);
 
   // Add commit object to the queue.
   request_pool.AddQuery(root_object);
 
+  // Once the tree has to be walked, parse it on all cores and query the
+  // objects found that way ahead of the regular walk.
+  ObjectGraphWalker graph_walker(*src_repo, std::thread::hardware_concurrency());
+  bool walker_started = false;
+
   // Main curl event loop.
   // request_pool takes care of holding number of outstanding requests below.
   // OSTreeObject::CurlDone() adds new requests to the pool and stops the pool
   // on error.
   do {
     request_pool.Loop();
+    if (!walker_started && (root_object->is_on_server() == PresenceOnServer::kObjectMissing ||
+                            root_object->is_on_server() == PresenceOnServer::kObjectPresent)) {
+      if (!CheckPoolState(root_object, request_pool)) {
+        break;
+      }
+      graph_walker.Start(ostree_commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT);
+      walker_started = true;
+    }
+    for (const OSTreeChildRef &found : graph_walker.TakeFound()) {
+      try {
+        request_pool.AddSpeculativeQuery(src_repo->GetObject(found.first, found.second));
+      } catch (const OSTreeObjectMissing &error) {
+        // Left to the regular walk, which reports it.
+      }
+    }
   } while (CheckPoolState(root_object, request_pool));
 
   if (root_object->is_on_server() == PresenceOnServer::kObjectPresent) {
@@ -58,6 +81,16 @@ bool UploadToTreehub(const OSTreeRepo::ptr &src_repo, TreehubServer &push_server
     LOG_ERROR << "One or more errors while pushing";
   }
 
+  // Whatever the server has confirmed so far stays valid, even if the upload
+  // failed.
+  if (object_cache != nullptr) {
+    try {
+      object_cache->Save();
+    } catch (const std::exception &e) {
+      LOG_WARNING << "Could not save the object cache: " << e.what();
+    }
+  }
+
   return root_object->is_on_server() == PresenceOnServer::kObjectPresent;
 }
 
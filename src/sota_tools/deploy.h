@@ -7,6 +7,7 @@
 #include "ostree_ref.h"
 #include "ostree_repo.h"
 #include "server_credentials.h"
+#include "server_object_cache.h"
 
 /*
  * Check current state of the request pool depending on the run mode.
@@ -25,9 +26,12 @@ bool CheckPoolState(const OSTreeObject::ptr& root_object, const RequestPool& req
  * \param ostree_commit
  * \param mode
  * \param max_curl_requests
+ * \param object_cache Optional index of objects known to be on push_server.
+ *                     It is consulted before querying the server and updated
+ *                     (and saved) with every object the server confirms.
  */
 bool UploadToTreehub(const OSTreeRepo::ptr& src_repo, TreehubServer& push_server, const OSTreeHash& ostree_commit,
-                     RunMode mode, int max_curl_requests);
+                     RunMode mode, int max_curl_requests, ServerObjectCache* object_cache = nullptr);
 
 /**
  * Use the garage-sign tool and the Image repo targets.json keys in credentials.zip
@@ -43,6 +43,30 @@ TEST(deploy, UploadToTreehub) {
   EXPECT_EQ(result, 0) << "Diff between the source repo refs and the destination repos refs is nonzero.";
 }
 
+/* Push a repo made of many small objects, which are uploaded in bundles. */
+TEST(deploy, UploadToTreehubBundled) {
+  TemporaryDirectory dest_dir;
+  const std::string dp = TestUtils::getFreePort();
+  Json::Value auth;
+  auth["ostree"]["server"] = std::string("https://localhost:") + dp;
+  Utils::writeFile(dest_dir.Path() / "auth.json", auth);
+  boost::process::child deploy_server_process("tests/sota_tools/treehub_server.py", std::string("-p"), dp,
+                                              std::string("-d"), dest_dir.PathString(), std::string("--tls"));
+  TestUtils::waitForServer("https://localhost:" + dp + "/");
+
+  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeDirRepo>("tests/sota_tools/bigger_repo");
+  TreehubServer push_server;
+  EXPECT_EQ(authenticate("tests/fake_http_server/server.crt", ServerCredentials(dest_dir.Path() / "auth.json"),
+                         push_server),
+            EXIT_SUCCESS);
+  EXPECT_TRUE(UploadToTreehub(src_repo, push_server, src_repo->GetRef("master").GetHash(), RunMode::kDefault, 4));
+
+  int result = system((std::string("diff -r ") + (dest_dir.Path() / "objects/").string() +
+                       " tests/sota_tools/bigger_repo/objects/")
+                          .c_str());
+  EXPECT_EQ(result, 0) << "Diff between the source repo objects and the destination repo objects is nonzero.";
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
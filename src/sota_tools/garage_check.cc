@@ -40,9 +40,10 @@ int main(int argc, char **argv) {
     ("ref,r", po::value<std::string>(&ref)->required(), "refhash to check")
     ("credentials,j", po::value<boost::filesystem::path>(&credentials_path)->required(), "credentials (json or zip containing json)")
     ("cacert", po::value<std::string>(&cacerts), "override path to CA root certificates, in the same format as curl --cacert")
-    ("jobs", po::value<int>(&max_curl_requests)->default_value(30), "maximum number of parallel requests (only relevant with --walk-tree)")
+    ("jobs", po::value<int>(&max_curl_requests)->default_value(kDefaultMaxCurlRequests), "maximum number of parallel requests (only relevant with --walk-tree, raised gradually up to it while the server keeps up)")
     ("walk-tree,w", "walk entire tree and check presence of all objects")
-    ("tree-dir,t", po::value<boost::filesystem::path>(&tree_dir), "directory to which to write the tree (only used with --walk-tree)");
+    ("tree-dir,t", po::value<boost::filesystem::path>(&tree_dir), "directory to which to write the tree (only used with --walk-tree)")
+    ("verify-content", "download file objects and verify their checksums (only used with --walk-tree, without --tree-dir)");
   // clang-format on
 
   po::variables_map vm;
@@ -101,7 +102,8 @@ int main(int argc, char **argv) {
       return EXIT_FAILURE;
     }
 
-    if (CheckRefValid(treehub, ref, mode, max_curl_requests, tree_dir) != EXIT_SUCCESS) {
+    const bool verify_content = vm.count("verify-content") != 0U;
+    if (CheckRefValid(treehub, ref, mode, max_curl_requests, tree_dir, verify_content) != EXIT_SUCCESS) {
       LOG_FATAL << "Check if the ref is present on the server or in targets.json failed";
       return EXIT_FAILURE;
     }
@@ -16,6 +16,12 @@ enum class RunMode {
   kPushTree,
 };
 
+/** Default of the --jobs option of garage-push, garage-deploy and
+ * garage-check: the maximum number of requests in flight at once. The tools
+ * start with a single request and raise the number up to this limit while the
+ * server keeps up (see RateController). */
+constexpr int kDefaultMaxCurlRequests = 30;
+
 /** Types of OSTree objects, borrowed from libostree/ostree-core.h.
  *  Copied here to avoid a dependency. We do not currently handle types 5-7, and
  *  UNKNOWN is our own invention for pseudo-backwards compatibility.
@@ -39,7 +39,7 @@ int main(int argc, char **argv) {
     ("push-credentials,p", po::value<boost::filesystem::path>(&push_cred)->required(), "path to destination credentials")
     ("hardwareids,h", po::value<std::string>(&hardwareids)->required(), "list of hardware ids")
     ("cacert", po::value<std::string>(&cacerts), "override path to CA root certificates, in the same format as curl --cacert")
-    ("jobs", po::value<int>(&max_curl_requests)->default_value(30), "maximum number of parallel requests")
+    ("jobs", po::value<int>(&max_curl_requests)->default_value(kDefaultMaxCurlRequests), "maximum number of parallel requests (raised gradually up to it while the server keeps up)")
     ("dry-run,n", "check arguments and authenticate but don't upload");
   // clang-format on
 
@@ -106,13 +106,20 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
-  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeHttpRepo>(&fetch_server);
+  auto http_repo = std::make_shared<OSTreeHttpRepo>(&fetch_server);
+  OSTreeRepo::ptr src_repo = http_repo;
   try {
     OSTreeHash commit(OSTreeHash::Parse(ostree_commit));
-    // Since the fetches happen on a single thread in OSTreeHttpRepo, there
-    // isn't much reason to upload in parallel, but why hold the system back if
-    // the fetching is faster than the uploading?
-    if (!UploadToTreehub(src_repo, push_server, commit, mode, max_curl_requests)) {
+    // Fetch the source objects in parallel in the background, so that the
+    // upload mostly finds them already on disk instead of waiting for one
+    // download at a time. A dry run doesn't need their contents.
+    if (mode == RunMode::kDefault || mode == RunMode::kPushTree) {
+      http_repo->StartPrefetch(commit, max_curl_requests);
+    }
+    const bool uploaded = UploadToTreehub(src_repo, push_server, commit, mode, max_curl_requests);
+    // Anything the upload did not need is not worth downloading any more.
+    http_repo->StopPrefetch();
+    if (!uploaded) {
       LOG_FATAL << "Upload to treehub failed";
       return EXIT_FAILURE;
     }
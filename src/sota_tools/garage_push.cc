@@ -24,7 +24,9 @@ int main(int argc, char **argv) {
   boost::filesystem::path credentials_path;
   std::string cacerts;
   boost::filesystem::path manifest_path;
+  boost::filesystem::path object_cache_path;
   int max_curl_requests;
+  std::string log_format;
   RunMode mode = RunMode::kDefault;
   po::options_description desc("garage-push command line options");
   // clang-format off
@@ -33,12 +35,15 @@ int main(int argc, char **argv) {
     ("version", "Current garage-push version")
     ("verbose,v", accumulator<int>(&verbosity), "Verbose logging (use twice for more information)")
     ("quiet,q", "Quiet mode")
+    ("log-format", po::value<std::string>(&log_format)->default_value("text"), "format of the log: text or json")
     ("repo,C", po::value<boost::filesystem::path>(&repo_path)->required(), "location of OSTree repo")
     ("ref,r", po::value<std::string>(&ref)->required(), "OSTree ref to push (or commit refhash)")
     ("credentials,j", po::value<boost::filesystem::path>(&credentials_path)->required(), "credentials (json or zip containing json)")
     ("cacert", po::value<std::string>(&cacerts), "override path to CA root certificates, in the same format as curl --cacert")
     ("repo-manifest", po::value<boost::filesystem::path>(&manifest_path), "manifest describing repository branches used in the image, to be sent as attached metadata")
-    ("jobs", po::value<int>(&max_curl_requests)->default_value(30), "maximum number of parallel requests")
+    ("jobs", po::value<int>(&max_curl_requests)->default_value(kDefaultMaxCurlRequests), "maximum number of parallel requests (raised gradually up to it while the server keeps up)")
+    ("object-cache", po::value<boost::filesystem::path>(&object_cache_path), "file recording the objects known to be present on the server")
+    ("trust-cache", "skip presence checks for objects recorded in --object-cache (otherwise they are revalidated)")
     ("dry-run,n", "check arguments and authenticate but don't upload")
     ("walk-tree,w", "walk entire tree and upload all missing objects");
   // clang-format on
@@ -64,6 +69,16 @@ int main(int argc, char **argv) {
   }
 
   // Configure logging
+  if (log_format != "text" && log_format != "json") {
+    LOG_FATAL << "--log-format must be text or json";
+    return EXIT_FAILURE;
+  }
+  // Every object is logged, which must not slow down the upload.
+  LogSinkOptions log_options;
+  log_options.async = true;
+  log_options.json = log_format == "json";
+  log_options.repeat_window_sec = 10;
+  logger_init(log_options);
   if (verbosity == 0) {
     // 'verbose' trumps 'quiet'
     if (static_cast<int>(vm.count("quiet")) != 0) {
@@ -135,7 +150,14 @@ int main(int argc, char **argv) {
       LOG_FATAL << "Authentication with push server failed";
       return EXIT_FAILURE;
     }
-    if (!UploadToTreehub(src_repo, push_server, *commit, mode, max_curl_requests)) {
+    std::unique_ptr<ServerObjectCache> object_cache;
+    if (!object_cache_path.empty()) {
+      object_cache = std_::make_unique<ServerObjectCache>(object_cache_path, push_server.root_url(),
+                                                          vm.count("trust-cache") != 0U);
+    } else if (vm.count("trust-cache") != 0U) {
+      LOG_WARNING << "--trust-cache has no effect without --object-cache";
+    }
+    if (!UploadToTreehub(src_repo, push_server, *commit, mode, max_curl_requests, object_cache.get())) {
       LOG_FATAL << "Upload to treehub failed";
       return EXIT_FAILURE;
     }
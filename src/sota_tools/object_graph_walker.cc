@@ -0,0 +1,157 @@
+#include "object_graph_walker.h"
+
+#include <assert.h>
+
+#include "logging/logging.h"
+
+ObjectGraphWalker::ObjectGraphWalker(const OSTreeRepo& repo, unsigned int num_threads) : repo_(repo) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    queues_.emplace_back(new WorkQueue());
+  }
+}
+
+ObjectGraphWalker::~ObjectGraphWalker() {
+  Stop();
+  Wait();
+}
+
+void ObjectGraphWalker::Stop() {
+  {
+    std::lock_guard<std::mutex> guard(idle_mutex_);
+    stopped_ = true;
+  }
+  idle_cv_.notify_all();
+}
+
+void ObjectGraphWalker::Start(const OSTreeHash& root, const OstreeObjectType type) {
+  assert(threads_.empty());
+  {
+    std::lock_guard<std::mutex> guard(visited_mutex_);
+    visited_.insert(root);
+  }
+  Push(0, Item(root, type));
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    threads_.emplace_back(&ObjectGraphWalker::Run, this, i);
+  }
+}
+
+void ObjectGraphWalker::Wait() {
+  for (std::thread& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+std::vector<OSTreeChildRef> ObjectGraphWalker::TakeFound() {
+  std::vector<OSTreeChildRef> found;
+  std::lock_guard<std::mutex> guard(found_mutex_);
+  found.swap(found_);
+  return found;
+}
+
+void ObjectGraphWalker::Run(const size_t index) {
+  const uint8_t no_hash[32]{};
+  Item item(OSTreeHash(no_hash), OstreeObjectType::OSTREE_OBJECT_TYPE_UNKNOWN);
+  // pending_ only drops to zero once every discovered object has been
+  // processed, as children are pushed before their parent is accounted for.
+  while (!stopped_ && pending_ > 0) {
+    if (!Pop(index, &item)) {
+      // Other threads may still discover more work.
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      idle_cv_.wait(lock, [this] { return stopped_ || pending_ == 0 || HasWork(); });
+      continue;
+    }
+    try {
+      Process(index, item);
+    } catch (const std::exception& e) {
+      LOG_DEBUG << "Could not parse OSTree object " << item.first << " ahead of time: " << e.what();
+    }
+    if (--pending_ == 0) {
+      // Wake up the idle threads to let them finish.
+      std::lock_guard<std::mutex> guard(idle_mutex_);
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+bool ObjectGraphWalker::Pop(const size_t index, Item* item) {
+  {
+    WorkQueue& own = *queues_[index];
+    std::lock_guard<std::mutex> guard(own.mutex);
+    if (!own.items.empty()) {
+      *item = own.items.back();
+      own.items.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    WorkQueue& victim = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> guard(victim.mutex);
+    if (!victim.items.empty()) {
+      *item = victim.items.front();
+      victim.items.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ObjectGraphWalker::HasWork() {
+  for (const std::unique_ptr<WorkQueue>& queue : queues_) {
+    std::lock_guard<std::mutex> guard(queue->mutex);
+    if (!queue->items.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ObjectGraphWalker::Push(const size_t index, const Item& item) {
+  ++pending_;
+  {
+    WorkQueue& own = *queues_[index];
+    std::lock_guard<std::mutex> guard(own.mutex);
+    own.items.push_back(item);
+  }
+  // Taking the lock makes sure that a thread about to wait sees the new item.
+  std::lock_guard<std::mutex> guard(idle_mutex_);
+  idle_cv_.notify_one();
+}
+
+void ObjectGraphWalker::Process(const size_t index, const Item& item) {
+  if (!repo_.HasCompleteObject(item.first, item.second)) {
+    // Not available (yet), leave it to OSTreeObject::PopulateChildren.
+    return;
+  }
+  std::vector<OSTreeChildRef> children = OSTreeObject::ParseChildren(repo_.ObjectPath(item.first, item.second));
+  std::vector<OSTreeChildRef> found;
+  for (const OSTreeChildRef& child : children) {
+    bool inserted;
+    {
+      std::lock_guard<std::mutex> guard(visited_mutex_);
+      inserted = visited_.insert(child.first).second;
+    }
+    if (!inserted) {
+      continue;
+    }
+    // Only commits and dirtrees have children of their own.
+    if (child.second == OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE) {
+      Push(index, child);
+    }
+    if (repo_.HasCompleteObject(child.first, child.second)) {
+      found.push_back(child);
+    }
+  }
+  if (!found.empty()) {
+    std::lock_guard<std::mutex> guard(found_mutex_);
+    found_.insert(found_.end(), found.begin(), found.end());
+  }
+  repo_.CacheChildren(item.first, std::move(children));
+  ++objects_parsed_;
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,81 @@
+#ifndef SOTA_CLIENT_TOOLS_OBJECT_GRAPH_WALKER_H_
+#define SOTA_CLIENT_TOOLS_OBJECT_GRAPH_WALKER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "ostree_hash.h"
+#include "ostree_object.h"
+#include "ostree_repo.h"
+
+/**
+ * Walk the object graph of a commit on several threads ahead of the upload.
+ *
+ * The walker parses commit and dirtree objects that are completely available
+ * (see OSTreeRepo::HasCompleteObject) and stores their children in the
+ * repository (OSTreeRepo::CacheChildren), so that
+ * OSTreeObject::PopulateChildren does not have to parse them on the
+ * RequestPool thread when the server answers. Objects that are not available
+ * yet, such as ones still being downloaded, are skipped, and will be parsed on
+ * demand as before. Every complete object found on the way is handed out
+ * through TakeFound(), so that it can be queried ahead of the regular walk
+ * (RequestPool::AddSpeculativeQuery).
+ *
+ * Work is distributed with a simple work-stealing scheme: each thread pushes
+ * the children it discovers to the back of its own queue and pops from there,
+ * and idle threads steal from the front of the other queues. Threads without
+ * work sleep until more is pushed or the walk is over.
+ */
+class ObjectGraphWalker {
+ public:
+  ObjectGraphWalker(const OSTreeRepo& repo, unsigned int num_threads);
+  ObjectGraphWalker(const ObjectGraphWalker&) = delete;
+  ObjectGraphWalker operator=(const ObjectGraphWalker&) = delete;
+  /* Stops the walk if it is still running. */
+  ~ObjectGraphWalker();
+
+  /* Start walking from the given object in the background. */
+  void Start(const OSTreeHash& root, OstreeObjectType type);
+  /* Wait for the walk to finish. */
+  void Wait();
+  /* Objects found since the last call, other than the root. Thread-safe. */
+  std::vector<OSTreeChildRef> TakeFound();
+
+  size_t objects_parsed() const { return objects_parsed_; }
+
+ private:
+  using Item = std::pair<OSTreeHash, OstreeObjectType>;
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Item> items;
+  };
+
+  void Run(size_t index);
+  bool Pop(size_t index, Item* item);
+  bool HasWork();
+  void Push(size_t index, const Item& item);
+  void Process(size_t index, const Item& item);
+  void Stop();
+
+  const OSTreeRepo& repo_;
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  std::mutex visited_mutex_;
+  std::set<OSTreeHash> visited_;
+  std::mutex found_mutex_;
+  std::vector<OSTreeChildRef> found_;
+  std::atomic<size_t> pending_{0};  // items queued or being processed
+  std::atomic<size_t> objects_parsed_{0};
+  std::atomic<bool> stopped_{false};
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_OBJECT_GRAPH_WALKER_H_
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <set>
+#include <vector>
+
+#include "object_graph_walker.h"
 #include "ostree_dir_repo.h"
 #include "ostree_ref.h"
 
@@ -73,6 +77,42 @@ TEST(dir_repo, GetObject_Missing) {
   EXPECT_THROW(src_repo->GetObject(hash, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META), OSTreeObjectMissing);
 }
 
+/* Parse the object graph on several threads ahead of time.
+ * Every commit and dirtree object gets its children cached in the repo.
+ * Every other object is found exactly once. */
+TEST(dir_repo, ObjectGraphWalker) {
+  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeDirRepo>("tests/sota_tools/bigger_repo");
+  const OSTreeHash commit = src_repo->GetRef("master").GetHash();
+  ObjectGraphWalker walker(*src_repo, 4);
+  walker.Start(commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT);
+  walker.Wait();
+
+  std::vector<OSTreeChildRef> children;
+  ASSERT_TRUE(src_repo->CachedChildren(commit, &children));
+  EXPECT_EQ(children.size(), 2);
+  size_t dirtrees = 0;
+  for (const OSTreeChildRef &child : children) {
+    if (child.second == OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE) {
+      std::vector<OSTreeChildRef> grandchildren;
+      EXPECT_TRUE(src_repo->CachedChildren(child.first, &grandchildren));
+      ++dirtrees;
+    }
+  }
+  EXPECT_EQ(dirtrees, 1);
+  EXPECT_GT(walker.objects_parsed(), 1);
+
+  const std::vector<OSTreeChildRef> found = walker.TakeFound();
+  std::set<OSTreeHash> unique;
+  for (const OSTreeChildRef &object : found) {
+    EXPECT_TRUE(src_repo->HasCompleteObject(object.first, object.second));
+    unique.insert(object.first);
+  }
+  EXPECT_EQ(unique.size(), found.size());
+  EXPECT_EQ(unique.count(commit), 0);
+  EXPECT_GT(found.size(), walker.objects_parsed());
+  EXPECT_TRUE(walker.TakeFound().empty());
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -2,15 +2,39 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
 
 #include <boost/property_tree/ini_parser.hpp>
 
 #include "logging/logging.h"
+#include "rate_controller.h"
 #include "utilities/utils.h"
 
 namespace pt = boost::property_tree;
 
+namespace {
+// A prefetch that fails is retried once before the object is left to the
+// regular fetch path, which has its own retry logic.
+const int kMaxPrefetchAttempts = 2;
+
+struct PrefetchRequest {
+  OSTreeChildRef object;
+  std::string path;
+  boost::filesystem::path part_path;
+  int fd;
+  int attempt;
+  RateController::clock::time_point start_time;
+};
+}  // namespace
+
+OSTreeHttpRepo::~OSTreeHttpRepo() { StopPrefetch(); }
+
 bool OSTreeHttpRepo::LooksValid() const {
   if (FetchObject("config")) {
     pt::ptree config;
@@ -36,17 +60,46 @@ bool OSTreeHttpRepo::LooksValid() const {
 
 OSTreeRef OSTreeHttpRepo::GetRef(const std::string &refname) const { return OSTreeRef(*server_, refname); }
 
+bool OSTreeHttpRepo::HasCompleteObject(const OSTreeHash &hash, const OstreeObjectType type) const {
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  return fetched_.count(ObjectRelativePath(hash, type).string()) != 0;
+}
+
 bool OSTreeHttpRepo::FetchObject(const boost::filesystem::path &path) const {
+  {
+    std::unique_lock<std::mutex> lock(prefetch_mutex_);
+    prefetch_cv_.wait(lock, [this, &path] { return prefetch_in_flight_.count(path.string()) == 0; });
+    if (fetched_.count(path.string()) != 0) {
+      return true;
+    }
+    // Keep the prefetch thread from reading the object before it is complete.
+    prefetch_in_flight_.insert(path.string());
+  }
+  const bool ok = DownloadObject(path);
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    prefetch_in_flight_.erase(path.string());
+    if (ok) {
+      fetched_.insert(path.string());
+    }
+  }
+  prefetch_cv_.notify_all();
+  return ok;
+}
+
+bool OSTreeHttpRepo::DownloadObject(const boost::filesystem::path &path) const {
   CURLcode err = CURLE_OK;
   CurlEasyWrapper easy_handle;
   curlEasySetoptWrapper(easy_handle.get(), CURLOPT_VERBOSE, get_curlopt_verbose());
   server_->InjectIntoCurl(path.string(), easy_handle.get());
   curlEasySetoptWrapper(easy_handle.get(), CURLOPT_WRITEFUNCTION, &OSTreeHttpRepo::curl_handle_write);
   boost::filesystem::create_directories((root_ / path).parent_path());
-  std::string filename = (root_ / path).string();
-  int fp = open(filename.c_str(), O_WRONLY | O_CREAT, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
+  // Download next to the object and move it into place once complete, so that
+  // the object is never seen partially written.
+  const std::string part_filename = (root_ / path).string() + ".part";
+  int fp = open(part_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
   if (fp == -1) {
-    LOG_ERROR << "Failed to open file: " << filename;
+    LOG_ERROR << "Failed to open file: " << part_filename;
     return false;
   }
   curlEasySetoptWrapper(easy_handle.get(), CURLOPT_WRITEDATA, &fp);
@@ -57,7 +110,7 @@ bool OSTreeHttpRepo::FetchObject(const boost::filesystem::path &path) const {
   if (err == CURLE_HTTP_RETURNED_ERROR) {
     // http error (error code >= 400)
     // verbose mode will display the details
-    remove((root_ / path).c_str());
+    remove(part_filename.c_str());
     return false;
   } else if (err != CURLE_OK) {
     // other unexpected error
@@ -67,13 +120,243 @@ bool OSTreeHttpRepo::FetchObject(const boost::filesystem::path &path) const {
     if (last_url != nullptr) {
       LOG_ERROR << "Url: " << last_url;
     }
-    remove((root_ / path).c_str());
+    remove(part_filename.c_str());
     return false;
   }
 
+  boost::system::error_code ec;
+  boost::filesystem::rename(part_filename, root_ / path, ec);
+  if (ec) {
+    LOG_ERROR << "Failed to move " << part_filename << " into place: " << ec.message();
+    remove(part_filename.c_str());
+    return false;
+  }
   return true;
 }
 
+void OSTreeHttpRepo::StartPrefetch(const OSTreeHash &commit, const int max_requests) {
+  StopPrefetch();
+  // Make sure curl is initialised before other threads may call
+  // curl_global_init() again: only the first call is not thread-safe.
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  prefetch_stop_ = false;
+  prefetch_thread_ = std::thread(&OSTreeHttpRepo::PrefetchLoop, this, commit, std::max(max_requests, 1));
+}
+
+void OSTreeHttpRepo::StopPrefetch() {
+  if (prefetch_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(prefetch_mutex_);
+      prefetch_stop_ = true;
+    }
+    prefetch_cv_.notify_all();
+    prefetch_thread_.join();
+    curl_global_cleanup();
+  }
+}
+
+size_t OSTreeHttpRepo::objects_prefetched() const {
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  return prefetched_.size();
+}
+
+void OSTreeHttpRepo::PrefetchLoop(const OSTreeHash commit, const int max_requests) {
+  CURLM *multi = curl_multi_init();
+  if (multi == nullptr) {
+    LOG_WARNING << "Could not initialize curl multi handle, not prefetching objects";
+    return;
+  }
+  std::deque<std::pair<OSTreeChildRef, int>> queue;
+  std::set<OSTreeHash> seen;
+  std::map<CURL *, PrefetchRequest> running;
+  std::list<OSTreeChildRef> waiting;
+  // Only the regular fetch path is left once the server looks overloaded.
+  RateController rate_controller(max_requests);
+
+  queue.emplace_back(OSTreeChildRef(commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT), 1);
+  seen.insert(commit);
+
+  // Parse a downloaded commit or dirtree and queue its children.
+  auto expand = [this, &queue, &seen](const OSTreeChildRef &object) {
+    if (object.second != OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT &&
+        object.second != OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE) {
+      return;
+    }
+    try {
+      const std::vector<OSTreeChildRef> children = OSTreeObject::ParseChildren(ObjectPath(object.first, object.second));
+      CacheChildren(object.first, children);
+      for (const OSTreeChildRef &child : children) {
+        if (seen.insert(child.first).second) {
+          queue.emplace_back(child, 1);
+        }
+      }
+    } catch (const std::exception &e) {
+      LOG_DEBUG << "Prefetch could not parse " << object.first << ": " << e.what();
+    }
+  };
+
+  while (!prefetch_stop_ && (!queue.empty() || !running.empty() || !waiting.empty())) {
+    while (running.size() < static_cast<size_t>(rate_controller.MaxConcurrency()) && !queue.empty()) {
+      const OSTreeChildRef object = queue.front().first;
+      const int attempt = queue.front().second;
+      queue.pop_front();
+
+      const std::string path = ObjectRelativePath(object.first, object.second).string();
+      const boost::filesystem::path full_path = root_ / path;
+      {
+        std::lock_guard<std::mutex> lock(prefetch_mutex_);
+        if (prefetch_in_flight_.count(path) != 0) {
+          // Being fetched by the main thread, look at it again once it is done.
+          waiting.push_back(object);
+          continue;
+        }
+        if (fetched_.count(path) != 0) {
+          // Completely fetched by the main thread.
+          expand(object);
+          continue;
+        }
+        prefetch_in_flight_.insert(path);
+      }
+
+      boost::filesystem::create_directories(full_path.parent_path());
+      const boost::filesystem::path part_path = full_path.string() + ".part";
+      const int fd =
+          open(part_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);  // NOLINT
+      CURL *handle = (fd == -1) ? nullptr : curl_easy_init();
+      if (handle == nullptr) {
+        LOG_WARNING << "Failed to start prefetch of " << path;
+        if (fd != -1) {
+          close(fd);
+          remove(part_path.c_str());
+        }
+        {
+          std::lock_guard<std::mutex> lock(prefetch_mutex_);
+          prefetch_in_flight_.erase(path);
+        }
+        prefetch_cv_.notify_all();
+        continue;
+      }
+      PrefetchRequest &request =
+          running.emplace(handle, PrefetchRequest{object, path, part_path, fd, attempt, RateController::clock::now()})
+              .first->second;
+      curlEasySetoptWrapper(handle, CURLOPT_VERBOSE, get_curlopt_verbose());
+      server_->InjectIntoCurl(path, handle);
+      curlEasySetoptWrapper(handle, CURLOPT_WRITEFUNCTION, &OSTreeHttpRepo::curl_handle_write);
+      curlEasySetoptWrapper(handle, CURLOPT_WRITEDATA, &request.fd);
+      curlEasySetoptWrapper(handle, CURLOPT_FAILONERROR, true);
+      curl_multi_add_handle(multi, handle);
+    }
+
+    // Objects the main thread was fetching are expanded once it has completed
+    // them, or fetched here if it failed.
+    for (auto it = waiting.begin(); it != waiting.end();) {
+      const std::string path = ObjectRelativePath(it->first, it->second).string();
+      bool in_flight;
+      bool fetched;
+      {
+        std::lock_guard<std::mutex> lock(prefetch_mutex_);
+        in_flight = prefetch_in_flight_.count(path) != 0;
+        fetched = fetched_.count(path) != 0;
+      }
+      if (in_flight) {
+        ++it;
+        continue;
+      }
+      if (fetched) {
+        expand(*it);
+      } else {
+        queue.emplace_back(*it, 1);
+      }
+      it = waiting.erase(it);
+    }
+    if (running.empty()) {
+      if (queue.empty() && !waiting.empty()) {
+        std::unique_lock<std::mutex> lock(prefetch_mutex_);
+        prefetch_cv_.wait_for(lock, std::chrono::milliseconds(100));
+      }
+      continue;
+    }
+
+    int numfds = 0;
+    curl_multi_wait(multi, nullptr, 0, 100, &numfds);
+    int still_running = 0;
+    curl_multi_perform(multi, &still_running);
+
+    int msgs_in_queue = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi, &msgs_in_queue)) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      CURL *handle = msg->easy_handle;
+      const CURLcode result = msg->data.result;
+      long rescode = 0;  // NOLINT(google-runtime-int)
+      curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &rescode);
+      curl_off_t downloaded = 0;
+      curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+      const PrefetchRequest request = running.at(handle);
+      running.erase(handle);
+      curl_multi_remove_handle(multi, handle);
+      curl_easy_cleanup(handle);
+      close(request.fd);
+
+      bool ok = (result == CURLE_OK);
+      if (ok) {
+        boost::system::error_code ec;
+        boost::filesystem::rename(request.part_path, root_ / request.path, ec);
+        ok = !ec;
+      }
+      if (!ok) {
+        remove(request.part_path.c_str());
+        LOG_DEBUG << "Prefetch of " << request.path << " failed: " << curl_easy_strerror(result);
+      }
+      {
+        std::lock_guard<std::mutex> lock(prefetch_mutex_);
+        prefetch_in_flight_.erase(request.path);
+        if (ok) {
+          prefetched_.insert(request.path);
+          fetched_.insert(request.path);
+        }
+      }
+      prefetch_cv_.notify_all();
+
+      // Missing objects are not the server's fault, throttling and errors are.
+      const bool server_ok =
+          result == CURLE_OK || (result == CURLE_HTTP_RETURNED_ERROR && rescode < 500 && rescode != 429);
+      rate_controller.RequestCompleted(request.start_time, RateController::clock::now(), server_ok,
+                                       static_cast<uint64_t>(std::max<curl_off_t>(downloaded, 0)), "prefetch");
+
+      if (ok) {
+        expand(request.object);
+      } else if (request.attempt < kMaxPrefetchAttempts) {
+        queue.emplace_back(request.object, request.attempt + 1);
+      }
+    }
+
+    if (rate_controller.ServerHasFailed()) {
+      LOG_WARNING << "Source server looks overloaded, not prefetching any more objects";
+      break;
+    }
+    const RateController::clock::duration sleep_time = rate_controller.GetSleepTime();
+    if (sleep_time > RateController::clock::duration(0)) {
+      std::unique_lock<std::mutex> lock(prefetch_mutex_);
+      prefetch_cv_.wait_for(lock, sleep_time, [this] { return prefetch_stop_.load(); });
+    }
+  }
+
+  // Abandon whatever is still in flight when stopping early.
+  for (const auto &entry : running) {
+    curl_multi_remove_handle(multi, entry.first);
+    curl_easy_cleanup(entry.first);
+    close(entry.second.fd);
+    remove(entry.second.part_path.c_str());
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    prefetch_in_flight_.erase(entry.second.path);
+  }
+  prefetch_cv_.notify_all();
+  curl_multi_cleanup(multi);
+  LOG_DEBUG << "Prefetched " << objects_prefetched() << " OSTree objects: " << rate_controller.Summary();
+}
+
 size_t OSTreeHttpRepo::curl_handle_write(void *buffer, size_t size, size_t nmemb, void *userp) {
   return static_cast<size_t>(write(*static_cast<int *>(userp), buffer, nmemb * size));
 }
@@ -1,8 +1,16 @@
 #ifndef SOTA_CLIENT_TOOLS_OSTREE_HTTP_REPO_H_
 #define SOTA_CLIENT_TOOLS_OSTREE_HTTP_REPO_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
 #include <boost/filesystem.hpp>
 
+#include "ostree_hash.h"
 #include "ostree_ref.h"
 #include "ostree_repo.h"
 #include "treehub_server.h"
@@ -15,19 +23,54 @@ class OSTreeHttpRepo : public OSTreeRepo {
       root_ = root_tmp_.Path();
     }
   }
-  ~OSTreeHttpRepo() override = default;
+  ~OSTreeHttpRepo() override;
 
   bool LooksValid() const override;
   OSTreeRef GetRef(const std::string& refname) const override;
   boost::filesystem::path root() const override { return root_; }
+  /* Only objects whose download has finished, files on disk may be partial. */
+  bool HasCompleteObject(const OSTreeHash& hash, OstreeObjectType type) const override;
+
+  /**
+   * Start downloading the object graph below commit in the background. A
+   * RateController paces the transfers: it starts with one in flight and
+   * raises that up to max_requests while the server keeps up. Dirtree and
+   * commit objects are parsed as soon as they arrive, so the next level of the
+   * tree is fetched while the caller is still busy with the previous one.
+   * Objects requested via GetObject() while their prefetch is running wait for
+   * it instead of being downloaded a second time. Failed prefetches are left
+   * to the regular (serial) fetch path, as is everything else once the server
+   * looks overloaded.
+   */
+  void StartPrefetch(const OSTreeHash& commit, int max_requests);
+  /* Stop the background prefetch, abandoning the transfers in flight. */
+  void StopPrefetch();
+
+  /* Number of objects completed by the background prefetch so far. */
+  size_t objects_prefetched() const;
 
  private:
   bool FetchObject(const boost::filesystem::path& path) const override;
+  bool DownloadObject(const boost::filesystem::path& path) const;
   static size_t curl_handle_write(void* buffer, size_t size, size_t nmemb, void* userp);
 
+  void PrefetchLoop(OSTreeHash commit, int max_requests);
+
   TreehubServer* server_;
   boost::filesystem::path root_;
   const TemporaryDirectory root_tmp_;
+
+  std::thread prefetch_thread_;
+  std::atomic<bool> prefetch_stop_{false};
+  mutable std::mutex prefetch_mutex_;
+  mutable std::condition_variable prefetch_cv_;
+  // Object paths (relative to root_) currently being downloaded by either
+  // thread, those that have been downloaded completely, and those of them
+  // that were downloaded by the prefetch thread. Objects are only parsed once
+  // they are known to be complete.
+  mutable std::set<std::string> prefetch_in_flight_;
+  mutable std::set<std::string> fetched_;
+  std::set<std::string> prefetched_;
 };
 
 // vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -108,6 +108,46 @@ TEST(http_repo, bad_connection) {
   EXPECT_EQ(result, 0) << "Diff between source and destination repos is nonzero.";
 }
 
+/* Prefetch the whole object graph of a commit in the background.
+ * Objects fetched afterwards are served from the prefetched copies. */
+TEST(http_repo, Prefetch) {
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+  auto http_repo = std::make_shared<OSTreeHttpRepo>(&server);
+  OSTreeRepo::ptr src_repo = http_repo;
+  auto hash = OSTreeHash::Parse("b9ac1e45f9227df8ee191b6e51e09417bd36c6ebbeff999431e3073ac50f0563");
+  http_repo->StartPrefetch(hash, 4);
+
+  const uint8_t dirmeta[32] = {0x44, 0x6a, 0x0e, 0xf1, 0x1b, 0x7c, 0xc1, 0x67, 0xf3, 0xb6, 0x03,
+                               0xe5, 0x85, 0xc7, 0xee, 0xee, 0xb6, 0x75, 0xfa, 0xa4, 0x12, 0xd5,
+                               0xec, 0x73, 0xf6, 0x29, 0x88, 0xeb, 0x0b, 0x6c, 0x54, 0x88};
+  auto object = src_repo->GetObject(dirmeta, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META);
+  EXPECT_EQ(object->object_name(), "44/6a0ef11b7cc167f3b603e585c7eeeeb675faa412d5ec73f62988eb0b6c5488.dirmeta");
+
+  // The test repository has a commit, a dirtree, a dirmeta and ten files.
+  for (int i = 0; i < 100 && http_repo->objects_prefetched() < 13; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  EXPECT_EQ(http_repo->objects_prefetched(), 13);
+  EXPECT_TRUE(
+      boost::filesystem::is_regular_file(src_repo->ObjectPath(hash, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT)));
+}
+
+/* Nothing more is prefetched once the prefetch has been stopped. */
+TEST(http_repo, StopPrefetch) {
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+  auto http_repo = std::make_shared<OSTreeHttpRepo>(&server);
+  auto hash = OSTreeHash::Parse("b9ac1e45f9227df8ee191b6e51e09417bd36c6ebbeff999431e3073ac50f0563");
+  http_repo->StartPrefetch(hash, 4);
+  http_repo->StopPrefetch();
+
+  const size_t prefetched = http_repo->objects_prefetched();
+  EXPECT_LT(prefetched, 13);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_EQ(http_repo->objects_prefetched(), prefetched);
+}
+
 TEST(http_repo, root) {
   TreehubServer server;
   server.root_url("http://localhost:" + port);
@@ -73,34 +73,31 @@ void OSTreeObject::AppendChild(const OSTreeObject::ptr &child) {
 
 // Can throw OSTreeObjectMissing if the repo is corrupt
 void OSTreeObject::PopulateChildren() {
-  const boost::filesystem::path ext = file_path_.extension();
-  const GVariantType *content_type;
-  bool is_commit;
-
-  // variant types are borrowed from libostree/ostree-core.h,
-  // but we don't want to create dependency on it
-  if (ext.compare(".commit") == 0) {
-    content_type = G_VARIANT_TYPE("(a{sv}aya(say)sstayay)");
-    is_commit = true;
-  } else if (ext.compare(".dirtree") == 0) {
-    content_type = G_VARIANT_TYPE("(a(say)a(sayay))");
-    is_commit = false;
-  } else {
-    return;
+  std::vector<OSTreeChildRef> children;
+  if (!repo_.CachedChildren(hash(), &children)) {
+    children = ParseChildren(file_path_);
   }
-
-  GError *gerror = nullptr;
-  GMappedFile *mfile = g_mapped_file_new(file_path_.c_str(), FALSE, &gerror);
-
-  if (mfile == nullptr) {
-    throw std::runtime_error("Failed to map metadata file " + file_path_.native());
+  for (const OSTreeChildRef &child : children) {
+    AppendChild(repo_.GetObject(child.first, child.second));
   }
+}
 
-  GVariant *contents =
-      g_variant_new_from_data(content_type, g_mapped_file_get_contents(mfile), g_mapped_file_get_length(mfile), TRUE,
-                              reinterpret_cast<GDestroyNotify>(g_mapped_file_unref), mfile);
-  g_variant_ref_sink(contents);
+namespace {
+// variant types are borrowed from libostree/ostree-core.h,
+// but we don't want to create dependency on it
+const GVariantType *MetadataVariantType(const OstreeObjectType type) {
+  switch (type) {
+    case OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT:
+      return G_VARIANT_TYPE("(a{sv}aya(say)sstayay)");
+    case OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE:
+      return G_VARIANT_TYPE("(a(say)a(sayay))");
+    default:
+      return nullptr;
+  }
+}
 
+std::vector<OSTreeChildRef> ChildrenFromVariant(GVariant *contents, const bool is_commit) {
+  std::vector<OSTreeChildRef> children;
   if (is_commit) {
     // * - ay - Root tree contents
     GVariant *content_csum_variant = nullptr;
@@ -109,14 +106,14 @@ void OSTreeObject::PopulateChildren() {
     gsize n_elts;
     const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(content_csum_variant, &n_elts, 1));
     assert(n_elts == 32);
-    AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE));
+    children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE);
 
     // * - ay - Root tree metadata
     GVariant *meta_csum_variant = nullptr;
     g_variant_get_child(contents, 7, "@ay", &meta_csum_variant);
     csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(meta_csum_variant, &n_elts, 1));
     assert(n_elts == 32);
-    AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META));
+    children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META);
 
     g_variant_unref(meta_csum_variant);
     g_variant_unref(content_csum_variant);
@@ -139,7 +136,7 @@ void OSTreeObject::PopulateChildren() {
       gsize n_elts;
       const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_FILE));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_FILE);
 
       g_variant_unref(csum_variant);
     }
@@ -154,12 +151,12 @@ void OSTreeObject::PopulateChildren() {
       // First the .dirtree:
       const auto *csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(content_csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE);
 
       // Then the .dirmeta:
       csum = static_cast<const uint8_t *>(g_variant_get_fixed_array(meta_csum_variant, &n_elts, 1));
       assert(n_elts == 32);
-      AppendChild(repo_.GetObject(csum, OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META));
+      children.emplace_back(OSTreeHash(csum), OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META);
 
       g_variant_unref(meta_csum_variant);
       g_variant_unref(content_csum_variant);
@@ -168,19 +165,76 @@ void OSTreeObject::PopulateChildren() {
     g_variant_unref(dirs_variant);
     g_variant_unref(files_variant);
   }
+  return children;
+}
+}  // namespace
+
+std::vector<OSTreeChildRef> OSTreeObject::ParseChildren(const boost::filesystem::path &file_path) {
+  const boost::filesystem::path ext = file_path.extension();
+  OstreeObjectType type;
+  if (ext.compare(".commit") == 0) {
+    type = OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT;
+  } else if (ext.compare(".dirtree") == 0) {
+    type = OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE;
+  } else {
+    return {};
+  }
+
+  GError *gerror = nullptr;
+  GMappedFile *mfile = g_mapped_file_new(file_path.c_str(), FALSE, &gerror);
+
+  if (mfile == nullptr) {
+    throw std::runtime_error("Failed to map metadata file " + file_path.native());
+  }
+
+  GVariant *contents = g_variant_new_from_data(MetadataVariantType(type), g_mapped_file_get_contents(mfile),
+                                               g_mapped_file_get_length(mfile), TRUE,
+                                               reinterpret_cast<GDestroyNotify>(g_mapped_file_unref), mfile);
+  g_variant_ref_sink(contents);
+  const bool is_commit = type == OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT;
+  std::vector<OSTreeChildRef> children = ChildrenFromVariant(contents, is_commit);
   g_variant_unref(contents);
+  return children;
+}
+
+std::vector<OSTreeChildRef> OSTreeObject::ParseChildren(const OstreeObjectType type, const std::string &data) {
+  const GVariantType *content_type = MetadataVariantType(type);
+  if (content_type == nullptr) {
+    return {};
+  }
+  // The variant doesn't outlive this function, so it can borrow the data.
+  GVariant *contents = g_variant_new_from_data(content_type, data.data(), data.size(), FALSE, nullptr, nullptr);
+  g_variant_ref_sink(contents);
+  const bool is_commit = type == OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT;
+  std::vector<OSTreeChildRef> children = ChildrenFromVariant(contents, is_commit);
+  g_variant_unref(contents);
+  return children;
 }
 
 void OSTreeObject::QueryChildren(RequestPool &pool) {
-  for (const OSTreeObject::ptr &child : children_) {
+  // Iterate over a copy: children that the object cache already knows about
+  // are handled right away, which removes them from children_.
+  const std::list<OSTreeObject::ptr> children = children_;
+  for (const OSTreeObject::ptr &child : children) {
     if (child->is_on_server() == PresenceOnServer::kObjectStateUnknown) {
-      pool.AddQuery(child);
+      if (pool.IsKnownOnServer(*child)) {
+        LOG_DEBUG << "Known to be present from object cache: " << child->object_name_;
+        child->LaunchNotify();
+        child->PresenceCheckDone(pool, 200);
+      } else {
+        pool.AddQuery(child);
+      }
     }
   }
 }
 
 string OSTreeObject::Url() const { return "objects/" + object_name_; }
 
+OSTreeHash OSTreeObject::hash() const {
+  // object_name_ is of the form "ab/cdef...89.dirtree".
+  return OSTreeHash::Parse(object_name_.substr(0, 2) + object_name_.substr(3, 62));
+}
+
 void OSTreeObject::MakeTestRequest(const TreehubServer &push_target, CURLM *curl_multi_handle) {
   assert(!curl_handle_);
   curl_handle_ = curl_easy_init();
@@ -301,21 +355,8 @@ void OSTreeObject::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
     // object hash.
     if (url == nullptr || strstr(url, object_name_.c_str()) == nullptr) {
       PresenceError(pool, rescode);
-    } else if (rescode == 200) {
-      LOG_INFO << "Already present: " << object_name_;
-      is_on_server_ = PresenceOnServer::kObjectPresent;
-      last_operation_result_ = ServerResponse::kOk;
-      if (pool.run_mode() == RunMode::kWalkTree || pool.run_mode() == RunMode::kPushTree) {
-        CheckChildren(pool, rescode);
-      } else {
-        NotifyParents(pool);
-      }
-    } else if (rescode == 404) {
-      is_on_server_ = PresenceOnServer::kObjectMissing;
-      last_operation_result_ = ServerResponse::kOk;
-      CheckChildren(pool, rescode);
     } else {
-      PresenceError(pool, rescode);
+      PresenceCheckDone(pool, rescode);
     }
 
   } else if (current_operation_ == CurrentOp::kOstreeObjectUploading) {
@@ -323,18 +364,8 @@ void OSTreeObject::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
     // object hash.
     if (url == nullptr || strstr(url, object_name_.c_str()) == nullptr) {
       UploadError(pool, rescode);
-    } else if (rescode == 204) {
-      LOG_TRACE << "OSTree upload successful";
-      is_on_server_ = PresenceOnServer::kObjectPresent;
-      last_operation_result_ = ServerResponse::kOk;
-      NotifyParents(pool);
-    } else if (rescode == 409) {
-      LOG_DEBUG << "OSTree upload reported a 409 Conflict, possibly due to concurrent uploads";
-      is_on_server_ = PresenceOnServer::kObjectPresent;
-      last_operation_result_ = ServerResponse::kOk;
-      NotifyParents(pool);
     } else {
-      UploadError(pool, rescode);
+      UploadDone(pool, rescode);
     }
     fclose(fd_);
   } else {
@@ -346,6 +377,47 @@ void OSTreeObject::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
   curl_handle_ = nullptr;
 }
 
+void OSTreeObject::PresenceCheckDone(RequestPool &pool, const long rescode) {  // NOLINT(google-runtime-int)
+  current_operation_ = CurrentOp::kOstreeObjectPresenceCheck;
+  if (rescode == 200) {
+    LOG_INFO << "Already present: " << object_name_;
+    is_on_server_ = PresenceOnServer::kObjectPresent;
+    last_operation_result_ = ServerResponse::kOk;
+    pool.MarkPresentOnServer(*this);
+    if (pool.run_mode() == RunMode::kWalkTree || pool.run_mode() == RunMode::kPushTree) {
+      CheckChildren(pool, rescode);
+    } else {
+      NotifyParents(pool);
+    }
+  } else if (rescode == 404) {
+    is_on_server_ = PresenceOnServer::kObjectMissing;
+    last_operation_result_ = ServerResponse::kOk;
+    pool.MarkMissingOnServer(*this);
+    CheckChildren(pool, rescode);
+  } else {
+    PresenceError(pool, rescode);
+  }
+}
+
+void OSTreeObject::UploadDone(RequestPool &pool, const long rescode) {  // NOLINT(google-runtime-int)
+  current_operation_ = CurrentOp::kOstreeObjectUploading;
+  if (rescode == 204) {
+    LOG_TRACE << "OSTree upload successful";
+    is_on_server_ = PresenceOnServer::kObjectPresent;
+    last_operation_result_ = ServerResponse::kOk;
+    pool.MarkPresentOnServer(*this);
+    NotifyParents(pool);
+  } else if (rescode == 409) {
+    LOG_DEBUG << "OSTree upload reported a 409 Conflict, possibly due to concurrent uploads";
+    is_on_server_ = PresenceOnServer::kObjectPresent;
+    last_operation_result_ = ServerResponse::kOk;
+    pool.MarkPresentOnServer(*this);
+    NotifyParents(pool);
+  } else {
+    UploadError(pool, rescode);
+  }
+}
+
 size_t OSTreeObject::curl_handle_write(void *buffer, size_t size, size_t nmemb, void *userp) {
   auto *that = static_cast<OSTreeObject *>(userp);
   that->http_response_.write(static_cast<const char *>(buffer), static_cast<std::streamsize>(size * nmemb));
@@ -4,6 +4,8 @@
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include <curl/curl.h>
 #include <boost/filesystem.hpp>
@@ -11,6 +13,7 @@
 #include "gtest/gtest_prod.h"
 
 #include "garage_common.h"
+#include "ostree_hash.h"
 #include "treehub_server.h"
 
 class OSTreeRepo;
@@ -27,6 +30,9 @@ enum class CurrentOp { kOstreeObjectUploading, kOstreeObjectPresenceCheck };
  */
 enum class ServerResponse { kNoResponse, kOk, kTemporaryFailure };
 
+/** A reference from a commit or dirtree object to one of its children. */
+using OSTreeChildRef = std::pair<OSTreeHash, OstreeObjectType>;
+
 class OSTreeObject {
  public:
   using ptr = boost::intrusive_ptr<OSTreeObject>;
@@ -50,6 +56,24 @@ class OSTreeObject {
   /* Process a completed curl transaction (presence check or upload). */
   void CurlDone(CURLM* curl_multi_handle, RequestPool& pool);
 
+  /* Process the result of a presence check, whether it was made by this object
+   * or as part of a BatchQuery. */
+  void PresenceCheckDone(RequestPool& pool, long rescode);  // NOLINT(google-runtime-int)
+
+  /* Process the result of an upload, whether it was made by this object or as
+   * part of an UploadBundle. */
+  void UploadDone(RequestPool& pool, long rescode);  // NOLINT(google-runtime-int)
+
+  /* Parse a commit or dirtree object file for its children. Other object
+   * types have no children. This does not touch any shared state, so it is
+   * safe to call from several threads at once. */
+  static std::vector<OSTreeChildRef> ParseChildren(const boost::filesystem::path& file_path);
+  /* The same for an object that is already in memory. */
+  static std::vector<OSTreeChildRef> ParseChildren(OstreeObjectType type, const std::string& data);
+
+  const std::string& object_name() const { return object_name_; }
+  const boost::filesystem::path& file_path() const { return file_path_; }
+  OSTreeHash hash() const;
   PresenceOnServer is_on_server() const { return is_on_server_; }
   CurrentOp operation() const { return current_operation_; }
   bool children_ready() { return children_.empty(); }
@@ -4,12 +4,14 @@
 #include <boost/process.hpp>
 
 #include "authenticate.h"
+#include "batch_query.h"
 #include "garage_common.h"
 #include "ostree_dir_repo.h"
 #include "ostree_object.h"
 #include "request_pool.h"
 #include "server_credentials.h"
 #include "test_utils.h"
+#include "upload_bundle.h"
 
 std::string port;
 std::string repo_path;
@@ -188,6 +190,58 @@ TEST(OstreeObject, UploadSuccess) {
   curl_global_cleanup();
 }
 
+/* Parse the list of present objects returned by a batched query. */
+TEST(BatchQuery, ParseResponse) {
+  const std::set<std::string> present = BatchQuery::ParseResponse("ab/cdef.dirtree\r\n\nef/0123.filez\n");
+  EXPECT_EQ(present.size(), 2);
+  EXPECT_EQ(present.count("ab/cdef.dirtree"), 1);
+  EXPECT_EQ(present.count("ef/0123.filez"), 1);
+  EXPECT_TRUE(BatchQuery::ParseResponse("").empty());
+}
+
+/* Fall back to single queries on any client error but a timeout or
+ * throttling, or when the server does not implement the endpoint. */
+TEST(BatchQuery, IsUnsupportedResponse) {
+  for (const long rescode : {400L, 401L, 403L, 404L, 405L, 415L, 501L}) {  // NOLINT(google-runtime-int)
+    EXPECT_TRUE(BatchQuery::IsUnsupportedResponse(rescode)) << rescode;
+  }
+  for (const long rescode : {0L, 200L, 408L, 429L, 500L, 502L, 503L}) {  // NOLINT(google-runtime-int)
+    EXPECT_FALSE(BatchQuery::IsUnsupportedResponse(rescode)) << rescode;
+  }
+}
+
+/* Fall back to single uploads on the same responses as for queries. */
+TEST(UploadBundle, IsUnsupportedResponse) {
+  for (const long rescode : {400L, 401L, 403L, 404L, 405L, 413L, 415L, 501L}) {  // NOLINT(google-runtime-int)
+    EXPECT_TRUE(UploadBundle::IsUnsupportedResponse(rescode)) << rescode;
+  }
+  for (const long rescode : {0L, 204L, 408L, 429L, 500L, 502L, 503L}) {  // NOLINT(google-runtime-int)
+    EXPECT_FALSE(UploadBundle::IsUnsupportedResponse(rescode)) << rescode;
+  }
+}
+
+/* Walk a tree that is fully present on the server using batched queries.
+ * Every object is found with far fewer requests than there are objects: one
+ * HEAD for the commit, then one batch per level of the tree. */
+TEST(OstreeObject, BatchQueryWalkTree) {
+  TreehubServer push_server;
+  push_server.root_url("http://localhost:" + port);
+
+  OSTreeRepo::ptr src_repo = std::make_shared<OSTreeDirRepo>(repo_path);
+  OSTreeHash hash = src_repo->GetRef("master").GetHash();
+  OSTreeObject::ptr object = src_repo->GetObject(hash, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT);
+
+  RequestPool request_pool(push_server, 30, RunMode::kWalkTree);
+  request_pool.AddQuery(object);
+  do {
+    request_pool.Loop();
+  } while (!request_pool.is_idle() && !request_pool.is_stopped());
+
+  EXPECT_FALSE(request_pool.is_stopped());
+  EXPECT_EQ(object->is_on_server(), PresenceOnServer::kObjectPresent);
+  EXPECT_LE(request_pool.total_requests_made(), 3);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
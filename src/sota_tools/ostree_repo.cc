@@ -1,7 +1,18 @@
 #include "ostree_repo.h"
 
+#include <utility>
+
 #include "logging/logging.h"
 
+static const std::map<OstreeObjectType, std::string> &ObjectExtensions() {
+  static const std::map<OstreeObjectType, std::string> exts{
+      {OstreeObjectType::OSTREE_OBJECT_TYPE_FILE, ".filez"},
+      {OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE, ".dirtree"},
+      {OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META, ".dirmeta"},
+      {OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT, ".commit"}};
+  return exts;
+}
+
 OSTreeObject::ptr OSTreeRepo::GetObject(const uint8_t sha256[32], const OstreeObjectType type) const {
   return GetObject(OSTreeHash(sha256), type);
 }
@@ -12,10 +23,7 @@ OSTreeObject::ptr OSTreeRepo::GetObject(const OSTreeHash hash, const OstreeObjec
     return obj_it->second;
   }
 
-  const std::map<OstreeObjectType, std::string> exts{{OstreeObjectType::OSTREE_OBJECT_TYPE_FILE, ".filez"},
-                                                     {OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE, ".dirtree"},
-                                                     {OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META, ".dirmeta"},
-                                                     {OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT, ".commit"}};
+  const std::map<OstreeObjectType, std::string> &exts = ObjectExtensions();
   const std::string objpath = hash.string().insert(2, 1, '/');
   OSTreeObject::ptr object;
 
@@ -47,3 +55,30 @@ bool OSTreeRepo::CheckForObject(const OSTreeHash &hash, const std::string &path,
   }
   return false;
 }
+
+boost::filesystem::path OSTreeRepo::ObjectPath(const OSTreeHash &hash, const OstreeObjectType type) const {
+  return root() / ObjectRelativePath(hash, type);
+}
+
+boost::filesystem::path OSTreeRepo::ObjectRelativePath(const OSTreeHash &hash, const OstreeObjectType type) {
+  return boost::filesystem::path("objects") / (hash.string().insert(2, 1, '/') + ObjectExtensions().at(type));
+}
+
+bool OSTreeRepo::HasCompleteObject(const OSTreeHash &hash, const OstreeObjectType type) const {
+  return boost::filesystem::is_regular_file(ObjectPath(hash, type));
+}
+
+void OSTreeRepo::CacheChildren(const OSTreeHash &hash, std::vector<OSTreeChildRef> children) const {
+  std::lock_guard<std::mutex> guard(children_cache_mutex_);
+  children_cache_[hash] = std::move(children);
+}
+
+bool OSTreeRepo::CachedChildren(const OSTreeHash &hash, std::vector<OSTreeChildRef> *children) const {
+  std::lock_guard<std::mutex> guard(children_cache_mutex_);
+  auto it = children_cache_.find(hash);
+  if (it == children_cache_.end()) {
+    return false;
+  }
+  *children = it->second;
+  return true;
+}
@@ -2,7 +2,9 @@
 #define SOTA_CLIENT_TOOLS_OSTREE_REPO_H_
 
 #include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -29,6 +31,20 @@ class OSTreeRepo {
   OSTreeObject::ptr GetObject(OSTreeHash hash, OstreeObjectType type) const;
   OSTreeObject::ptr GetObject(const uint8_t sha256[32], OstreeObjectType type) const;
 
+  /* Path where an object is (or would be) stored in this repository. */
+  boost::filesystem::path ObjectPath(const OSTreeHash& hash, OstreeObjectType type) const;
+  /* The same, relative to the repository root ("objects/ab/cdef...dirtree"). */
+  static boost::filesystem::path ObjectRelativePath(const OSTreeHash& hash, OstreeObjectType type);
+
+  /* Whether an object is completely available on disk, so that it can be
+   * parsed ahead of time. Thread-safe. */
+  virtual bool HasCompleteObject(const OSTreeHash& hash, OstreeObjectType type) const;
+
+  /* Children of commit and dirtree objects that have been parsed ahead of
+   * time, for instance by an ObjectGraphWalker. These are thread-safe. */
+  void CacheChildren(const OSTreeHash& hash, std::vector<OSTreeChildRef> children) const;
+  bool CachedChildren(const OSTreeHash& hash, std::vector<OSTreeChildRef>* children) const;
+
  protected:
   virtual bool FetchObject(const boost::filesystem::path& path) const = 0;
 
@@ -36,6 +52,10 @@ class OSTreeRepo {
 
   typedef std::map<OSTreeHash, OSTreeObject::ptr> otable;
   mutable otable ObjectTable;  // Makes sure that the same commit object is not added twice
+
+ private:
+  mutable std::mutex children_cache_mutex_;
+  mutable std::map<OSTreeHash, std::vector<OSTreeChildRef>> children_cache_;
 };
 
 /**
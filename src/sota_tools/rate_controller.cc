@@ -1,7 +1,9 @@
 #include "rate_controller.h"
 
-#include <algorithm>  // min
+#include <algorithm>  // min, nth_element
 #include <cassert>
+#include <iomanip>
+#include <sstream>
 
 #include "logging/logging.h"
 
@@ -9,10 +11,48 @@ const RateController::clock::duration RateController::kMaxSleepTime = std::chron
 
 const RateController::clock::duration RateController::kInitialSleepTime = std::chrono::seconds(1);
 
+const size_t RateController::kLatencySamples = 1000;
+
+const RateController::clock::duration RateController::kGoodputWindow = std::chrono::seconds(2);
+
+const double RateController::kGoodputTolerance = 0.1;
+
+namespace {
+double Seconds(const RateController::clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+long Milliseconds(const RateController::clock::duration d) {  // NOLINT(google-runtime-int)
+  return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(d).count());  // NOLINT
+}
+}  // namespace
+
 RateController::RateController(const int concurrency_cap) : concurrency_cap_(concurrency_cap) { CheckInvariants(); }
 
 void RateController::RequestCompleted(const clock::time_point start_time, const clock::time_point end_time,
-                                      const bool succeeded) {
+                                      const bool succeeded, const uint64_t bytes, const std::string &endpoint) {
+  EndpointData &data = endpoints_[endpoint];
+  if (data.requests > 0 && start_time - data.last_end > kGoodputWindow) {
+    // The endpoint was idle for a while, the old measurement says nothing
+    // about the current conditions.
+    data.goodput_window_start = clock::time_point();
+    data.last_goodput = 0.0;
+  }
+  if (data.requests == 0 || start_time < data.first_start) {
+    data.first_start = start_time;
+  }
+  data.last_end = std::max(data.last_end, end_time);
+  ++data.requests;
+  if (succeeded) {
+    data.bytes += bytes;
+  } else {
+    ++data.failures;
+  }
+  if (data.latencies.size() < kLatencySamples) {
+    data.latencies.push_back(end_time - start_time);
+  } else {
+    data.latencies[data.next_latency] = end_time - start_time;
+  }
+  data.next_latency = (data.next_latency + 1) % kLatencySamples;
+
   if (last_concurrency_update_ < start_time) {
     const int prev_concurrency = max_concurrency_;
     last_concurrency_update_ = end_time;
@@ -30,9 +70,50 @@ void RateController::RequestCompleted(const clock::time_point start_time, const
       LOG_DEBUG << "Concurrency limit is now: " << max_concurrency_;
     }
   }
+  if (succeeded) {
+    UpdateGoodput(data, end_time, bytes);
+  }
   CheckInvariants();
 }
 
+void RateController::UpdateGoodput(EndpointData &data, const clock::time_point end_time, const uint64_t bytes) {
+  if (data.goodput_window_start == clock::time_point()) {
+    data.goodput_window_start = end_time;
+    data.goodput_window_concurrency = max_concurrency_;
+    return;
+  }
+  data.goodput_window_bytes += bytes;
+  const clock::duration elapsed = end_time - data.goodput_window_start;
+  if (elapsed < kGoodputWindow) {
+    return;
+  }
+
+  const double goodput = static_cast<double>(data.goodput_window_bytes) / Seconds(elapsed);
+  // Multiplicative decrease: more parallel requests made things worse, so go
+  // back towards the concurrency that gave the better goodput.
+  if (data.goodput_window_bytes > 0 && data.last_goodput > 0.0 &&
+      data.goodput_window_concurrency > data.last_goodput_concurrency &&
+      goodput < data.last_goodput * (1.0 - kGoodputTolerance) && sleep_time_ == clock::duration(0)) {
+    const int reduced = std::max(std::max(data.last_goodput_concurrency, max_concurrency_ / 2), 1);
+    if (reduced < max_concurrency_) {
+      LOG_DEBUG << "Goodput dropped from " << static_cast<uint64_t>(data.last_goodput) << " to "
+                << static_cast<uint64_t>(goodput) << " bytes/s, concurrency limit is now: " << reduced;
+      max_concurrency_ = reduced;
+      last_concurrency_update_ = end_time;
+    }
+  }
+  data.last_goodput = goodput;
+  data.last_goodput_concurrency = data.goodput_window_concurrency;
+  data.goodput_window_start = end_time;
+  data.goodput_window_bytes = 0;
+  data.goodput_window_concurrency = max_concurrency_;
+}
+
+double RateController::Goodput(const std::string &endpoint) const {
+  auto it = endpoints_.find(endpoint);
+  return it == endpoints_.end() ? 0.0 : it->second.last_goodput;
+}
+
 int RateController::MaxConcurrency() const {
   CheckInvariants();
   return max_concurrency_;
@@ -48,6 +129,45 @@ bool RateController::ServerHasFailed() const {
   return sleep_time_ > kMaxSleepTime;
 }
 
+RateController::EndpointStats RateController::GetEndpointStats(const std::string &endpoint) const {
+  EndpointStats stats;
+  auto it = endpoints_.find(endpoint);
+  if (it == endpoints_.end()) {
+    return stats;
+  }
+  const EndpointData &data = it->second;
+  stats.requests = data.requests;
+  stats.failures = data.failures;
+  stats.bytes = data.bytes;
+  const double elapsed = Seconds(data.last_end - data.first_start);
+  if (elapsed > 0.0) {
+    stats.bytes_per_second = static_cast<double>(data.bytes) / elapsed;
+  }
+  if (!data.latencies.empty()) {
+    std::vector<clock::duration> latencies = data.latencies;
+    auto percentile = [&latencies](const size_t p) {
+      auto nth = latencies.begin() + static_cast<std::ptrdiff_t>((latencies.size() - 1) * p / 100);
+      std::nth_element(latencies.begin(), nth, latencies.end());
+      return *nth;
+    };
+    stats.latency_p50 = percentile(50);
+    stats.latency_p99 = percentile(99);
+  }
+  return stats;
+}
+
+std::string RateController::Summary() const {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1) << "concurrency " << max_concurrency_;
+  for (const auto &entry : endpoints_) {
+    const EndpointStats stats = GetEndpointStats(entry.first);
+    out << "; " << (entry.first.empty() ? "requests" : entry.first) << ": " << stats.requests << " ("
+        << stats.failures << " failed), " << stats.bytes_per_second / 1024.0 << " KiB/s, p50 "
+        << Milliseconds(stats.latency_p50) << " ms, p99 " << Milliseconds(stats.latency_p99) << " ms";
+  }
+  return out.str();
+}
+
 void RateController::CheckInvariants() const {
   assert((sleep_time_ == clock::duration(0)) || (max_concurrency_ == 1));
   assert(0 < max_concurrency_);
@@ -2,6 +2,10 @@
 #define SOTA_CLIENT_TOOLS_RATE_CONTROLLER_H_
 
 #include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
 
 /**
  * Control the rate of outgoing requests.
@@ -12,15 +16,38 @@
  *    Failed() - A boolean indicating that the server is broken, and to report an error up to the user.
  * The congestion control is loosely based on the original TCP AIMD scheme. Better performance might be available by
  * Stealing ideas from the later TCP conjection control algorithms
+ *
+ * Besides success/failure, the controller watches goodput (successfully
+ * transferred bytes per second) per endpoint: if raising the concurrency made
+ * the goodput of an endpoint drop noticeably, the concurrency is cut back
+ * again, as the server or the link is saturated. Endpoints are measured
+ * separately so that moving from small queries to large uploads, or back, is
+ * not mistaken for a collapse. It also keeps per-endpoint statistics (request
+ * count, bytes, throughput and latency percentiles) for reporting.
  */
 class RateController {
  public:
   using clock = std::chrono::steady_clock;
-  explicit RateController(int concurrency_cap = 30);
+  explicit RateController(int concurrency_cap = 400);
   RateController(const RateController&) = delete;
   RateController operator=(const RateController&) = delete;
 
-  void RequestCompleted(clock::time_point start_time, clock::time_point end_time, bool succeeded);
+  struct EndpointStats {
+    uint64_t requests{0};
+    uint64_t failures{0};
+    uint64_t bytes{0};
+    double bytes_per_second{0.0};
+    clock::duration latency_p50{0};
+    clock::duration latency_p99{0};
+  };
+
+  /**
+   * Report a finished request. bytes is the amount of data transferred in
+   * both directions and endpoint an arbitrary label ("query", "upload", ...)
+   * that the statistics are grouped by.
+   */
+  void RequestCompleted(clock::time_point start_time, clock::time_point end_time, bool succeeded,
+                        uint64_t bytes = 0, const std::string& endpoint = "");
 
   int MaxConcurrency() const;
 
@@ -28,7 +55,49 @@ class RateController {
 
   bool ServerHasFailed() const;
 
+  /* Goodput (bytes per second) of endpoint measured over its last complete
+   * window, or 0. */
+  double Goodput(const std::string& endpoint = "") const;
+
+  EndpointStats GetEndpointStats(const std::string& endpoint) const;
+
+  /* One-line summary of the current state and per-endpoint statistics. */
+  std::string Summary() const;
+
  private:
+  struct EndpointData {
+    uint64_t requests{0};
+    uint64_t failures{0};
+    uint64_t bytes{0};
+    clock::time_point first_start;
+    clock::time_point last_end;
+    // Ring buffer of the latest request latencies.
+    std::vector<clock::duration> latencies;
+    size_t next_latency{0};
+    // Goodput measurement.
+    clock::time_point goodput_window_start;
+    uint64_t goodput_window_bytes{0};
+    int goodput_window_concurrency{1};
+    double last_goodput{0.0};
+    int last_goodput_concurrency{0};
+  };
+
+  /**
+   * Number of latency samples kept per endpoint to compute percentiles.
+   */
+  static const size_t kLatencySamples;
+
+  /**
+   * Goodput is measured over windows of (at least) this length.
+   */
+  static const clock::duration kGoodputWindow;
+
+  /**
+   * A drop in goodput larger than this fraction after increasing the
+   * concurrency is taken as a sign of congestion.
+   */
+  static const double kGoodputTolerance;
+
   /**
    * After sleeping this long and still getting a 500 error, assume the
    * server has failed permanently
@@ -52,6 +121,9 @@ class RateController {
   int max_concurrency_{1};
   clock::duration sleep_time_{0};
 
+  std::map<std::string, EndpointData> endpoints_;
+
+  void UpdateGoodput(EndpointData& data, clock::time_point end_time, uint64_t bytes);
   void CheckInvariants() const;
 };
 
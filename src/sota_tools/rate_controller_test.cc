@@ -48,6 +48,77 @@ TEST(control, good_results_improve_concurrency) {
   EXPECT_GT(dut.MaxConcurrency(), initial_concurrency);
 }
 
+/* Rate controller backs off when more concurrency makes goodput worse. */
+TEST(control, goodput_drop_reduces_concurrency) {
+  RateController dut;
+  RateController::clock::time_point t = RateController::clock::now();
+  const RateController::clock::duration interval = std::chrono::milliseconds(100);
+  const RateController::clock::duration gap = std::chrono::milliseconds(1);
+  // Steady goodput while the concurrency grows...
+  for (int i = 0; i < 100; i++) {
+    dut.RequestCompleted(t, t + interval, true, 1000000);
+    t += interval + gap;
+  }
+  EXPECT_GT(dut.Goodput(), 0.0);
+  // ...then much less data gets through.
+  bool reduced = false;
+  for (int i = 0; i < 100; i++) {
+    const int prev_concurrency = dut.MaxConcurrency();
+    dut.RequestCompleted(t, t + interval, true, 1000);
+    t += interval + gap;
+    reduced = reduced || dut.MaxConcurrency() < prev_concurrency;
+  }
+  EXPECT_TRUE(reduced);
+  EXPECT_FALSE(dut.ServerHasFailed());
+}
+
+/* Moving from large uploads to small queries is not taken as a goodput drop:
+ * goodput is measured per endpoint. */
+TEST(control, goodput_per_endpoint) {
+  RateController dut;
+  RateController::clock::time_point t = RateController::clock::now();
+  const RateController::clock::duration interval = std::chrono::milliseconds(100);
+  const RateController::clock::duration gap = std::chrono::milliseconds(1);
+  for (int i = 0; i < 100; i++) {
+    dut.RequestCompleted(t, t + interval, true, 1000000, "upload");
+    t += interval + gap;
+  }
+  EXPECT_GT(dut.Goodput("upload"), 0.0);
+  bool reduced = false;
+  for (int i = 0; i < 100; i++) {
+    const int prev_concurrency = dut.MaxConcurrency();
+    dut.RequestCompleted(t, t + interval, true, 1000, "query");
+    t += interval + gap;
+    reduced = reduced || dut.MaxConcurrency() < prev_concurrency;
+  }
+  EXPECT_FALSE(reduced);
+  EXPECT_GT(dut.Goodput("query"), 0.0);
+  EXPECT_LT(dut.Goodput("query"), dut.Goodput("upload"));
+}
+
+/* Per-endpoint statistics track requests, bytes and latency percentiles. */
+TEST(stats, endpoint_stats) {
+  RateController dut;
+  RateController::clock::time_point t = RateController::clock::now();
+  for (int i = 1; i <= 100; i++) {
+    dut.RequestCompleted(t, t + std::chrono::milliseconds(i), i != 50, 100, "upload");
+    t += std::chrono::milliseconds(i);
+  }
+  dut.RequestCompleted(t, t + std::chrono::seconds(1), true, 0, "query");
+
+  const RateController::EndpointStats upload = dut.GetEndpointStats("upload");
+  EXPECT_EQ(upload.requests, 100);
+  EXPECT_EQ(upload.failures, 1);
+  EXPECT_EQ(upload.bytes, 99 * 100);
+  EXPECT_GT(upload.bytes_per_second, 0.0);
+  EXPECT_EQ(upload.latency_p50, std::chrono::milliseconds(50));
+  EXPECT_EQ(upload.latency_p99, std::chrono::milliseconds(99));
+
+  EXPECT_EQ(dut.GetEndpointStats("query").requests, 1);
+  EXPECT_EQ(dut.GetEndpointStats("unknown").requests, 0);
+  EXPECT_NE(dut.Summary().find("upload: 100 (1 failed)"), std::string::npos);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
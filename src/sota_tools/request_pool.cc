@@ -6,9 +6,31 @@
 #include <thread>
 
 #include "logging/logging.h"
+#include "utilities/utils.h"
 
-RequestPool::RequestPool(TreehubServer& server, const int max_curl_requests, const RunMode mode)
-    : rate_controller_(max_curl_requests), running_requests_(0), server_(server), mode_(mode), stopped_(false) {
+const size_t RequestPool::kMaxBatchQuerySize = 1000;
+
+const long RequestPool::kMaxWaitMs = 3000;  // NOLINT(google-runtime-int)
+
+const uintmax_t RequestPool::kMaxBundledObjectSize = 64 * 1024;
+
+const size_t RequestPool::kMaxUploadBundleSize = 256;
+
+const uintmax_t RequestPool::kMaxUploadBundleBytes = 1024 * 1024;
+
+const long RequestPool::kBundlePollMs = 10;  // NOLINT(google-runtime-int)
+
+const std::chrono::seconds RequestPool::kStatsLogInterval{10};
+
+RequestPool::RequestPool(TreehubServer& server, const int max_curl_requests, const RunMode mode,
+                         ServerObjectCache* object_cache)
+    : rate_controller_(max_curl_requests),
+      running_requests_(0),
+      server_(server),
+      mode_(mode),
+      object_cache_(object_cache),
+      stopped_(false),
+      last_stats_log_(std::chrono::steady_clock::now()) {
   curl_global_init(CURL_GLOBAL_DEFAULT);
   multi_ = curl_multi_init();
   curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_HTTP1 | CURLPIPE_MULTIPLEX);
@@ -23,6 +45,9 @@ RequestPool::~RequestPool() {
       LoopListen();
     }
     LOG_INFO << "...done";
+    if (total_requests_made_ > 0) {
+      LOG_INFO << "Request statistics: " << rate_controller_.Summary();
+    }
 
     curl_multi_cleanup(multi_);
     curl_global_cleanup();
@@ -40,21 +65,80 @@ void RequestPool::AddQuery(const OSTreeObject::ptr& request) {
   }
 }
 
+void RequestPool::AddRequest(std::unique_ptr<PoolRequest> request) {
+  if (!stopped_) {
+    request_queue_.push_back(std::move(request));
+  }
+}
+
+void RequestPool::AddSpeculativeQuery(const OSTreeObject::ptr& request) {
+  if (!stopped_ && batch_queries_ && request->is_on_server() == PresenceOnServer::kObjectStateUnknown) {
+    speculative_query_queue_.push_back(request);
+  }
+}
+
+void RequestPool::QueueSpeculativeQueries() {
+  size_t queued = 0;
+  while (!speculative_query_queue_.empty() && queued < kMaxBatchQuerySize) {
+    OSTreeObject::ptr object = speculative_query_queue_.front();
+    speculative_query_queue_.pop_front();
+    // The regular walk may have got to it in the meantime.
+    if (object->is_on_server() != PresenceOnServer::kObjectStateUnknown) {
+      continue;
+    }
+    if (IsKnownOnServer(*object)) {
+      object->LaunchNotify();
+      object->PresenceCheckDone(*this, 200);
+    } else {
+      AddQuery(object);
+      ++queued;
+    }
+  }
+}
+
 void RequestPool::AddUpload(const OSTreeObject::ptr& request) {
   request->LaunchNotify();
   if (!stopped_) {
-    upload_queue_.push_back(request);
+    // Bundles only make sense when we are actually uploading.
+    const bool uploading = mode_ == RunMode::kDefault || mode_ == RunMode::kPushTree;
+    if (upload_bundles_ && uploading && boost::filesystem::file_size(request->file_path()) <= kMaxBundledObjectSize) {
+      small_upload_queue_.push_back(request);
+    } else {
+      upload_queue_.push_back(request);
+    }
   }
 }
 
+void RequestPool::DisableUploadBundles() {
+  upload_bundles_ = false;
+  upload_queue_.splice(upload_queue_.end(), small_upload_queue_);
+}
+
 void RequestPool::LoopLaunch() {
-  while (running_requests_ < rate_controller_.MaxConcurrency() && (!query_queue_.empty() || !upload_queue_.empty())) {
+  if (batch_queries_ && query_queue_.empty() && batch_queries_in_flight_.empty()) {
+    QueueSpeculativeQueries();
+  }
+  while (running_requests_ + static_cast<int>(bundles_preparing_.size()) < rate_controller_.MaxConcurrency() &&
+         (!request_queue_.empty() || !query_queue_.empty() || !upload_queue_.empty() ||
+          !small_upload_queue_.empty())) {
     OSTreeObject::ptr cur;
 
-    // Queries first, uploads second
-    if (query_queue_.empty()) {
-      cur = upload_queue_.front();
-      upload_queue_.pop_front();
+    // Other requests first, then queries, then uploads
+    if (!request_queue_.empty()) {
+      std::unique_ptr<PoolRequest> request = std::move(request_queue_.front());
+      request_queue_.pop_front();
+      CURL* handle = request->MakeRequest(server_, multi_);
+      requests_in_flight_[handle] = RunningRequest{std::move(request), std::chrono::steady_clock::now()};
+      total_requests_made_++;
+    } else if (query_queue_.empty() && small_upload_queue_.size() > 1) {
+      // Counted as running from StartPreparedBundles() on.
+      LaunchUploadBundle();
+      total_requests_made_++;
+      continue;
+    } else if (query_queue_.empty()) {
+      std::list<OSTreeObject::ptr>& queue = upload_queue_.empty() ? small_upload_queue_ : upload_queue_;
+      cur = queue.front();
+      queue.pop_front();
       cur->Upload(server_, multi_, mode_);
       total_requests_made_++;
       if (mode_ == RunMode::kDryRun || mode_ == RunMode::kWalkTree) {
@@ -62,6 +146,9 @@ void RequestPool::LoopLaunch() {
         // acknowledge that the object has been uploaded.
         cur->NotifyParents(*this);
       }
+    } else if (batch_queries_ && query_queue_.size() > 1) {
+      LaunchBatchQuery();
+      total_requests_made_++;
     } else {
       cur = query_queue_.front();
       query_queue_.pop_front();
@@ -73,17 +160,71 @@ void RequestPool::LoopLaunch() {
   }
 }
 
+void RequestPool::LaunchBatchQuery() {
+  std::vector<OSTreeObject::ptr> objects;
+  while (!query_queue_.empty() && objects.size() < kMaxBatchQuerySize) {
+    objects.push_back(query_queue_.front());
+    query_queue_.pop_front();
+  }
+  std::unique_ptr<BatchQuery> batch = std_::make_unique<BatchQuery>(std::move(objects));
+  batch->MakeRequest(server_, multi_);
+  CURL* handle = batch->curl_handle();
+  batch_queries_in_flight_[handle] = std::move(batch);
+}
+
+void RequestPool::LaunchUploadBundle() {
+  std::vector<OSTreeObject::ptr> objects;
+  uintmax_t bytes = 0;
+  while (!small_upload_queue_.empty() && objects.size() < kMaxUploadBundleSize) {
+    const uintmax_t size = boost::filesystem::file_size(small_upload_queue_.front()->file_path());
+    if (!objects.empty() && bytes + size > kMaxUploadBundleBytes) {
+      break;
+    }
+    bytes += size;
+    objects.push_back(small_upload_queue_.front());
+    small_upload_queue_.pop_front();
+  }
+  std::unique_ptr<UploadBundle> bundle = std_::make_unique<UploadBundle>(std::move(objects));
+  UploadBundle* to_prepare = bundle.get();
+  std::future<void> prepared = std::async(std::launch::async, [to_prepare] { to_prepare->Prepare(); });
+  bundles_preparing_.push_back(PreparingBundle{std::move(bundle), std::move(prepared)});
+}
+
+void RequestPool::StartPreparedBundles() {
+  for (auto it = bundles_preparing_.begin(); it != bundles_preparing_.end();) {
+    if (it->prepared.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+    std::unique_ptr<UploadBundle> bundle = std::move(it->bundle);
+    std::future<void> prepared = std::move(it->prepared);
+    it = bundles_preparing_.erase(it);
+    prepared.get();  // Rethrows whatever went wrong while packing.
+    if (stopped_) {
+      continue;
+    }
+    bundle->MakeRequest(server_, multi_);
+    running_requests_++;
+    CURL* handle = bundle->curl_handle();
+    upload_bundles_in_flight_[handle] = std::move(bundle);
+  }
+}
+
 void RequestPool::LoopListen() {
   // For more information about the timeout logic, read these:
   // https://curl.haxx.se/libcurl/c/curl_multi_timeout.html
-  // https://curl.haxx.se/libcurl/c/curl_multi_fdset.html
+  // https://curl.haxx.se/libcurl/c/curl_multi_wait.html
+  // curl_multi_wait() uses poll() internally, so unlike select() it is not
+  // limited to FD_SETSIZE descriptors and does not have to rebuild and scan
+  // fd sets for every transfer on each iteration.
+  StartPreparedBundles();
+  if (running_requests_ == 0 && !bundles_preparing_.empty()) {
+    // Nothing for curl to do until a bundle has been packed.
+    bundles_preparing_.front().prepared.wait_for(std::chrono::milliseconds(kMaxWaitMs));
+    StartPreparedBundles();
+  }
+
   CURLMcode mc;
-  // Poll for IO
-  fd_set fdread, fdwrite, fdexcept;
-  int maxfd = 0;
-  FD_ZERO(&fdread);
-  FD_ZERO(&fdwrite);
-  FD_ZERO(&fdexcept);
   long timeoutms = 0;  // NOLINT(google-runtime-int)
   mc = curl_multi_timeout(multi_, &timeoutms);
   if (mc != CURLM_OK) {
@@ -92,34 +233,26 @@ void RequestPool::LoopListen() {
   // If timeoutms is 0, "it means you should proceed immediately without waiting
   // for anything".
   if (timeoutms != 0) {
-    mc = curl_multi_fdset(multi_, &fdread, &fdwrite, &fdexcept, &maxfd);
+    // "Wait for activities no longer than the set timeout." If curl has no
+    // timeout set, "You must not wait too long (more than a few seconds
+    // perhaps)".
+    const long max_wait_ms = bundles_preparing_.empty() ? kMaxWaitMs : kBundlePollMs;  // NOLINT(google-runtime-int)
+    const int wait_ms = static_cast<int>(timeoutms == -1 ? max_wait_ms : std::min(timeoutms, max_wait_ms));
+    int numfds = 0;
+    const auto wait_start = std::chrono::steady_clock::now();
+    mc = curl_multi_wait(multi_, nullptr, 0, wait_ms, &numfds);
     if (mc != CURLM_OK) {
-      throw std::runtime_error("curl_multi_fdset failed with error");
+      throw std::runtime_error(std::string("curl_multi_wait failed with error: ") + curl_multi_strerror(mc));
     }
-
-    struct timeval timeout {};
-    if (maxfd != -1) {
-      // "Wait for activities no longer than the set timeout."
-      if (timeoutms == -1) {
-        // "You must not wait too long (more than a few seconds perhaps)".
-        timeout.tv_sec = 3;
-        timeout.tv_usec = 0;
-      } else {
-        timeout.tv_sec = timeoutms / 1000;
-        timeout.tv_usec = 1000 * (timeoutms % 1000);
-      }
-      if (select(maxfd + 1, &fdread, &fdwrite, &fdexcept, &timeout) < 0) {
-        throw std::runtime_error(std::string("select failed with error: ") + std::strerror(errno));
-      }
-    } else if (timeoutms > 0) {
-      // If maxfd == -1, then wait the lesser of timeoutms and 100 ms.
+    // numfds is also 0 when the wait timed out. It only returns at once with
+    // no activity when curl has no descriptors to wait on, in which case wait
+    // the lesser of timeoutms and 100 ms.
+    const bool no_descriptors = numfds == 0 && std::chrono::steady_clock::now() - wait_start <
+                                                   std::chrono::milliseconds(wait_ms);
+    if (no_descriptors && timeoutms > 0) {
       long nofd_timeoutms = std::min(timeoutms, static_cast<long>(100));  // NOLINT(google-runtime-int)
       LOG_DEBUG << "Waiting " << nofd_timeoutms << " ms for curl";
-      timeout.tv_sec = 0;
-      timeout.tv_usec = 1000 * (nofd_timeoutms % 1000);
-      if (select(0, nullptr, nullptr, nullptr, &timeout) < 0) {
-        throw std::runtime_error(std::string("select failed with error: ") + std::strerror(errno));
-      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(nofd_timeoutms));
     }
   }
 
@@ -135,12 +268,46 @@ void RequestPool::LoopListen() {
   do {
     CURLMsg* msg = curl_multi_info_read(multi_, &msgs_in_queue);
     if ((msg != nullptr) && msg->msg == CURLMSG_DONE) {
-      OSTreeObject::ptr h = ostree_object_from_curl(msg->easy_handle);
-      h->CurlDone(multi_, *this);
-      const bool server_responded_ok = h->LastOperationResult() == ServerResponse::kOk;
-      const RateController::clock::time_point start_time = h->RequestStartTime();
+      bool server_responded_ok;
+      RateController::clock::time_point start_time;
+      std::string endpoint;
+      // Query the transfer sizes now, CurlDone() releases the handle.
+      curl_off_t uploaded = 0;
+      curl_off_t downloaded = 0;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+      const auto bytes = static_cast<uint64_t>(std::max<curl_off_t>(uploaded, 0) + std::max<curl_off_t>(downloaded, 0));
+      auto request_it = requests_in_flight_.find(msg->easy_handle);
+      auto batch_it = batch_queries_in_flight_.find(msg->easy_handle);
+      if (request_it != requests_in_flight_.end()) {
+        RunningRequest running = std::move(request_it->second);
+        requests_in_flight_.erase(request_it);
+        endpoint = running.request->endpoint();
+        server_responded_ok = running.request->CurlDone(multi_, msg->data.result, *this);
+        start_time = running.start_time;
+      } else if (batch_it != batch_queries_in_flight_.end()) {
+        std::unique_ptr<BatchQuery> batch = std::move(batch_it->second);
+        batch_queries_in_flight_.erase(batch_it);
+        endpoint = "batch query";
+        batch->CurlDone(multi_, *this);
+        server_responded_ok = batch->LastOperationResult() == ServerResponse::kOk;
+        start_time = batch->RequestStartTime();
+      } else if (upload_bundles_in_flight_.count(msg->easy_handle) != 0U) {
+        std::unique_ptr<UploadBundle> bundle = std::move(upload_bundles_in_flight_[msg->easy_handle]);
+        upload_bundles_in_flight_.erase(msg->easy_handle);
+        endpoint = "bundle upload";
+        bundle->CurlDone(multi_, *this);
+        server_responded_ok = bundle->LastOperationResult() == ServerResponse::kOk;
+        start_time = bundle->RequestStartTime();
+      } else {
+        OSTreeObject::ptr h = ostree_object_from_curl(msg->easy_handle);
+        endpoint = (h->operation() == CurrentOp::kOstreeObjectUploading) ? "upload" : "query";
+        h->CurlDone(multi_, *this);
+        server_responded_ok = h->LastOperationResult() == ServerResponse::kOk;
+        start_time = h->RequestStartTime();
+      }
       const RateController::clock::time_point end_time = RateController::clock::now();
-      rate_controller_.RequestCompleted(start_time, end_time, server_responded_ok);
+      rate_controller_.RequestCompleted(start_time, end_time, server_responded_ok, bytes, endpoint);
       if (rate_controller_.ServerHasFailed()) {
         Abort();
       } else {
@@ -153,6 +320,12 @@ void RequestPool::LoopListen() {
       }
     }
   } while (msgs_in_queue > 0);
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - last_stats_log_ >= kStatsLogInterval) {
+    last_stats_log_ = now;
+    LOG_INFO << "Request statistics: " << rate_controller_.Summary();
+  }
 }
 
 void RequestPool::Loop() {
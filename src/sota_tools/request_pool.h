@@ -1,26 +1,98 @@
 #ifndef SOTA_CLIENT_TOOLS_REQUEST_POOL_H_
 #define SOTA_CLIENT_TOOLS_REQUEST_POOL_H_
 
+#include <chrono>
+#include <future>
 #include <list>
+#include <map>
+#include <memory>
 
 #include <curl/curl.h>
 
+#include "batch_query.h"
 #include "garage_common.h"
 #include "ostree_object.h"
 #include "rate_controller.h"
+#include "server_object_cache.h"
+#include "upload_bundle.h"
+
+class RequestPool;
+
+/**
+ * A request of a kind that RequestPool does not know about, sent through the
+ * pool so that it shares its connections and its rate control.
+ */
+class PoolRequest {
+ public:
+  PoolRequest() = default;
+  PoolRequest(const PoolRequest&) = delete;
+  PoolRequest& operator=(const PoolRequest&) = delete;
+  virtual ~PoolRequest() = default;
+
+  /* Add the request to curl_multi_handle and return its curl handle. */
+  virtual CURL* MakeRequest(TreehubServer& server, CURLM* curl_multi_handle) = 0;
+
+  /* Process the completed transfer, which may add more requests to the pool.
+   * Returns false if the server did not respond properly, which counts
+   * against it in the RateController. */
+  virtual bool CurlDone(CURLM* curl_multi_handle, CURLcode result, RequestPool& pool) = 0;
+
+  /* Label for the request statistics ("download", "query", ...). */
+  virtual const char* endpoint() const = 0;
+};
 
 class RequestPool {
  public:
-  RequestPool(TreehubServer& server, int max_curl_requests, RunMode mode);
+  RequestPool(TreehubServer& server, int max_curl_requests, RunMode mode,
+              ServerObjectCache* object_cache = nullptr);
   ~RequestPool();
   void AddQuery(const OSTreeObject::ptr& request);
   void AddUpload(const OSTreeObject::ptr& request);
+  /* Query an object found ahead of the regular walk, for instance by an
+   * ObjectGraphWalker. These are only sent in batches, one batch at a time,
+   * when no other query is waiting. */
+  void AddSpeculativeQuery(const OSTreeObject::ptr& request);
+  /* Send a request of another kind. These go before queries and uploads. */
+  void AddRequest(std::unique_ptr<PoolRequest> request);
   void Abort() {
     stopped_ = true;
+    request_queue_.clear();
     query_queue_.clear();
+    speculative_query_queue_.clear();
     upload_queue_.clear();
+    small_upload_queue_.clear();
   };
-  bool is_idle() const { return query_queue_.empty() && upload_queue_.empty() && running_requests_ == 0; }
+  /* Stop sending batched presence checks, after the server told us that it
+   * does not support them. */
+  void DisableBatchQueries() {
+    batch_queries_ = false;
+    // Not worth a request per object, the regular walk gets to them anyway.
+    speculative_query_queue_.clear();
+  }
+  /* Stop bundling small objects into one upload, after the server told us
+   * that it does not support it. */
+  void DisableUploadBundles();
+  /* Whether the object cache says that the object is already on the server,
+   * so that it does not need to be queried. */
+  bool IsKnownOnServer(const OSTreeObject& object) const {
+    return object_cache_ != nullptr && object_cache_->IsKnown(object.hash());
+  }
+  /* The server has confirmed that the object is present. */
+  void MarkPresentOnServer(const OSTreeObject& object) {
+    if (object_cache_ != nullptr) {
+      object_cache_->MarkPresent(object.hash());
+    }
+  }
+  /* The server has reported that the object is missing. */
+  void MarkMissingOnServer(const OSTreeObject& object) {
+    if (object_cache_ != nullptr) {
+      object_cache_->MarkMissing(object.hash());
+    }
+  }
+  bool is_idle() const {
+    return request_queue_.empty() && query_queue_.empty() && upload_queue_.empty() && small_upload_queue_.empty() &&
+           running_requests_ == 0 && bundles_preparing_.empty();
+  }
   bool is_stopped() const { return stopped_; }
   RunMode run_mode() const { return mode_; }
 
@@ -30,24 +102,87 @@ class RequestPool {
    */
   void Loop();
   /**
-   * The number of HEAD + PUT requests that have been sent to curl. This
-   * includes requests that eventually returned 500 and get retried.
+   * The number of HEAD + PUT requests (and batched queries and uploads) that
+   * have been sent to curl. This includes requests that eventually returned 500 and get
+   * retried.
    */
   int total_requests_made() { return total_requests_made_; }
 
  private:
   void LoopLaunch();  // launches multiple requests from the queues
   void LoopListen();  // listens to the result of launched requests
+  void LaunchBatchQuery();
+  void LaunchUploadBundle();
+  void StartPreparedBundles();  // sends the bundles that have been packed
+  void QueueSpeculativeQueries();
+
+  /**
+   * Maximum number of objects checked in a single batched presence query.
+   */
+  static const size_t kMaxBatchQuerySize;
+
+  /**
+   * Upper bound on how long to wait for network activity in one iteration.
+   */
+  static const long kMaxWaitMs;  // NOLINT(google-runtime-int)
+
+  /**
+   * Objects up to this size (in bytes) are uploaded in bundles; larger ones
+   * get a request of their own.
+   */
+  static const uintmax_t kMaxBundledObjectSize;
+
+  /**
+   * Maximum number of objects uploaded in a single bundle.
+   */
+  static const size_t kMaxUploadBundleSize;
+
+  /**
+   * Maximum total size (in bytes) of the objects in a single bundle.
+   */
+  static const uintmax_t kMaxUploadBundleBytes;
+
+  /**
+   * Upper bound on how long to wait for network activity while bundles are
+   * being packed, so that they are sent soon after they are ready.
+   */
+  static const long kBundlePollMs;  // NOLINT(google-runtime-int)
+
+  /**
+   * How often to log the request statistics while the pool is busy.
+   */
+  static const std::chrono::seconds kStatsLogInterval;
 
   RateController rate_controller_;
   int running_requests_;
   int total_requests_made_{0};
   TreehubServer& server_;
   CURLM* multi_;
+  std::list<std::unique_ptr<PoolRequest>> request_queue_;
+  struct RunningRequest {
+    std::unique_ptr<PoolRequest> request;
+    std::chrono::steady_clock::time_point start_time;
+  };
+  std::map<CURL*, RunningRequest> requests_in_flight_;
   std::list<OSTreeObject::ptr> query_queue_;
+  std::list<OSTreeObject::ptr> speculative_query_queue_;
   std::list<OSTreeObject::ptr> upload_queue_;
+  std::list<OSTreeObject::ptr> small_upload_queue_;  // objects to be uploaded in bundles
+  std::map<CURL*, std::unique_ptr<BatchQuery>> batch_queries_in_flight_;
+  std::map<CURL*, std::unique_ptr<UploadBundle>> upload_bundles_in_flight_;
+  struct PreparingBundle {
+    std::unique_ptr<UploadBundle> bundle;
+    std::future<void> prepared;
+  };
+  // Bundles being packed on threads of their own, as that would otherwise
+  // hold up all the other transfers.
+  std::list<PreparingBundle> bundles_preparing_;
+  bool batch_queries_{true};
+  bool upload_bundles_{true};
   RunMode mode_;
+  ServerObjectCache* object_cache_;
   bool stopped_;
+  std::chrono::steady_clock::time_point last_stats_log_;
 };
 // vim: set tabstop=2 shiftwidth=2 expandtab:
 #endif  // SOTA_CLIENT_TOOLS_REQUEST_POOL_H_
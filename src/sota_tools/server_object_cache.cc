@@ -0,0 +1,64 @@
+#include "server_object_cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "logging/logging.h"
+#include "utilities/utils.h"
+
+static const char *const kHeaderPrefix = "# garage-push object cache for ";
+
+ServerObjectCache::ServerObjectCache(boost::filesystem::path path, std::string server_url, const bool trusted)
+    : path_(std::move(path)), server_url_(std::move(server_url)), trusted_(trusted) {
+  Load();
+}
+
+bool ServerObjectCache::IsKnown(const OSTreeHash &hash) const { return trusted_ && known_.count(hash) != 0U; }
+
+void ServerObjectCache::MarkPresent(const OSTreeHash &hash) { known_.insert(hash); }
+
+void ServerObjectCache::MarkMissing(const OSTreeHash &hash) { known_.erase(hash); }
+
+void ServerObjectCache::Load() {
+  if (!boost::filesystem::exists(path_)) {
+    LOG_DEBUG << "Object cache " << path_ << " does not exist yet";
+    return;
+  }
+
+  std::ifstream stream(path_.string());
+  std::string line;
+  if (!std::getline(stream, line) || line != kHeaderPrefix + server_url_) {
+    LOG_WARNING << "Object cache " << path_ << " was recorded for a different server, ignoring it";
+    return;
+  }
+
+  while (std::getline(stream, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    try {
+      known_.insert(OSTreeHash::Parse(line));
+    } catch (const OSTreeCommitParseError &e) {
+      LOG_WARNING << "Ignoring invalid entry in object cache " << path_ << ": " << line;
+    }
+  }
+  if (trusted_) {
+    LOG_INFO << "Loaded " << known_.size() << " objects known on the server from " << path_;
+  } else {
+    LOG_INFO << "Loaded " << known_.size() << " objects from " << path_
+             << ", they will be revalidated against the server";
+  }
+}
+
+void ServerObjectCache::Save() const {
+  std::stringstream contents;
+  contents << kHeaderPrefix << server_url_ << "\n";
+  for (const OSTreeHash &hash : known_) {
+    contents << hash.string() << "\n";
+  }
+  Utils::writeFile(path_, contents.str());
+  LOG_DEBUG << "Saved " << known_.size() << " objects to object cache " << path_;
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,58 @@
+#ifndef SOTA_CLIENT_TOOLS_SERVER_OBJECT_CACHE_H_
+#define SOTA_CLIENT_TOOLS_SERVER_OBJECT_CACHE_H_
+
+#include <set>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "ostree_hash.h"
+
+/**
+ * A persistent index of the OSTree objects known to be present on a given
+ * Treehub server.
+ *
+ * The index is stored as a text file: a header line with the server URL,
+ * followed by the sorted hashes of the known objects, one per line. An index
+ * recorded for a different server is discarded on load.
+ *
+ * Objects are recorded whenever the server confirms their presence, either by
+ * a presence check or by a successful upload, and forgotten when the server
+ * reports them missing. Only a trusted cache is consulted before querying the
+ * server. An untrusted cache still keeps the entries on disk that nothing
+ * contradicted, since a run only asks about the objects it needs: entries are
+ * dropped only when the server reports them missing.
+ */
+class ServerObjectCache {
+ public:
+  ServerObjectCache(boost::filesystem::path path, std::string server_url, bool trusted);
+  ServerObjectCache(const ServerObjectCache&) = delete;
+  ServerObjectCache operator=(const ServerObjectCache&) = delete;
+
+  /* Whether the object can be assumed to be present on the server without
+   * asking it. Always false for an untrusted cache. */
+  bool IsKnown(const OSTreeHash& hash) const;
+
+  /* Record that the server has confirmed the presence of an object. */
+  void MarkPresent(const OSTreeHash& hash);
+
+  /* Record that the server has reported an object missing. */
+  void MarkMissing(const OSTreeHash& hash);
+
+  /* Write the index back to disk. */
+  void Save() const;
+
+  size_t size() const { return known_.size(); }
+  bool trusted() const { return trusted_; }
+
+ private:
+  void Load();
+
+  const boost::filesystem::path path_;
+  const std::string server_url_;
+  const bool trusted_;
+  std::set<OSTreeHash> known_;
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_SERVER_OBJECT_CACHE_H_
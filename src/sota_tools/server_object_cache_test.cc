@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include "server_object_cache.h"
+#include "utilities/utils.h"
+
+static const OSTreeHash hash_a =
+    OSTreeHash::Parse("16ef2f2629dc9263fdf3c0f032563a2d757623bbc11cf99df25c3c3f258dccbe");
+static const OSTreeHash hash_b =
+    OSTreeHash::Parse("b9ac1e45f9227df8ee191b6e51e09417bd36c6ebbeff999431e3073ac50f0563");
+
+/* A new cache starts empty and nothing is known. */
+TEST(ServerObjectCache, Empty) {
+  TemporaryDirectory temp_dir;
+  ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.IsKnown(hash_a));
+}
+
+/* Objects marked present are saved and loaded back for the same server. */
+TEST(ServerObjectCache, SaveAndLoad) {
+  TemporaryDirectory temp_dir;
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    cache.MarkPresent(hash_a);
+    EXPECT_TRUE(cache.IsKnown(hash_a));
+    EXPECT_FALSE(cache.IsKnown(hash_b));
+    cache.Save();
+  }
+  ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_TRUE(cache.IsKnown(hash_a));
+  EXPECT_FALSE(cache.IsKnown(hash_b));
+}
+
+/* An untrusted cache is never used to skip a query. It keeps the entries
+ * nothing contradicted and drops the ones the server reports missing. */
+TEST(ServerObjectCache, Untrusted) {
+  TemporaryDirectory temp_dir;
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    cache.MarkPresent(hash_a);
+    cache.Save();
+  }
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", false);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_FALSE(cache.IsKnown(hash_a));
+    cache.MarkPresent(hash_b);
+    EXPECT_FALSE(cache.IsKnown(hash_b));
+    cache.Save();
+  }
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_TRUE(cache.IsKnown(hash_a));
+    EXPECT_TRUE(cache.IsKnown(hash_b));
+  }
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", false);
+    cache.MarkMissing(hash_a);
+    cache.Save();
+  }
+  ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_FALSE(cache.IsKnown(hash_a));
+  EXPECT_TRUE(cache.IsKnown(hash_b));
+}
+
+/* An object the server no longer has is dropped from the cache. */
+TEST(ServerObjectCache, Stale) {
+  TemporaryDirectory temp_dir;
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    cache.MarkPresent(hash_a);
+    cache.MarkPresent(hash_b);
+    cache.Save();
+  }
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    cache.MarkMissing(hash_a);
+    EXPECT_FALSE(cache.IsKnown(hash_a));
+    cache.Save();
+  }
+  ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_FALSE(cache.IsKnown(hash_a));
+  EXPECT_TRUE(cache.IsKnown(hash_b));
+}
+
+/* A cache recorded for another server is ignored, as are corrupt entries. */
+TEST(ServerObjectCache, OtherServer) {
+  TemporaryDirectory temp_dir;
+  {
+    ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+    cache.MarkPresent(hash_a);
+    cache.Save();
+  }
+  ServerObjectCache other(temp_dir / "cache", "https://other.example.com/", true);
+  EXPECT_EQ(other.size(), 0);
+  EXPECT_FALSE(other.IsKnown(hash_a));
+
+  Utils::writeFile(temp_dir / "cache", std::string("# garage-push object cache for https://treehub.example.com/\n") +
+                                           "garbage\n" + hash_b.string() + "\n");
+  ServerObjectCache cache(temp_dir / "cache", "https://treehub.example.com/", true);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_TRUE(cache.IsKnown(hash_b));
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
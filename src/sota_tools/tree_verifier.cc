@@ -0,0 +1,418 @@
+#include "tree_verifier.h"
+
+#include <algorithm>
+#include <array>
+
+#include <glib.h>
+#include <boost/algorithm/string/case_conv.hpp>
+
+#include "batch_query.h"
+#include "logging/logging.h"
+#include "ostree_repo.h"
+#include "utilities/utils.h"
+
+const uint32_t OSTreeContentHasher::kMaxHeaderSize = 1024 * 1024;
+
+OSTreeContentHasher::OSTreeContentHasher() {
+  // Negative window bits: raw deflate data without a zlib header.
+  if (inflateInit2(&zstream_, -15) != Z_OK) {
+    throw std::runtime_error("Could not initialize zlib");
+  }
+}
+
+OSTreeContentHasher::~OSTreeContentHasher() { inflateEnd(&zstream_); }
+
+bool OSTreeContentHasher::Update(const char *data, size_t size) {
+  if (failed_) {
+    return false;
+  }
+  // The header starts with its size as a big-endian uint32, padded to 8 bytes.
+  while (size > 0 && !header_done_) {
+    const size_t wanted = (header_.size() < 8) ? 8 - header_.size() : 8 + header_size_ - header_.size();
+    const size_t taken = std::min(wanted, size);
+    header_.append(data, taken);
+    data += taken;
+    size -= taken;
+    if (header_.size() == 8) {
+      const auto *bytes = reinterpret_cast<const uint8_t *>(header_.data());
+      header_size_ = (static_cast<uint32_t>(bytes[0]) << 24U) | (static_cast<uint32_t>(bytes[1]) << 16U) |
+                     (static_cast<uint32_t>(bytes[2]) << 8U) | static_cast<uint32_t>(bytes[3]);
+      if (header_size_ == 0 || header_size_ > kMaxHeaderSize) {
+        failed_ = true;
+        return false;
+      }
+    }
+    if (header_.size() == 8 + static_cast<size_t>(header_size_)) {
+      if (!ProcessHeader()) {
+        failed_ = true;
+        return false;
+      }
+      header_done_ = true;
+    }
+  }
+  if (size > 0 && !Inflate(data, size)) {
+    failed_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool OSTreeContentHasher::ProcessHeader() {
+  // The archive header is (size, uid, gid, mode, rdev, symlink target,
+  // xattrs); the checksummed header is the same without the size.
+  GVariant *archive_header = g_variant_new_from_data(G_VARIANT_TYPE("(tuuuusa(ayay))"), header_.data() + 8,
+                                                     header_size_, FALSE, nullptr, nullptr);
+  g_variant_ref_sink(archive_header);
+  guint64 size;
+  guint32 uid;
+  guint32 gid;
+  guint32 mode;
+  guint32 rdev;
+  const char *symlink_target = nullptr;
+  GVariant *xattrs = nullptr;
+  g_variant_get(archive_header, "(tuuuu&s@a(ayay))", &size, &uid, &gid, &mode, &rdev, &symlink_target, &xattrs);
+  (void)size;
+
+  GVariant *file_header = g_variant_new("(uuuus@a(ayay))", uid, gid, mode, rdev, symlink_target, xattrs);
+  g_variant_ref_sink(file_header);
+  const auto file_header_size = static_cast<uint32_t>(g_variant_get_size(file_header));
+  std::array<unsigned char, 8> prefix{};
+  prefix[0] = static_cast<unsigned char>(file_header_size >> 24U);
+  prefix[1] = static_cast<unsigned char>(file_header_size >> 16U);
+  prefix[2] = static_cast<unsigned char>(file_header_size >> 8U);
+  prefix[3] = static_cast<unsigned char>(file_header_size);
+  hasher_.update(prefix.data(), prefix.size());
+  hasher_.update(static_cast<const unsigned char *>(g_variant_get_data(file_header)), file_header_size);
+
+  g_variant_unref(file_header);
+  g_variant_unref(xattrs);
+  g_variant_unref(archive_header);
+  return true;
+}
+
+bool OSTreeContentHasher::Inflate(const char *data, size_t size) {
+  if (stream_end_) {
+    // Trailing garbage after the compressed content.
+    return false;
+  }
+  inflate_started_ = true;
+  std::array<unsigned char, 64 * 1024> out{};
+  zstream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  zstream_.avail_in = static_cast<uInt>(size);
+  while (true) {
+    zstream_.next_out = out.data();
+    zstream_.avail_out = static_cast<uInt>(out.size());
+    const int ret = inflate(&zstream_, Z_NO_FLUSH);
+    const size_t produced = out.size() - zstream_.avail_out;
+    if (produced > 0) {
+      hasher_.update(out.data(), produced);
+    }
+    if (ret == Z_STREAM_END) {
+      stream_end_ = true;
+      return zstream_.avail_in == 0;
+    }
+    if (ret == Z_BUF_ERROR) {
+      // No progress possible: all input consumed.
+      return true;
+    }
+    if (ret != Z_OK) {
+      return false;
+    }
+    if (zstream_.avail_in == 0 && zstream_.avail_out != 0) {
+      return true;
+    }
+  }
+}
+
+std::string OSTreeContentHasher::Finish() {
+  // Symlinks have no compressed content at all.
+  if (failed_ || !header_done_ || (inflate_started_ && !stream_end_)) {
+    return "";
+  }
+  return boost::algorithm::to_lower_copy(hasher_.getHexDigest());
+}
+
+const int TreeVerifier::kMaxAttempts = 3;
+
+const size_t TreeVerifier::kMaxBatchQuerySize = 1000;
+
+namespace {
+std::string ObjectName(const OSTreeChildRef &object) {
+  // "objects/ab/cdef...dirtree" -> "ab/cdef...dirtree"
+  const boost::filesystem::path path = OSTreeRepo::ObjectRelativePath(object.first, object.second);
+  return (path.parent_path().filename() / path.filename()).string();
+}
+
+// Missing objects and unsupported batch queries are answers too. Network
+// errors, server errors and throttling count against the server, so that the
+// RateController backs off.
+bool ServerRespondedOk(const long rescode) {  // NOLINT(google-runtime-int)
+  return rescode >= 200 && rescode < 500 && rescode != 408 && rescode != 429;
+}
+}  // namespace
+
+/* A request sent through the RequestPool on behalf of the verifier. */
+class TreeVerifier::Transfer : public PoolRequest {
+ public:
+  Transfer(TreeVerifier &verifier, std::vector<QueueEntry> entries)
+      : verifier_(verifier), entries_(std::move(entries)) {}
+  ~Transfer() override {
+    if (handle_ != nullptr) {
+      curl_easy_cleanup(handle_);
+    }
+  }
+
+ protected:
+  /* Create the curl handle for path on the server. */
+  void Init(TreehubServer &server, const std::string &path) {
+    handle_ = curl_easy_init();
+    if (handle_ == nullptr) {
+      throw std::runtime_error("Could not initialize curl handle");
+    }
+    server.InjectIntoCurl(path, handle_);
+  }
+
+  CURL *handle() const { return handle_; }
+
+  CURL *Start(CURLM *curl_multi_handle) {
+    curlEasySetoptWrapper(handle_, CURLOPT_VERBOSE, get_curlopt_verbose());
+    curlEasySetoptWrapper(handle_, CURLOPT_USERAGENT, Utils::getUserAgent());
+    curlEasySetoptWrapper(handle_, CURLOPT_WRITEFUNCTION, &Transfer::WriteCallback);
+    curlEasySetoptWrapper(handle_, CURLOPT_WRITEDATA, this);
+    const CURLMcode err = curl_multi_add_handle(curl_multi_handle, handle_);
+    if (err != CURLM_OK) {
+      throw std::runtime_error(std::string("curl_multi_add_handle failed with error: ") + curl_multi_strerror(err));
+    }
+    return handle_;
+  }
+
+  /* Release the curl handle and return the HTTP status. */
+  long Finish(CURLM *curl_multi_handle) {  // NOLINT(google-runtime-int)
+    long rescode = 0;                      // NOLINT(google-runtime-int)
+    curl_easy_getinfo(handle_, CURLINFO_RESPONSE_CODE, &rescode);
+    curl_multi_remove_handle(curl_multi_handle, handle_);
+    curl_easy_cleanup(handle_);
+    handle_ = nullptr;
+    return rescode;
+  }
+
+  TreeVerifier &verifier_;
+  std::vector<QueueEntry> entries_;
+  std::string body_;  // metadata object or batch query response
+  std::unique_ptr<OSTreeContentHasher> content_hasher_;
+
+ private:
+  static size_t WriteCallback(void *buffer, size_t size, size_t nmemb, void *userp) {
+    auto *transfer = static_cast<Transfer *>(userp);
+    const char *data = static_cast<const char *>(buffer);
+    if (transfer->content_hasher_) {
+      // Returning less than was passed in aborts the transfer.
+      return transfer->content_hasher_->Update(data, size * nmemb) ? size * nmemb : 0;
+    }
+    transfer->body_.append(data, size * nmemb);
+    return size * nmemb;
+  }
+
+  CURL *handle_{nullptr};
+};
+
+/* Download an object and check its checksum. */
+class TreeVerifier::Download : public TreeVerifier::Transfer {
+ public:
+  Download(TreeVerifier &verifier, const QueueEntry &entry) : Transfer(verifier, {entry}) {
+    if (entry.first.second == OstreeObjectType::OSTREE_OBJECT_TYPE_FILE) {
+      content_hasher_ = std_::make_unique<OSTreeContentHasher>();
+    }
+  }
+
+  CURL *MakeRequest(TreehubServer &server, CURLM *curl_multi_handle) override {
+    Init(server, "objects/" + ObjectName(entries_.front().first));
+    return Start(curl_multi_handle);
+  }
+
+  bool CurlDone(CURLM *curl_multi_handle, const CURLcode result, RequestPool &pool) override {
+    const long rescode = Finish(curl_multi_handle);  // NOLINT(google-runtime-int)
+    --verifier_.downloads_pending_;
+    const OSTreeChildRef &object = entries_.front().first;
+    if (rescode == 404) {
+      verifier_.Missing(object);
+    } else if (result == CURLE_OK && rescode == 200) {
+      std::string checksum;
+      if (content_hasher_) {
+        checksum = content_hasher_->Finish();
+      } else {
+        const std::string digest = Crypto::sha256digest(body_);
+        checksum = OSTreeHash(reinterpret_cast<const uint8_t *>(digest.data())).string();
+      }
+      if (checksum == object.first.string()) {
+        verifier_.Verified(pool, object, body_);
+      } else {
+        LOG_ERROR << "Corrupt object on server: " << ObjectName(object);
+        ++verifier_.objects_corrupt_;
+      }
+    } else if (result == CURLE_WRITE_ERROR && content_hasher_) {
+      LOG_ERROR << "Corrupt object on server: " << ObjectName(object);
+      ++verifier_.objects_corrupt_;
+    } else {
+      LOG_DEBUG << "Download of " << ObjectName(object) << " failed: " << curl_easy_strerror(result) << " (HTTP "
+                << rescode << ")";
+      verifier_.Retry(pool, entries_, true);
+    }
+    return ServerRespondedOk(rescode);
+  }
+
+  const char *endpoint() const override { return "download"; }
+};
+
+/* Check the presence of objects, with a HEAD request for a single one and a
+ * batched query for several. */
+class TreeVerifier::Query : public TreeVerifier::Transfer {
+ public:
+  Query(TreeVerifier &verifier, std::vector<QueueEntry> entries) : Transfer(verifier, std::move(entries)) {}
+  ~Query() override { curl_slist_free_all(request_headers_); }
+
+  CURL *MakeRequest(TreehubServer &server, CURLM *curl_multi_handle) override {
+    if (!is_batch()) {
+      Init(server, "objects/" + ObjectName(entries_.front().first));
+      curlEasySetoptWrapper(handle(), CURLOPT_NOBODY, 1L);  // HEAD
+      return Start(curl_multi_handle);
+    }
+    for (const QueueEntry &entry : entries_) {
+      request_body_ += ObjectName(entry.first) + "\n";
+    }
+    Init(server, "query/objects");
+    request_headers_ = server.HeadersWithContentType("Content-Type: text/plain");
+    curlEasySetoptWrapper(handle(), CURLOPT_HTTPHEADER, request_headers_);
+    curlEasySetoptWrapper(handle(), CURLOPT_POSTFIELDS, request_body_.c_str());
+    const auto body_size = static_cast<long>(request_body_.size());  // NOLINT(google-runtime-int)
+    curlEasySetoptWrapper(handle(), CURLOPT_POSTFIELDSIZE, body_size);
+    return Start(curl_multi_handle);
+  }
+
+  bool CurlDone(CURLM *curl_multi_handle, const CURLcode result, RequestPool &pool) override {
+    const long rescode = Finish(curl_multi_handle);  // NOLINT(google-runtime-int)
+    if (!is_batch()) {
+      if (rescode == 200) {
+        ++verifier_.objects_checked_;
+      } else if (rescode == 404) {
+        verifier_.Missing(entries_.front().first);
+      } else {
+        verifier_.Retry(pool, entries_, false);
+      }
+    } else if (BatchQuery::IsUnsupportedResponse(rescode)) {
+      LOG_INFO << "Server does not support batched object queries (HTTP " << rescode
+               << "), falling back to one query per object";
+      verifier_.batch_queries_ = false;
+      verifier_.queries_.insert(verifier_.queries_.begin(), entries_.begin(), entries_.end());
+      return true;
+    } else if (result == CURLE_OK && rescode == 200) {
+      const std::set<std::string> present = BatchQuery::ParseResponse(body_);
+      for (const QueueEntry &entry : entries_) {
+        if (present.count(ObjectName(entry.first)) != 0U) {
+          ++verifier_.objects_checked_;
+        } else {
+          verifier_.Missing(entry.first);
+        }
+      }
+    } else {
+      verifier_.Retry(pool, entries_, false);
+    }
+    return ServerRespondedOk(rescode);
+  }
+
+  const char *endpoint() const override { return is_batch() ? "batch query" : "query"; }
+
+ private:
+  bool is_batch() const { return entries_.size() > 1; }
+
+  std::string request_body_;
+  struct curl_slist *request_headers_{nullptr};
+};
+
+TreeVerifier::TreeVerifier(TreehubServer &server, const int max_requests, const bool verify_content)
+    : server_(server), max_requests_(std::max(max_requests, 1)), verify_content_(verify_content) {}
+
+bool TreeVerifier::NeedsDownload(const OstreeObjectType type, const bool verify_content) {
+  return verify_content || type == OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT ||
+         type == OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_TREE ||
+         type == OstreeObjectType::OSTREE_OBJECT_TYPE_DIR_META;
+}
+
+bool TreeVerifier::Run(const OSTreeHash &root, const OstreeObjectType type) {
+  {
+    RequestPool pool(server_, max_requests_, RunMode::kWalkTree);
+    Enqueue(pool, OSTreeChildRef(root, type));
+    do {
+      SendQueries(pool);
+      pool.Loop();
+    } while (!pool.is_stopped() && (!pool.is_idle() || !queries_.empty()));
+    if (pool.is_stopped()) {
+      LOG_ERROR << "Server keeps failing, giving up on the remaining objects";
+    }
+    queries_.clear();
+  }
+
+  // Whatever was found but got no answer, after retries or because the
+  // server kept failing, could not be checked.
+  objects_failed_ = seen_.size() - objects_checked_ - objects_missing_ - objects_corrupt_;
+  LOG_INFO << "Checked " << objects_checked_ << " objects: " << objects_missing_ << " missing, " << objects_corrupt_
+           << " corrupt, " << objects_failed_ << " could not be checked";
+  return objects_missing_ == 0 && objects_corrupt_ == 0 && objects_failed_ == 0;
+}
+
+void TreeVerifier::Enqueue(RequestPool &pool, const OSTreeChildRef &object) {
+  if (!seen_.insert(object.first).second) {
+    return;
+  }
+  if (NeedsDownload(object.second, verify_content_)) {
+    // Metadata first: it reveals more of the tree.
+    ++downloads_pending_;
+    pool.AddRequest(std_::make_unique<Download>(*this, QueueEntry(object, 1)));
+  } else {
+    queries_.emplace_back(object, 1);
+  }
+}
+
+void TreeVerifier::SendQueries(RequestPool &pool) {
+  const size_t batch_size = batch_queries_ ? kMaxBatchQuerySize : 1;
+  // Fill the batches while downloads may still find more objects.
+  while (!queries_.empty() && (queries_.size() >= batch_size || downloads_pending_ == 0 || pool.is_idle())) {
+    std::vector<QueueEntry> batch;
+    while (!queries_.empty() && batch.size() < batch_size) {
+      batch.push_back(queries_.front());
+      queries_.pop_front();
+    }
+    pool.AddRequest(std_::make_unique<Query>(*this, std::move(batch)));
+  }
+}
+
+void TreeVerifier::Verified(RequestPool &pool, const OSTreeChildRef &object, const std::string &body) {
+  ++objects_checked_;
+  // The checksum matched, so the metadata can be trusted to parse.
+  for (const OSTreeChildRef &child : OSTreeObject::ParseChildren(object.second, body)) {
+    Enqueue(pool, child);
+  }
+}
+
+void TreeVerifier::Missing(const OSTreeChildRef &object) {
+  LOG_ERROR << "Object missing on server: " << ObjectName(object);
+  ++objects_missing_;
+}
+
+void TreeVerifier::Retry(RequestPool &pool, const std::vector<QueueEntry> &entries, const bool download) {
+  for (const QueueEntry &entry : entries) {
+    if (pool.is_stopped()) {
+      continue;
+    }
+    if (entry.second >= kMaxAttempts) {
+      LOG_ERROR << "Could not check object " << ObjectName(entry.first) << " after " << kMaxAttempts << " attempts";
+    } else if (download) {
+      ++downloads_pending_;
+      pool.AddRequest(std_::make_unique<Download>(*this, QueueEntry(entry.first, entry.second + 1)));
+    } else {
+      queries_.emplace_back(entry.first, entry.second + 1);
+    }
+  }
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,127 @@
+#ifndef SOTA_CLIENT_TOOLS_TREE_VERIFIER_H_
+#define SOTA_CLIENT_TOOLS_TREE_VERIFIER_H_
+
+#include <deque>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "crypto/crypto.h"
+#include "ostree_hash.h"
+#include "ostree_object.h"
+#include "request_pool.h"
+#include "treehub_server.h"
+
+/**
+ * Compute the OSTree content checksum of an archive-z2 file object (.filez)
+ * while it is being read, without storing it.
+ *
+ * A .filez object is a size-prefixed GVariant header followed by the
+ * raw-deflated file content. The checksum is the SHA-256 of the equivalent
+ * uncompressed file header followed by the uncompressed content.
+ */
+class OSTreeContentHasher {
+ public:
+  OSTreeContentHasher();
+  ~OSTreeContentHasher();
+  OSTreeContentHasher(const OSTreeContentHasher&) = delete;
+  OSTreeContentHasher& operator=(const OSTreeContentHasher&) = delete;
+
+  /* Feed the next chunk of the object. Returns false if it is malformed. */
+  bool Update(const char* data, size_t size);
+
+  /* The checksum as lowercase hex, or an empty string if the object was
+   * malformed or truncated. */
+  std::string Finish();
+
+ private:
+  /**
+   * Upper bound on the size of the header variant. It holds the extended
+   * attributes, so it is small in practice.
+   */
+  static const uint32_t kMaxHeaderSize;
+
+  bool ProcessHeader();
+  bool Inflate(const char* data, size_t size);
+
+  std::string header_;
+  uint32_t header_size_{0};
+  bool header_done_{false};
+  bool inflate_started_{false};
+  bool stream_end_{false};
+  bool failed_{false};
+  z_stream zstream_{};
+  MultiPartSHA256Hasher hasher_;
+};
+
+/**
+ * Check that every object below a commit is present on Treehub. The requests
+ * are sent through a RequestPool, so as for uploads, its RateController ramps
+ * the number of parallel requests up to max_requests, cuts it back and backs
+ * off when the server fails or throttles, and gives up when it keeps failing.
+ *
+ * Commit, dirtree and dirmeta objects are downloaded, since they are needed
+ * to find the rest of the tree, and their checksums are verified on the way.
+ * File objects are only checked for presence, with batched queries where the
+ * server supports them, unless verify_content is set: then they are
+ * downloaded as well and their content checksum is computed as the data
+ * streams in. Missing and corrupt objects are logged as soon as they are
+ * found.
+ */
+class TreeVerifier {
+ public:
+  TreeVerifier(TreehubServer& server, int max_requests, bool verify_content);
+  TreeVerifier(const TreeVerifier&) = delete;
+  TreeVerifier& operator=(const TreeVerifier&) = delete;
+
+  /* Verify the tree below root. Returns true if no object is missing,
+   * corrupt or could not be checked. */
+  bool Run(const OSTreeHash& root, OstreeObjectType type);
+
+  size_t objects_checked() const { return objects_checked_; }
+  size_t objects_missing() const { return objects_missing_; }
+  size_t objects_corrupt() const { return objects_corrupt_; }
+  size_t objects_failed() const { return objects_failed_; }
+
+ private:
+  class Transfer;
+  class Download;
+  class Query;
+  using QueueEntry = std::pair<OSTreeChildRef, int>;  // object, attempt
+
+  /**
+   * Number of attempts for an object before giving up on it.
+   */
+  static const int kMaxAttempts;
+
+  /**
+   * Maximum number of objects checked in a single batched presence query.
+   */
+  static const size_t kMaxBatchQuerySize;
+
+  void Enqueue(RequestPool& pool, const OSTreeChildRef& object);
+  void SendQueries(RequestPool& pool);
+  void Verified(RequestPool& pool, const OSTreeChildRef& object, const std::string& body);
+  void Missing(const OSTreeChildRef& object);
+  void Retry(RequestPool& pool, const std::vector<QueueEntry>& entries, bool download);
+  static bool NeedsDownload(OstreeObjectType type, bool verify_content);
+
+  TreehubServer& server_;
+  const int max_requests_;
+  const bool verify_content_;
+  // Presence checks wait here until they can be batched.
+  std::deque<QueueEntry> queries_;
+  std::set<OSTreeHash> seen_;
+  size_t downloads_pending_{0};
+  bool batch_queries_{true};
+  size_t objects_checked_{0};
+  size_t objects_missing_{0};
+  size_t objects_corrupt_{0};
+  size_t objects_failed_{0};
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_TREE_VERIFIER_H_
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <boost/filesystem.hpp>
+#include <boost/process.hpp>
+
+#include "test_utils.h"
+#include "tree_verifier.h"
+#include "utilities/utils.h"
+
+static const char *const filez_path =
+    "tests/sota_tools/repo/objects/a1/f4f81612ce959883f58e83789f6c7d97b0b55b801b2a09955235f40b0f2dfb.filez";
+static const char *const filez_hash = "a1f4f81612ce959883f58e83789f6c7d97b0b55b801b2a09955235f40b0f2dfb";
+static const char *const commit_hash = "b9ac1e45f9227df8ee191b6e51e09417bd36c6ebbeff999431e3073ac50f0563";
+
+/* The content checksum of a file object does not depend on how the data is
+ * split into chunks. */
+TEST(TreeVerifier, ContentHasher) {
+  const std::string data = Utils::readFile(filez_path);
+  {
+    OSTreeContentHasher hasher;
+    EXPECT_TRUE(hasher.Update(data.data(), data.size()));
+    EXPECT_EQ(hasher.Finish(), filez_hash);
+  }
+  {
+    OSTreeContentHasher hasher;
+    for (const char c : data) {
+      EXPECT_TRUE(hasher.Update(&c, 1));
+    }
+    EXPECT_EQ(hasher.Finish(), filez_hash);
+  }
+}
+
+/* Truncated or modified file objects do not produce the right checksum. */
+TEST(TreeVerifier, ContentHasherCorrupt) {
+  const std::string data = Utils::readFile(filez_path);
+  {
+    OSTreeContentHasher hasher;
+    hasher.Update(data.data(), data.size() - 4);
+    EXPECT_NE(hasher.Finish(), filez_hash);
+  }
+  {
+    std::string modified = data;
+    modified[modified.size() - 10] ^= 0x01;
+    OSTreeContentHasher hasher;
+    hasher.Update(modified.data(), modified.size());
+    EXPECT_NE(hasher.Finish(), filez_hash);
+  }
+}
+
+/* Verify a complete tree on the server, with and without checking the
+ * content of file objects. Then remove an object from the server and
+ * verify that it is reported as missing. */
+TEST(TreeVerifier, VerifyTree) {
+  TemporaryDirectory repo_dir;
+  const std::string port = TestUtils::getFreePort();
+  boost::process::child server_process("tests/sota_tools/treehub_server.py", std::string("-p"), port,
+                                       std::string("-d"), repo_dir.PathString(), std::string("--create"));
+  TestUtils::waitForServer("http://localhost:" + port + "/");
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+  const OSTreeHash commit = OSTreeHash::Parse(commit_hash);
+
+  {
+    TreeVerifier verifier(server, 4, false);
+    EXPECT_TRUE(verifier.Run(commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+    // A commit, a dirtree, a dirmeta and ten files.
+    EXPECT_EQ(verifier.objects_checked(), 13);
+  }
+  {
+    TreeVerifier verifier(server, 4, true);
+    EXPECT_TRUE(verifier.Run(commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+    EXPECT_EQ(verifier.objects_checked(), 13);
+    EXPECT_EQ(verifier.objects_corrupt(), 0);
+  }
+
+  for (boost::filesystem::recursive_directory_iterator it(repo_dir.Path() / "objects"), end; it != end; ++it) {
+    if (it->path().extension() == ".filez") {
+      boost::filesystem::remove(it->path());
+      break;
+    }
+  }
+  TreeVerifier verifier(server, 4, false);
+  EXPECT_FALSE(verifier.Run(commit, OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+  EXPECT_EQ(verifier.objects_missing(), 1);
+  EXPECT_EQ(verifier.objects_checked(), 12);
+}
+
+/* Server errors are retried with backoff, and the tree still verifies. */
+TEST(TreeVerifier, ServerErrors) {
+  TemporaryDirectory repo_dir;
+  const std::string port = TestUtils::getFreePort();
+  boost::process::child server_process("tests/sota_tools/treehub_server.py", std::string("-p"), port,
+                                       std::string("-d"), repo_dir.PathString(), std::string("--create"),
+                                       std::string("-f"), std::string("4"), std::string("--fail-status"),
+                                       std::string("503"));
+  TestUtils::waitForServer("http://localhost:" + port + "/");
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+
+  TreeVerifier verifier(server, 4, false);
+  EXPECT_TRUE(verifier.Run(OSTreeHash::Parse(commit_hash), OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+  EXPECT_EQ(verifier.objects_checked(), 13);
+  EXPECT_EQ(verifier.objects_failed(), 0);
+}
+
+/* Throttled requests count as server failures, so the verifier backs off
+ * and retries them, and the tree still verifies. */
+TEST(TreeVerifier, ServerThrottling) {
+  TemporaryDirectory repo_dir;
+  const std::string port = TestUtils::getFreePort();
+  boost::process::child server_process("tests/sota_tools/treehub_server.py", std::string("-p"), port,
+                                       std::string("-d"), repo_dir.PathString(), std::string("--create"),
+                                       std::string("-f"), std::string("4"), std::string("--fail-status"),
+                                       std::string("429"));
+  TestUtils::waitForServer("http://localhost:" + port + "/");
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+
+  TreeVerifier verifier(server, 4, false);
+  EXPECT_TRUE(verifier.Run(OSTreeHash::Parse(commit_hash), OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+  EXPECT_EQ(verifier.objects_checked(), 13);
+  EXPECT_EQ(verifier.objects_failed(), 0);
+}
+
+/* An object that keeps failing is given up on after a few attempts, with a
+ * growing pause between them. */
+TEST(TreeVerifier, ServerDown) {
+  TemporaryDirectory repo_dir;
+  const std::string port = TestUtils::getFreePort();
+  boost::process::child server_process("tests/sota_tools/treehub_server.py", std::string("-p"), port,
+                                       std::string("-d"), repo_dir.PathString(), std::string("--create"),
+                                       std::string("-f"), std::string("1"), std::string("--fail-status"),
+                                       std::string("500"));
+  TestUtils::waitForServer("http://localhost:" + port + "/");
+  TreehubServer server;
+  server.root_url("http://localhost:" + port);
+
+  const auto start = std::chrono::steady_clock::now();
+  TreeVerifier verifier(server, 4, false);
+  EXPECT_FALSE(verifier.Run(OSTreeHash::Parse(commit_hash), OstreeObjectType::OSTREE_OBJECT_TYPE_COMMIT));
+  EXPECT_EQ(verifier.objects_checked(), 0);
+  EXPECT_EQ(verifier.objects_failed(), 1);
+  // Backed off for at least 1 + 2 seconds between the three attempts.
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::seconds(3));
+}
+
+#ifndef __NO_MAIN__
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+#endif
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -37,6 +37,16 @@ void TreehubServer::SetContentType(const string& content_type) {
   content_type_header_.data = const_cast<char*>(content_type_header_contents_.c_str());
 }
 
+struct curl_slist* TreehubServer::HeadersWithContentType(const string& content_type) const {
+  struct curl_slist* headers = nullptr;
+  for (const struct curl_slist* header = &auth_header_; header != &content_type_header_; header = header->next) {
+    if (*header->data != '\0') {
+      headers = curl_slist_append(headers, header->data);
+    }
+  }
+  return curl_slist_append(headers, content_type.c_str());
+}
+
 void TreehubServer::SetCerts(const std::string& client_p12) {
   method_ = AuthMethod::kTls;
   client_p12_path_.PutContents(client_p12);
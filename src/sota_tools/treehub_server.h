@@ -18,6 +18,11 @@ class TreehubServer {
 
   void InjectIntoCurl(const std::string &url_suffix, CURL *curl_handle, bool tufrepo = false) const;
 
+  // The headers set by InjectIntoCurl, with the given content type instead of
+  // the one set by SetContentType. The caller owns the returned list and must
+  // free it with curl_slist_free_all once the request has been completed.
+  struct curl_slist *HeadersWithContentType(const std::string &content_type) const;
+
   void ca_certs(const std::string &cacerts) { ca_certs_ = cacerts; }
   void root_url(const std::string &_root_url);
   void repo_url(const std::string &_repo_url);
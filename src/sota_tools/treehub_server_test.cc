@@ -61,6 +61,31 @@ TEST(treehub_server, basic_auth) {
   }
 }
 
+/* Headers for a request with its own content type keep the authentication. */
+TEST(treehub_server, content_type) {
+  TreehubServer server;
+  CurlEasyWrapper curl_handle;
+  server.root_url(std::string("http://127.0.0.1:") + port);
+  server.SetToken("test_token");
+  server.SetContentType("Content-Type: application/octet-stream");
+  server.InjectIntoCurl("/", curl_handle.get());
+  struct curl_slist *headers = server.HeadersWithContentType("Content-Type: application/gzip");
+  curlEasySetoptWrapper(curl_handle.get(), CURLOPT_HTTPHEADER, headers);
+  std::string response;
+  curlEasySetoptWrapper(curl_handle.get(), CURLOPT_WRITEFUNCTION, writeString);
+  curlEasySetoptWrapper(curl_handle.get(), CURLOPT_WRITEDATA, static_cast<void *>(&response));
+  curl_easy_perform(curl_handle.get());
+  curl_slist_free_all(headers);
+
+  long rescode;  // NOLINT(google-runtime-int)
+  curl_easy_getinfo(curl_handle.get(), CURLINFO_RESPONSE_CODE, &rescode);
+  ASSERT_EQ(rescode, 200);
+  auto response_json = Utils::parseJSON(response);
+  EXPECT_EQ(response_json["Authorization"], "Bearer test_token");
+  EXPECT_EQ(response_json["Content-Type"], "application/gzip");
+  EXPECT_EQ(response_json["x-ats-ostree-force"], "true");
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,113 @@
+#include "upload_bundle.h"
+
+#include <assert.h>
+
+#include <map>
+#include <utility>
+
+#include "logging/logging.h"
+#include "request_pool.h"
+#include "utilities/utils.h"
+
+UploadBundle::UploadBundle(std::vector<OSTreeObject::ptr> objects) : objects_(std::move(objects)) {
+  for (const OSTreeObject::ptr &object : objects_) {
+    files_[object->object_name()] = object->file_path();
+  }
+}
+
+UploadBundle::~UploadBundle() {
+  if (curl_handle_ != nullptr) {
+    curl_easy_cleanup(curl_handle_);
+    curl_handle_ = nullptr;
+  }
+  curl_slist_free_all(request_headers_);
+}
+
+void UploadBundle::Prepare() {
+  std::map<std::string, std::string> entries;
+  for (const auto &file : files_) {
+    LOG_INFO << "Uploading " << file.first << " (bundled)";
+    entries[file.first] = Utils::readFile(file.second);
+  }
+  std::stringstream archive;
+  Utils::writeArchive(entries, archive);
+  request_body_ = archive.str();
+}
+
+void UploadBundle::MakeRequest(const TreehubServer &push_target, CURLM *curl_multi_handle) {
+  assert(!curl_handle_);
+  curl_handle_ = curl_easy_init();
+  if (curl_handle_ == nullptr) {
+    throw std::runtime_error("Could not initialize curl handle");
+  }
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_VERBOSE, get_curlopt_verbose());
+
+  push_target.InjectIntoCurl("bundle/objects", curl_handle_);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_USERAGENT, Utils::getUserAgent());
+  request_headers_ = push_target.HeadersWithContentType("Content-Type: application/gzip");
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_HTTPHEADER, request_headers_);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_POSTFIELDS, request_body_.data());
+  const auto body_size = static_cast<curl_off_t>(request_body_.size());
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_POSTFIELDSIZE_LARGE, body_size);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEFUNCTION, &UploadBundle::curl_handle_write);
+  curlEasySetoptWrapper(curl_handle_, CURLOPT_WRITEDATA, this);
+  http_response_.str("");  // Empty the response buffer
+
+  const CURLMcode err = curl_multi_add_handle(curl_multi_handle, curl_handle_);
+  if (err != 0) {
+    LOG_ERROR << "curl_multi_add_handle error:" << curl_multi_strerror(err);
+  }
+  request_start_time_ = std::chrono::steady_clock::now();
+}
+
+void UploadBundle::CurlDone(CURLM *curl_multi_handle, RequestPool &pool) {
+  long rescode = 0;  // NOLINT(google-runtime-int)
+  curl_easy_getinfo(curl_handle_, CURLINFO_RESPONSE_CODE, &rescode);
+  curl_multi_remove_handle(curl_multi_handle, curl_handle_);
+  curl_easy_cleanup(curl_handle_);
+  curl_handle_ = nullptr;
+  curl_slist_free_all(request_headers_);
+  request_headers_ = nullptr;
+  request_body_.clear();
+
+  if (IsUnsupportedResponse(rescode)) {
+    LOG_INFO << "Server does not support bundled object uploads (HTTP " << rescode
+             << "), falling back to one upload per object";
+    // This is not a failure of the server, so don't let it count against the
+    // rate controller.
+    last_operation_result_ = ServerResponse::kOk;
+    pool.DisableUploadBundles();
+    for (const OSTreeObject::ptr &object : objects_) {
+      pool.AddUpload(object);
+    }
+  } else if (rescode == 204) {
+    LOG_DEBUG << "Bundle of " << objects_.size() << " objects uploaded";
+    last_operation_result_ = ServerResponse::kOk;
+    for (const OSTreeObject::ptr &object : objects_) {
+      object->UploadDone(pool, rescode);
+    }
+  } else {
+    LOG_WARNING << "OSTree bundle upload reported an error code: " << rescode << " retrying...";
+    LOG_DEBUG << http_response_.str();
+    last_operation_result_ = ServerResponse::kTemporaryFailure;
+    for (const OSTreeObject::ptr &object : objects_) {
+      pool.AddUpload(object);
+    }
+  }
+  objects_.clear();
+}
+
+bool UploadBundle::IsUnsupportedResponse(const long rescode) {  // NOLINT(google-runtime-int)
+  // Client errors other than a timeout or throttling won't go away by asking
+  // again, whether the server lacks the endpoint or rejects the bundle.
+  const bool client_error = rescode >= 400 && rescode < 500 && rescode != 408 && rescode != 429;
+  return client_error || rescode == 501;
+}
+
+size_t UploadBundle::curl_handle_write(void *buffer, size_t size, size_t nmemb, void *userp) {
+  auto *that = static_cast<UploadBundle *>(userp);
+  that->http_response_.write(static_cast<const char *>(buffer), static_cast<std::streamsize>(size * nmemb));
+  return size * nmemb;
+}
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
@@ -0,0 +1,69 @@
+#ifndef SOTA_CLIENT_TOOLS_UPLOAD_BUNDLE_H_
+#define SOTA_CLIENT_TOOLS_UPLOAD_BUNDLE_H_
+
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "ostree_object.h"
+#include "treehub_server.h"
+
+class RequestPool;
+
+/**
+ * Upload many small OSTree objects to Treehub with a single request.
+ *
+ * The objects are packed into a gzipped tar archive (see Utils::writeArchive)
+ * with one entry per object, named like the object ("ab/cdef...dirtree"), and
+ * POSTed to bundle/objects as application/gzip. The server stores every entry
+ * and responds with 204, or fails the whole bundle. Servers that do not
+ * implement the endpoint are detected via the response code, in which case
+ * the objects are handed back to the pool to be uploaded one by one.
+ */
+class UploadBundle {
+ public:
+  explicit UploadBundle(std::vector<OSTreeObject::ptr> objects);
+  UploadBundle(const UploadBundle&) = delete;
+  UploadBundle operator=(const UploadBundle&) = delete;
+  ~UploadBundle();
+
+  /* Pack the objects into the request body. This only reads the object files
+   * and touches nothing else, so it can run on a thread of its own. */
+  void Prepare();
+
+  /* Send the packed objects to the destination server. */
+  void MakeRequest(const TreehubServer& push_target, CURLM* curl_multi_handle);
+
+  /* Process the completed curl transaction and report the upload result for
+   * every object in the bundle. */
+  void CurlDone(CURLM* curl_multi_handle, RequestPool& pool);
+
+  CURL* curl_handle() const { return curl_handle_; }
+  size_t size() const { return objects_.size(); }
+  std::chrono::steady_clock::time_point RequestStartTime() const { return request_start_time_; }
+  ServerResponse LastOperationResult() const { return last_operation_result_; }
+
+  /* HTTP response codes which indicate that the server does not support
+   * bundled uploads, as opposed to a (temporary) server failure: every client
+   * error except 408 (timeout) and 429 (throttling), and 501. */
+  static bool IsUnsupportedResponse(long rescode);  // NOLINT(google-runtime-int)
+
+ private:
+  static size_t curl_handle_write(void* buffer, size_t size, size_t nmemb, void* userp);
+
+  std::vector<OSTreeObject::ptr> objects_;
+  std::map<std::string, boost::filesystem::path> files_;  // object name to file
+  std::string request_body_;
+  struct curl_slist* request_headers_{nullptr};
+  std::stringstream http_response_;
+  CURL* curl_handle_{nullptr};
+  std::chrono::steady_clock::time_point request_start_time_;
+  ServerResponse last_operation_result_{ServerResponse::kNoResponse};
+};
+
+// vim: set tabstop=2 shiftwidth=2 expandtab:
+#endif  // SOTA_CLIENT_TOOLS_UPLOAD_BUNDLE_H_
@@ -5,15 +5,15 @@ void DirectorRepo::addTarget(const std::string &target_name, const Json::Value &
   const boost::filesystem::path current = path_ / DirectorRepo::dir / "targets.json";
   const boost::filesystem::path staging = path_ / DirectorRepo::dir / "staging/targets.json";
 
-  Json::Value director_targets;
-  if (boost::filesystem::exists(staging)) {
-    director_targets = Utils::parseJSONFile(staging);
-  } else if (boost::filesystem::exists(current)) {
-    director_targets = Utils::parseJSONFile(current)["signed"];
-  } else {
+  if (!metadataExists(staging) && !metadataExists(current)) {
     throw std::runtime_error(std::string("targets.json not found at ") + staging.c_str() + " or " + current.c_str() +
                              "!");
   }
+  const bool staged = metadataExists(staging);
+  Json::Value &director_targets = stagedMetadata(staging);
+  if (!staged) {
+    director_targets = readMetadata(current);
+  }
   if (!expires.empty()) {
     director_targets["expires"] = expires;
   }
@@ -25,8 +25,7 @@ void DirectorRepo::addTarget(const std::string &target_name, const Json::Value &
   } else {
     director_targets["targets"][target_name]["custom"].removeMember("uri");
   }
-  director_targets["version"] = (Utils::parseJSONFile(current)["signed"]["version"].asUInt()) + 1;
-  Utils::writeFile(staging, Utils::jsonToCanonicalStr(director_targets));
+  director_targets["version"] = readMetadata(current)["version"].asUInt() + 1;
   updateRepo();
 }
 
@@ -50,20 +49,18 @@ void DirectorRepo::revokeTargets(const std::vector<std::string> &targets_to_remo
 void DirectorRepo::signTargets() {
   const boost::filesystem::path current = path_ / DirectorRepo::dir / "targets.json";
   const boost::filesystem::path staging = path_ / DirectorRepo::dir / "staging/targets.json";
-  Json::Value targets_unsigned;
 
-  if (boost::filesystem::exists(staging)) {
-    targets_unsigned = Utils::parseJSONFile(staging);
-  } else if (boost::filesystem::exists(current)) {
-    targets_unsigned = Utils::parseJSONFile(current)["signed"];
+  if (metadataExists(staging)) {
+    Json::Value &targets = signedMetadata(current, Uptane::Role::Targets());
+    targets.swap(stagedMetadata(staging));
+    removeMetadata(staging);
+  } else if (metadataExists(current)) {
+    // Sign the current metadata again.
+    signedMetadata(current, Uptane::Role::Targets());
   } else {
     throw std::runtime_error(std::string("targets.json not found at ") + staging.c_str() + " or " + current.c_str() +
                              "!");
   }
-
-  Utils::writeFile(path_ / DirectorRepo::dir / "targets.json",
-                   Utils::jsonToCanonicalStr(signTuf(Uptane::Role::Targets(), targets_unsigned)));
-  boost::filesystem::remove(path_ / DirectorRepo::dir / "staging/targets.json");
   updateRepo();
 }
 
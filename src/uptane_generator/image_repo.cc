@@ -6,15 +6,12 @@ void ImageRepo::addImage(const std::string &name, Json::Value &target, const std
 
   boost::filesystem::path targets_path =
       delegation ? ((repo_dir / "delegations") / delegation.name).string() + ".json" : repo_dir / "targets.json";
-  Json::Value targets = Utils::parseJSONFile(targets_path)["signed"];
+  auto role = delegation ? Uptane::Role(delegation.name, true) : Uptane::Role::Targets();
+  Json::Value &targets = signedMetadata(targets_path, role);
   // TODO: support multiple hardware IDs.
   target["custom"]["hardwareIds"][0] = hardware_id;
   targets["targets"][name] = target;
   targets["version"] = (targets["version"].asUInt()) + 1;
-
-  auto role = delegation ? Uptane::Role(delegation.name, true) : Uptane::Role::Targets();
-  std::string signed_targets = Utils::jsonToCanonicalStr(signTuf(role, targets));
-  Utils::writeFile(targets_path, signed_targets);
   updateRepo();
 }
 
@@ -75,21 +72,18 @@ void ImageRepo::addDelegation(const Uptane::Role &name, const Uptane::Role &pare
   }
   parent_path = parent_path /= (parent_role.ToString() + ".json");
 
-  if (!boost::filesystem::exists(parent_path)) {
+  if (!metadataExists(parent_path)) {
     throw std::runtime_error("Delegation role " + parent_role.ToString() + " does not exist.");
   }
 
   generateKeyPair(key_type, name);
-  Json::Value delegate;
+  Json::Value &delegate = signedMetadata((repo_dir / "delegations" / name.ToString()).string() + ".json", name);
   delegate["_type"] = "Targets";
   delegate["expires"] = expiration_time_;
   delegate["version"] = 1;
   delegate["targets"] = Json::objectValue;
 
-  std::string delegate_signed = Utils::jsonToCanonicalStr(signTuf(name, delegate));
-  Utils::writeFile((repo_dir / "delegations" / name.ToString()).string() + ".json", delegate_signed);
-
-  Json::Value parent_notsigned = Utils::parseJSONFile(parent_path)["signed"];
+  Json::Value &parent_notsigned = signedMetadata(parent_path, parent_role);
 
   auto keypair = keys_[name];
   parent_notsigned["delegations"]["keys"][keypair.public_key.KeyId()] = keypair.public_key.ToUptane();
@@ -101,9 +95,6 @@ void ImageRepo::addDelegation(const Uptane::Role &name, const Uptane::Role &pare
   role["terminating"] = terminating;
   parent_notsigned["delegations"]["roles"].append(role);
   parent_notsigned["version"] = (parent_notsigned["version"].asUInt()) + 1;
-
-  std::string signed_parent = Utils::jsonToCanonicalStr(signTuf(parent_role, parent_notsigned));
-  Utils::writeFile(parent_path, signed_parent);
   updateRepo();
 }
 
@@ -34,6 +34,7 @@ int main(int argc, char **argv) {
                                           "oldtargets: \tfill the staged Director Targets metadata with what is currently signed\n"
                                           "sign: \tsign arbitrary metadata with repo keys\n"
                                           "addcampaigns: \tgenerate campaigns json\n"
+                                          "bulk: \tadd the delegations, images and Director targets listed in a JSON manifest\n"
                                           "refresh: \trefresh a metadata object (bump the version)")
     ("path", po::value<boost::filesystem::path>(), "path to the repository")
     ("filename", po::value<boost::filesystem::path>(), "path to the image")
@@ -54,7 +55,8 @@ int main(int argc, char **argv) {
     ("dterm", po::bool_switch(), "if the created delegated role is terminating")
     ("dparent", po::value<std::string>()->default_value("targets"), "delegated role parent name")
     ("dpattern", po::value<std::string>(), "delegated file path pattern")
-    ("url", po::value<std::string>(), "custom download URL");
+    ("url", po::value<std::string>(), "custom download URL")
+    ("manifest", po::value<boost::filesystem::path>(), "path to the JSON manifest for 'bulk' command");
 
   // clang-format on
 
@@ -220,6 +222,15 @@ int main(int argc, char **argv) {
       } else if (command == "addcampaigns") {
         repo.generateCampaigns();
         std::cout << "Generated campaigns" << std::endl;
+      } else if (command == "bulk") {
+        if (vm.count("manifest") == 0) {
+          std::cerr << "bulk command requires --manifest\n";
+          exit(EXIT_FAILURE);
+        }
+        const Json::Value manifest = Utils::parseJSONFile(vm["manifest"].as<boost::filesystem::path>());
+        repo.addFromManifest(manifest);
+        std::cout << "Added " << manifest["delegations"].size() << " delegations, " << manifest["images"].size()
+                  << " images and " << manifest["targets"].size() << " Director targets" << std::endl;
       } else if (command == "refresh") {
         if (vm.count("repotype") == 0 || vm.count("keyname") == 0) {
           std::cerr << "refresh command requires --repotype and --keyname\n";
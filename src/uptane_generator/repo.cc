@@ -1,5 +1,6 @@
 #include <ctime>
 #include <regex>
+#include <set>
 #include "crypto/crypto.h"
 #include "logging/logging.h"
 
@@ -47,6 +48,12 @@ void Repo::addDelegationToSnapshot(Json::Value *snapshot, const Uptane::Role &ro
 }
 
 void Repo::updateRepo() {
+  if (batch_) {
+    update_pending_ = true;
+    return;
+  }
+  writeMetadata();
+
   const Json::Value old_snapshot = Utils::parseJSONFile(repo_dir_ / "snapshot.json")["signed"];
   Json::Value snapshot;
   snapshot["_type"] = "Snapshot";
@@ -73,6 +80,108 @@ void Repo::updateRepo() {
                    Utils::jsonToCanonicalStr(signTuf(Uptane::Role::Timestamp(), timestamp)));
 }
 
+void Repo::beginBatch() { batch_ = true; }
+
+void Repo::endBatch() {
+  batch_ = false;
+  writeMetadata();
+  if (update_pending_) {
+    update_pending_ = false;
+    updateRepo();
+  }
+}
+
+Repo::CachedMetadata &Repo::loadMetadata(const boost::filesystem::path &path, const bool is_signed) {
+  auto it = metadata_.find(path);
+  if (it != metadata_.end() && !it->second.removed) {
+    return it->second;
+  }
+  const bool removed = it != metadata_.end();
+  CachedMetadata &metadata = metadata_[path];
+  metadata = CachedMetadata();
+  metadata.is_signed = is_signed;
+  if (!removed && boost::filesystem::exists(path)) {
+    metadata.json = is_signed ? Utils::parseJSONFile(path)["signed"] : Utils::parseJSONFile(path);
+    metadata.base_version = metadata.json["version"].asUInt();
+  } else {
+    metadata.json = Json::objectValue;
+  }
+  return metadata;
+}
+
+Json::Value &Repo::signedMetadata(const boost::filesystem::path &path, const Uptane::Role &role) {
+  CachedMetadata &metadata = loadMetadata(path, true);
+  metadata.role = role;
+  metadata.modified = true;
+  return metadata.json;
+}
+
+Json::Value &Repo::stagedMetadata(const boost::filesystem::path &path) {
+  CachedMetadata &metadata = loadMetadata(path, false);
+  metadata.modified = true;
+  return metadata.json;
+}
+
+const Json::Value &Repo::readMetadata(const boost::filesystem::path &path) { return loadMetadata(path, true).json; }
+
+bool Repo::metadataExists(const boost::filesystem::path &path) const {
+  auto it = metadata_.find(path);
+  if (it != metadata_.end()) {
+    return !it->second.removed;
+  }
+  return boost::filesystem::exists(path);
+}
+
+void Repo::removeMetadata(const boost::filesystem::path &path) {
+  CachedMetadata &metadata = metadata_[path];
+  metadata.json = Json::Value();
+  metadata.removed = true;
+  metadata.modified = true;
+}
+
+std::vector<boost::filesystem::path> Repo::listMetadata(const boost::filesystem::path &dir) const {
+  std::set<boost::filesystem::path> paths;
+  if (boost::filesystem::is_directory(dir)) {
+    for (auto &p : boost::filesystem::directory_iterator(dir)) {
+      if (p.path().extension() == ".json") {
+        paths.insert(p.path());
+      }
+    }
+  }
+  for (const auto &entry : metadata_) {
+    if (entry.first.parent_path() == dir) {
+      if (entry.second.removed) {
+        paths.erase(entry.first);
+      } else {
+        paths.insert(entry.first);
+      }
+    }
+  }
+  return std::vector<boost::filesystem::path>(paths.begin(), paths.end());
+}
+
+void Repo::writeMetadata() {
+  for (auto &entry : metadata_) {
+    CachedMetadata &metadata = entry.second;
+    if (!metadata.modified) {
+      continue;
+    }
+    if (metadata.removed) {
+      boost::filesystem::remove(entry.first);
+    } else if (metadata.is_signed) {
+      // Every operation bumps the version, but a batch of them only makes
+      // one new version.
+      if (metadata.json["version"].asUInt() > metadata.base_version + 1) {
+        metadata.json["version"] = metadata.base_version + 1;
+      }
+      Utils::writeFile(entry.first, Utils::jsonToCanonicalStr(signTuf(metadata.role, metadata.json)));
+    } else {
+      Utils::writeFile(entry.first, Utils::jsonToCanonicalStr(metadata.json));
+    }
+  }
+  metadata_.clear();
+}
+
 Json::Value Repo::signTuf(const Uptane::Role &role, const Json::Value &json) {
   auto key = keys_[role];
   std::string b64sig =
@@ -242,24 +351,27 @@ void Repo::generateCampaigns() const {
 }
 
 Json::Value Repo::getTarget(const std::string &target_name) {
-  const Json::Value image_targets = Utils::parseJSONFile(repo_dir_ / "targets.json")["signed"];
+  Json::Value result;
+  const Json::Value &image_targets = readMetadata(repo_dir_ / "targets.json");
   if (image_targets["targets"].isMember(target_name)) {
-    return image_targets["targets"][target_name];
+    result = image_targets["targets"][target_name];
   } else if (repo_type_ == Uptane::RepositoryType::Image()) {
-    if (!boost::filesystem::is_directory(repo_dir_ / "delegations")) {
-      return {};
-    }
-    for (auto &p : boost::filesystem::directory_iterator(repo_dir_ / "delegations")) {
-      if (Uptane::Role::IsReserved(p.path().stem().string())) {
+    for (const auto &p : listMetadata(repo_dir_ / "delegations")) {
+      if (Uptane::Role::IsReserved(p.stem().string())) {
         continue;
       }
-      auto targets = Utils::parseJSONFile(p)["signed"];
+      const Json::Value &targets = readMetadata(p);
       if (targets["targets"].isMember(target_name)) {
-        return targets["targets"][target_name];
+        result = targets["targets"][target_name];
+        break;
       }
     }
   }
-  return {};
+  if (!batch_) {
+    // Nothing was modified, this only drops what was read.
+    writeMetadata();
+  }
+  return result;
 }
 
 void Repo::readKeys() {
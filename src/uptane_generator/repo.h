@@ -3,6 +3,9 @@
 
 #include <fnmatch.h>
 
+#include <map>
+#include <vector>
+
 #include <crypto/crypto.h>
 #include <boost/filesystem.hpp>
 #include "json/json.h"
@@ -41,12 +44,43 @@ class Repo {
   void generateCampaigns() const;
   void refresh(const Uptane::Role &role);
 
+  /*
+   * Keep the metadata modified by the following operations in memory, and
+   * only sign and write each file (and update the snapshot and timestamp)
+   * once, in endBatch().
+   */
+  void beginBatch();
+  void endBatch();
+
  protected:
   void generateRepoKeys(KeyType key_type);
   void generateKeyPair(KeyType key_type, const Uptane::Role &key_name);
   static std::string getExpirationTime(const std::string &expires);
   void readKeys();
   void updateRepo();
+
+  /*
+   * Metadata files are loaded into memory once and written back by
+   * writeMetadata(), which updateRepo() calls at the end of every operation
+   * unless a batch is in progress.
+   *
+   * signedMetadata() returns the "signed" part of a metadata file for
+   * modification; the file is signed with the role's key when written. Its
+   * version ends up at most one more than the version on disk, however often
+   * it was bumped in between. A file that does not exist yet starts out
+   * empty. stagedMetadata() is the same for
+   * unsigned files. readMetadata() gives read-only access to the "signed"
+   * part without marking the file modified.
+   */
+  Json::Value &signedMetadata(const boost::filesystem::path &path, const Uptane::Role &role);
+  Json::Value &stagedMetadata(const boost::filesystem::path &path);
+  const Json::Value &readMetadata(const boost::filesystem::path &path);
+  bool metadataExists(const boost::filesystem::path &path) const;
+  void removeMetadata(const boost::filesystem::path &path);
+  /* The .json metadata files in dir, including those not written yet. */
+  std::vector<boost::filesystem::path> listMetadata(const boost::filesystem::path &dir) const;
+  void writeMetadata();
+
   Uptane::RepositoryType repo_type_;
   boost::filesystem::path path_;
   boost::filesystem::path repo_dir_;
@@ -55,7 +89,21 @@ class Repo {
   std::map<Uptane::Role, KeyPair> keys_;
 
  private:
+  struct CachedMetadata {
+    Json::Value json;
+    Uptane::Role role{Uptane::Role::InvalidRole()};
+    unsigned base_version{0};
+    bool is_signed{true};
+    bool modified{false};
+    bool removed{false};
+  };
+
+  CachedMetadata &loadMetadata(const boost::filesystem::path &path, bool is_signed);
   void addDelegationToSnapshot(Json::Value *snapshot, const Uptane::Role &role);
+
+  std::map<boost::filesystem::path, CachedMetadata> metadata_;
+  bool batch_{false};
+  bool update_pending_{false};
 };
 
 #endif  // REPO_H_
@@ -617,6 +617,74 @@ TEST(uptane_generator, refreshImageTargets) {
   check_repo(temp_dir);
 }
 
+/*
+ * Add delegations, images and Director targets from a manifest in one go.
+ */
+TEST(uptane_generator, bulk) {
+  TemporaryDirectory temp_dir;
+  std::ostringstream keytype_stream;
+  keytype_stream << key_type;
+  std::string cmd = generate_repo_exec + " generate " + temp_dir.Path().string() + " --keytype " + keytype_stream.str();
+  std::string output;
+  int retval = Utils::shell(cmd, &output);
+  if (retval) {
+    FAIL() << "'" << cmd << "' exited with error code " << retval << "\n";
+  }
+
+  Json::Value manifest;
+  manifest["delegations"][0]["name"] = "test_delegate";
+  manifest["delegations"][0]["pattern"] = "delegated/*";
+  manifest["delegations"][0]["keytype"] = keytype_stream.str();
+  for (int i = 0; i < 10; ++i) {
+    Json::Value image;
+    image["targetname"] = (i % 2 == 0 ? "delegated/target" : "target") + std::to_string(i);
+    image["sha256"] = "8ab755c16de6ee9b6224169b36cbf0f2a545f859be385501ad82cdccc240d0a6";
+    image["length"] = 123;
+    image["hwid"] = "primary_hw";
+    if (i % 2 == 0) {
+      image["delegation"] = "test_delegate";
+    }
+    manifest["images"].append(image);
+  }
+  manifest["images"][1]["filename"] = "tests/test_data/firmware.txt";
+  for (int i = 0; i < 3; ++i) {
+    Json::Value target;
+    target["targetname"] = "target" + std::to_string(2 * i + 1);
+    target["hwid"] = "primary_hw";
+    target["serial"] = "serial" + std::to_string(i);
+    manifest["targets"].append(target);
+  }
+  Utils::writeFile(temp_dir.Path() / "manifest.json", Utils::jsonToStr(manifest));
+
+  cmd = generate_repo_exec + " bulk " + temp_dir.Path().string() + " --manifest " +
+        (temp_dir.Path() / "manifest.json").string();
+  retval = Utils::shell(cmd, &output);
+  if (retval) {
+    FAIL() << "'" << cmd << "' exited with error code " << retval << "\n";
+  }
+
+  // Each file is signed and written once, so its version only goes up by one.
+  const Json::Value image_targets = Utils::parseJSONFile(temp_dir.Path() / ImageRepo::dir / "targets.json");
+  EXPECT_EQ(image_targets["signed"]["version"].asUInt(), 2);
+  EXPECT_EQ(image_targets["signed"]["targets"].size(), 5);
+  EXPECT_EQ(image_targets["signed"]["targets"]["target1"]["length"].asUInt(), 17);
+  EXPECT_EQ(image_targets["signed"]["delegations"]["roles"][0]["name"].asString(), "test_delegate");
+  const Json::Value delegate_targets =
+      Utils::parseJSONFile(temp_dir.Path() / ImageRepo::dir / "delegations/test_delegate.json");
+  EXPECT_EQ(delegate_targets["signed"]["targets"].size(), 5);
+  EXPECT_TRUE(delegate_targets["signed"]["targets"].isMember("delegated/target4"));
+  const Json::Value image_snapshot = Utils::parseJSONFile(temp_dir.Path() / ImageRepo::dir / "snapshot.json");
+  EXPECT_EQ(image_snapshot["signed"]["version"].asUInt(), 2);
+
+  const Json::Value director_targets = Utils::parseJSONFile(temp_dir.Path() / DirectorRepo::dir / "targets.json");
+  EXPECT_EQ(director_targets["signed"]["version"].asUInt(), 2);
+  EXPECT_EQ(director_targets["signed"]["targets"].size(), 3);
+  const Json::Value &ecus = director_targets["signed"]["targets"]["target5"]["custom"]["ecuIdentifiers"];
+  EXPECT_EQ(ecus["serial2"]["hardwareId"].asString(), "primary_hw");
+  EXPECT_FALSE(boost::filesystem::exists(temp_dir.Path() / DirectorRepo::dir / "staging/targets.json"));
+  check_repo(temp_dir);
+}
+
 #ifndef __NO_MAIN__
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -1,6 +1,9 @@
 
 #include "uptane_repo.h"
 
+#include <map>
+#include <sstream>
+
 UptaneRepo::UptaneRepo(const boost::filesystem::path &path, const std::string &expires,
                        const std::string &correlation_id)
     : director_repo_(path, expires, correlation_id), image_repo_(path, expires, correlation_id) {}
@@ -53,3 +56,77 @@ void UptaneRepo::refresh(Uptane::RepositoryType repo_type, const Uptane::Role &r
     image_repo_.refresh(role);
   }
 }
+
+void UptaneRepo::addFromManifest(const Json::Value &manifest) {
+  image_repo_.beginBatch();
+  director_repo_.beginBatch();
+
+  std::map<std::string, Delegation> delegations;
+  for (const auto &entry : manifest["delegations"]) {
+    const std::string name = entry["name"].asString();
+    const std::string parent = entry.get("parent", "targets").asString();
+    const std::string path = entry["pattern"].asString();
+    if (name.empty() || path.empty()) {
+      throw std::runtime_error("Delegations in the manifest require a name and a pattern");
+    }
+    KeyType key_type;
+    std::istringstream key_type_str{"\"" + entry.get("keytype", "RSA2048").asString() + "\""};
+    key_type_str >> key_type;
+    image_repo_.addDelegation(Uptane::Role(name, true), Uptane::Role(parent, parent != "targets"), path,
+                              entry["terminating"].asBool(), key_type);
+
+    Delegation &delegation = delegations[name];
+    delegation.name = name;
+    delegation.pattern = path;
+    if (delegation.pattern.back() == '/') {
+      delegation.pattern.append("**");
+    }
+  }
+
+  for (const auto &entry : manifest["images"]) {
+    const std::string targetname = entry["targetname"].asString();
+    const std::string hardware_id = entry["hwid"].asString();
+    const std::string url = entry["url"].asString();
+    if (targetname.empty() || hardware_id.empty()) {
+      throw std::runtime_error("Images in the manifest require a targetname and a hwid");
+    }
+    Delegation delegation;
+    if (entry.isMember("delegation")) {
+      auto it = delegations.find(entry["delegation"].asString());
+      if (it == delegations.end()) {
+        throw std::runtime_error("Unknown delegation " + entry["delegation"].asString() + " for image " + targetname);
+      }
+      delegation = it->second;
+      if (!delegation.isMatched(targetname)) {
+        throw std::runtime_error("Image path " + targetname + " doesn't match delegation " + delegation.name);
+      }
+    }
+    if (entry.isMember("filename")) {
+      image_repo_.addBinaryImage(entry["filename"].asString(), targetname, hardware_id, url, delegation);
+    } else if ((entry.isMember("sha256") || entry.isMember("sha512")) && entry.isMember("length")) {
+      const Uptane::Hash hash = entry.isMember("sha256")
+                                    ? Uptane::Hash(Uptane::Hash::Type::kSha256, entry["sha256"].asString())
+                                    : Uptane::Hash(Uptane::Hash::Type::kSha512, entry["sha512"].asString());
+      image_repo_.addCustomImage(targetname, hash, entry["length"].asUInt64(), hardware_id, url, delegation,
+                                 entry["custom"]);
+    } else {
+      throw std::runtime_error("Image " + targetname + " in the manifest requires a filename, or a hash and a length");
+    }
+  }
+
+  for (const auto &entry : manifest["targets"]) {
+    const std::string targetname = entry["targetname"].asString();
+    const std::string hardware_id = entry["hwid"].asString();
+    const std::string ecu_serial = entry["serial"].asString();
+    if (targetname.empty() || hardware_id.empty() || ecu_serial.empty()) {
+      throw std::runtime_error("Targets in the manifest require a targetname, a hwid and a serial");
+    }
+    addTarget(targetname, hardware_id, ecu_serial, entry["url"].asString(), entry["expires"].asString());
+  }
+  if (!manifest["targets"].empty()) {
+    director_repo_.signTargets();
+  }
+
+  image_repo_.endBatch();
+  director_repo_.endBatch();
+}
@@ -23,6 +23,15 @@ class UptaneRepo {
   void oldTargets();
   void generateCampaigns();
   void refresh(Uptane::RepositoryType repo_type, const Uptane::Role &role);
+  /*
+   * Add all the delegations, images and Director targets described by a
+   * manifest in one go: every metadata file is signed and written only once.
+   * The manifest is a JSON object with optional "delegations", "images" and
+   * "targets" arrays, whose entries take the same parameters as the
+   * adddelegation, image and addtarget commands. Director targets are signed
+   * at the end.
+   */
+  void addFromManifest(const Json::Value &manifest);
 
  private:
   DirectorRepo director_repo_;
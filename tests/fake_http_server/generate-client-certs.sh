@@ -0,0 +1,44 @@
+#!/bin/bash
+set -eEuo pipefail
+
+# Generates a client certificate for tls_server.py, issued by an intermediate
+# CA, and the root CA that tls_server.py should trust for it:
+#   ca.crt      root CA
+#   client.crt  client certificate, followed by the intermediate certificate
+#   client.key  client private key
+
+if [ "$#" -lt 1 ]; then
+  echo "Usage: $0 <output directory>"
+  exit 1
+fi
+
+DEST_DIR="$1"
+
+if [[ -f $DEST_DIR/client.crt && -f $DEST_DIR/client.key ]] && \
+    openssl x509 -checkend 86400 -noout -in "$DEST_DIR/client.crt" > /dev/null; then
+    exit 0
+fi
+
+mkdir -p "$DEST_DIR"
+trap 'rm -rf "$DEST_DIR"' ERR
+cd "$DEST_DIR"
+
+KEY_OPTS=(-nodes -newkey ec -pkeyopt ec_paramgen_curve:prime256v1)
+
+openssl req -new -x509 "${KEY_OPTS[@]}" -keyout ca.key -out ca.crt -days 3650 \
+    -subj "/O=Test ROOT CA/CN=localhost"
+
+openssl req -new "${KEY_OPTS[@]}" -keyout intermediate.key -out intermediate.csr \
+    -subj "/O=Test Intermediate CA/CN=localhost"
+printf "basicConstraints=critical,CA:TRUE\nkeyUsage=critical,keyCertSign,cRLSign\n" > intermediate.ext
+openssl x509 -req -in intermediate.csr -CA ca.crt -CAkey ca.key -CAcreateserial -days 3650 \
+    -extfile intermediate.ext -out intermediate.crt
+
+openssl req -new "${KEY_OPTS[@]}" -keyout client.key -out client.csr \
+    -subj "/O=Test Client/CN=localhost"
+printf "basicConstraints=CA:FALSE\nextendedKeyUsage=clientAuth\n" > client.ext
+openssl x509 -req -in client.csr -CA intermediate.crt -CAkey intermediate.key -CAcreateserial -days 3650 \
+    -extfile client.ext -out client-only.crt
+cat client-only.crt intermediate.crt > client.crt
+
+rm -f ./*.csr ./*.ext ./*.srl client-only.crt
@@ -2,17 +2,22 @@
 from http.server import HTTPServer,SimpleHTTPRequestHandler
 import socket
 import ssl
+import sys
 
 class ReUseHTTPServer(HTTPServer):
     def server_bind(self):
         self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
         HTTPServer.server_bind(self)
 
-httpd = ReUseHTTPServer(('localhost', 1443), SimpleHTTPRequestHandler)
+# Optional arguments: the port and the CA that issues the client certificates.
+port = int(sys.argv[1]) if len(sys.argv) > 1 else 1443
+client_ca = sys.argv[2] if len(sys.argv) > 2 else "tests/fake_http_server/ca.crt"
+
+httpd = ReUseHTTPServer(('localhost', port), SimpleHTTPRequestHandler)
 httpd.socket = ssl.wrap_socket (httpd.socket,
                                 certfile='tests/fake_http_server/server.crt',
                                 keyfile='tests/fake_http_server/server.key',
                                 server_side=True,
                                 cert_reqs = ssl.CERT_REQUIRED,
-                                ca_certs = "tests/fake_http_server/ca.crt")
+                                ca_certs = client_ca)
 httpd.serve_forever()
@@ -2,11 +2,13 @@
 
 import argparse
 import cgi
+import io
 import os
 import signal
 import ssl
 import subprocess
 import sys
+import tarfile
 import time
 from contextlib import ExitStack
 from http.server import BaseHTTPRequestHandler, HTTPServer
@@ -52,6 +54,12 @@ class TreehubServerHandler(BaseHTTPRequestHandler):
             self.end_headers()
 
     def do_POST(self):
+        if self.path == '/query/objects':
+            self.query_objects()
+            return
+        if self.path == '/bundle/objects':
+            self.upload_bundle()
+            return
         ctype, pdict = cgi.parse_header(self.headers['Content-Type'])
         print("Upload type: {}".format(ctype))
         if ctype == 'multipart/form-data':
@@ -92,10 +100,65 @@ class TreehubServerHandler(BaseHTTPRequestHandler):
         self.send_response_only(400)
         self.end_headers()
 
+    def query_objects(self):
+        """
+        Batched presence check: the body lists one object name per line, the
+        response lists those of them that are present in the repo.
+        """
+        if self.drop_check():
+            print("Dropping batched query %s" % self.path)
+            return
+        length = int(self.headers['content-length'])
+        ctype, _ = cgi.parse_header(self.headers['Content-Type'] or '')
+        if ctype != 'text/plain':
+            print("Rejecting batched query of type %s" % ctype)
+            self.rfile.read(length)
+            self.send_response_only(415)
+            self.end_headers()
+            return
+        names = self.rfile.read(length).decode('utf-8').split('\n')
+        present = [name for name in names
+                   if name and os.path.exists(os.path.join(repo_path, 'objects', name))]
+        print("Processing batched query for %d objects, %d present" % (len(names), len(present)))
+        body = ''.join(name + '\n' for name in present).encode('utf-8')
+        self.send_response_only(200)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def upload_bundle(self):
+        """
+        Bundled upload: the body is a gzipped tar archive with one entry per
+        object, named after the object.
+        """
+        if self.drop_check():
+            print("Dropping bundled upload %s" % self.path)
+            return
+        length = int(self.headers['content-length'])
+        body = self.rfile.read(length)
+        if self.headers['content-type'] != 'application/gzip':
+            print("Bundled upload with content type %s" % self.headers['content-type'])
+            self.send_response_only(400)
+            self.end_headers()
+            return
+        with tarfile.open(fileobj=io.BytesIO(body), mode='r:gz') as bundle:
+            members = [m for m in bundle.getmembers() if m.isfile()]
+            print("Processing bundled upload of %d objects" % len(members))
+            for member in members:
+                full_path = os.path.join(repo_path, 'objects', member.name)
+                os.makedirs(os.path.dirname(full_path), exist_ok=True)
+                with open(full_path, "wb") as f:
+                    f.write(bundle.extractfile(member).read())
+        self.send_response_only(204)
+        self.end_headers()
+
     def drop_check(self):
         self.__class__.made_requests += 1
-        if args.fail and args.fail > 0:
-            return self.__class__.made_requests % args.fail == 0
+        if args.fail and args.fail > 0 and self.__class__.made_requests % args.fail == 0:
+            if args.fail_status:
+                self.send_response_only(args.fail_status)
+                self.end_headers()
+            return True
         else:
             return False
 
@@ -142,6 +205,8 @@ if __name__ == "__main__":
                         help='create new ostree repo')
     parser.add_argument('-d', '--dir', help='ostree repo directory')
     parser.add_argument('-f', '--fail', type=int, help='fail every nth request')
+    parser.add_argument('--fail-status', type=int,
+                        help='answer failed requests with this HTTP status instead of dropping them')
     parser.add_argument('-s', '--sleep', type=float,
                         help='sleep for n.n seconds for every GET request')
     parser.add_argument('-t', '--tls', action='store_true',
@@ -0,0 +1,41 @@
+#! /bin/bash
+set -eEuo pipefail
+
+if [ "$#" -lt 2 ]; then
+  echo "Usage: $0 <uptane-generator> <output directory>"
+  exit 1
+fi
+
+UPTANE_GENERATOR="$1"
+DEST_DIR="$2"
+
+
+uptane_gen() {
+    echo "$UPTANE_GENERATOR --path $DEST_DIR $@"
+    "$UPTANE_GENERATOR" --path "$DEST_DIR" "$@"
+}
+
+mkdir -p "$DEST_DIR"
+trap 'rm -rf "$DEST_DIR"' ERR
+
+IMAGES=$(mktemp -d)
+trap 'rm -rf "$IMAGES"' exit
+PRIMARY_FIRMWARE="$IMAGES/primary.txt"
+echo "primary" > "$PRIMARY_FIRMWARE"
+
+# Roles that a search for a target never reaches: below an expired role,
+# below a terminating role, and below the first role listing the target.
+uptane_gen --command generate --expires 2021-07-04T16:33:27Z
+uptane_gen --command adddelegation --dname delegation-top --dpattern "ab*"
+uptane_gen --command adddelegation --dname role-expired --dpattern "abc/*" --dparent delegation-top --expires 2001-01-01T00:00:00Z
+uptane_gen --command adddelegation --dname role-below-expired --dpattern "abc/*" --dparent role-expired
+uptane_gen --command adddelegation --dname role-terminating --dpattern "abd/*" --dparent delegation-top --dterm
+uptane_gen --command adddelegation --dname role-below-terminating --dpattern "abd/*" --dparent role-terminating
+uptane_gen --command adddelegation --dname role-first --dpattern "abe/*" --dparent delegation-top
+uptane_gen --command adddelegation --dname role-below-first --dpattern "abe/*" --dparent role-first
+uptane_gen --command image --filename "$PRIMARY_FIRMWARE" --targetname primary.txt --hwid primary_hw
+uptane_gen --command image --targetname "abe/target0" --dname role-first --targetsha256 40c1fb5a90ea02744126187dc8372f9a289c59f1af4afd9855fd2285f9648bb3 --targetsha512 671718e0c9025135aba25bca6b794920cee047a8031e1f955d5c4d82072422467af5d367243f4113d1b9ca79321091f738e68f27f136f633a5fc9cd6f430c689 --targetlength 100 --hwid secondary_hw
+uptane_gen --command image --targetname "abe/target0" --dname role-below-first --targetsha256 40c1fb5a90ea02744126187dc8372f9a289c59f1af4afd9855fd2285f9648bb3 --targetsha512 671718e0c9025135aba25bca6b794920cee047a8031e1f955d5c4d82072422467af5d367243f4113d1b9ca79321091f738e68f27f136f633a5fc9cd6f430c689 --targetlength 100 --hwid secondary_hw
+uptane_gen --command image --targetname "abe/target1" --dname role-below-first --targetsha256 40c1fb5a90ea02744126187dc8372f9a289c59f1af4afd9855fd2285f9648bb3 --targetsha512 671718e0c9025135aba25bca6b794920cee047a8031e1f955d5c4d82072422467af5d367243f4113d1b9ca79321091f738e68f27f136f633a5fc9cd6f430c689 --targetlength 100 --hwid secondary_hw
+uptane_gen --command addtarget --hwid primary_hw --serial CA:FE:A6:D2:84:9D --targetname primary.txt
+uptane_gen --command signtargets